@@ -0,0 +1,9 @@
+# Compresses a portal asset for embedding; mtime 0 keeps the output reproducible.
+import gzip
+import sys
+
+with open(sys.argv[1], 'rb') as src:
+    data = src.read()
+with open(sys.argv[2], 'wb') as dst:
+    with gzip.GzipFile(filename='', mode='wb', compresslevel=9, fileobj=dst, mtime=0) as gz:
+        gz.write(data)
@@ -0,0 +1,94 @@
+#include "admissionScheduler.hpp"
+
+AdmissionScheduler::Config AdmissionScheduler::default_config() {
+	Config config;
+	config.slot_ms	   = 50;
+	config.window_ms	   = 8000;
+	config.max_window_ms = 120000;
+	config.give_up_ms	   = 300000;
+	return config;
+}
+
+AdmissionScheduler::AdmissionScheduler(const Config &config)
+    : config(config), mac_hash(0), window(config.window_ms), attempt(0), connected(false), in_episode(false),
+	 episode_start_us(0), counters() {}
+
+// FNV-1a; consecutive MACs of one vendor differ in the last bytes only, slot_offset() mixes them
+uint32_t AdmissionScheduler::hash_mac(const uint8_t mac[6]) {
+	uint32_t h = 2166136261u;
+	for (int i = 0; i < 6; i++) h = (h ^ mac[i]) * 16777619u;
+	return h;
+}
+
+uint32_t AdmissionScheduler::slot_offset(uint32_t mac_hash, uint32_t attempt, uint32_t window_ms, uint32_t slot_ms) {
+	if (slot_ms == 0) slot_ms = 1;
+	uint32_t slots = window_ms / slot_ms;
+	if (slots <= 1) return 0;
+	// Murmur3 finalizer, so that each attempt draws an independent slot
+	uint32_t h = mac_hash + attempt * 0x9e3779b9u;
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return (h % slots) * slot_ms;
+}
+
+void AdmissionScheduler::set_mac(const uint8_t mac[6]) {
+	mac_hash = hash_mac(mac);
+}
+
+uint32_t AdmissionScheduler::on_disconnected(int64_t now_us, Failure failure, uint32_t comeback_ms) {
+	if (!in_episode) {
+		in_episode	 = true;
+		episode_start_us = now_us;
+		attempt		 = 0;
+		counters.episodes++;
+	}
+	// Losing an established link says nothing about the AP's load; a failed attempt does
+	bool lost = connected;
+	connected = false;
+	if (!lost && failure == Failure::Overloaded) {
+		counters.overloads++;
+		window = window > config.max_window_ms / 2 ? config.max_window_ms : window * 2;
+	}
+
+	if (config.give_up_ms && now_us - episode_start_us > static_cast<int64_t>(config.give_up_ms) * 1000) {
+		in_episode = false;
+		counters.give_ups++;
+		counters.last_delay_ms = 0;
+		return give_up;
+	}
+
+	uint32_t delay;
+	if (comeback_ms) {
+		uint32_t spread = window / 4 > config.slot_ms ? window / 4 : config.slot_ms;
+		delay		    = comeback_ms + slot_offset(mac_hash, attempt, spread, config.slot_ms);
+		counters.comebacks++;
+	} else {
+		delay = slot_offset(mac_hash, attempt, window, config.slot_ms);
+	}
+	attempt++;
+	counters.attempts++;
+	counters.last_delay_ms = delay;
+	return delay;
+}
+
+void AdmissionScheduler::on_connected(int64_t now_us) {
+	if (in_episode) {
+		uint32_t elapsed		   = static_cast<uint32_t>((now_us - episode_start_us) / 1000);
+		counters.last_episode_ms = elapsed;
+		if (elapsed > counters.max_episode_ms) counters.max_episode_ms = elapsed;
+	}
+	in_episode = false;
+	connected	 = true;
+	window	 = window / 2 > config.window_ms ? window / 2 : config.window_ms;
+}
+
+uint32_t AdmissionScheduler::window_ms() const {
+	return window;
+}
+
+const AdmissionScheduler::Stats &AdmissionScheduler::stats() const {
+	return counters;
+}
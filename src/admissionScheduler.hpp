@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Reconnect pacing of one station of a fleet, free of driver calls so that
+ * tools/fleet_sim can run hundreds of them against a virtual AP.
+ *
+ * When an AP reboots, every station loses the beacons at about the same time,
+ * and retrying at once makes them all arrive together. Here every attempt waits
+ * for the station's slot in a window: a hash of the MAC and the attempt number
+ * picks one of window / slot_ms slots, so a fleet spreads evenly over the window
+ * without coordination, and two stations that met once are unlikely to meet
+ * again. The window doubles with every failure that shows the AP is overloaded,
+ * up to max_window_ms, and halves with every successful connect. A comeback
+ * time from the AP (status 30 with a Timeout Interval element) is a lower
+ * bound; the slot is then taken from a quarter of the window after it, so that
+ * the stations told the same time do not return together.
+ * The window is anchored at the disconnect, as stations share no clock.
+ */
+class AdmissionScheduler {
+    public:
+	// Delay returned once the episode has run longer than give_up_ms
+	static const uint32_t give_up = UINT32_MAX;
+
+	struct Config {
+		uint32_t slot_ms;  // About the time the AP takes to admit one station
+		uint32_t window_ms;
+		uint32_t max_window_ms;
+		uint32_t give_up_ms;  // From the first disconnect, 0 never
+	};
+
+	enum class Failure : uint8_t {
+		Absent,	  // No AP to answer: beacon timeout, nothing found by the scan
+		Overloaded,  // Refused (status 17 or 30) or timed out in authentication or association
+		Other,	  // Anything that spacing out does not help, e.g. a wrong password
+	};
+
+	struct Stats {
+		uint32_t episodes;	    // Disconnected spells
+		uint32_t attempts;	    // Scheduled connects
+		uint32_t overloads;
+		uint32_t comebacks;	    // Delays set by a comeback time
+		uint32_t give_ups;
+		uint32_t last_delay_ms;
+		uint32_t last_episode_ms;  // Disconnect to connect
+		uint32_t max_episode_ms;
+	};
+
+	static Config default_config();
+	explicit AdmissionScheduler(const Config& config);
+
+	void set_mac(const uint8_t mac[6]);
+
+	// The link went down or an attempt failed; returns the delay before the next
+	// attempt in milliseconds, or give_up. comeback_ms is 0 without a hint
+	uint32_t on_disconnected(int64_t now_us, Failure failure, uint32_t comeback_ms = 0);
+	void on_connected(int64_t now_us);
+
+	uint32_t window_ms() const;
+	const Stats& stats() const;
+
+	// Offset of a station's slot in a window, a multiple of slot_ms below window_ms
+	static uint32_t slot_offset(uint32_t mac_hash, uint32_t attempt, uint32_t window_ms, uint32_t slot_ms);
+	static uint32_t hash_mac(const uint8_t mac[6]);
+
+    private:
+	Config config;
+	uint32_t mac_hash;
+	uint32_t window;
+	uint32_t attempt;
+	bool connected;
+	bool in_episode;
+	int64_t episode_start_us;
+	Stats counters;
+};
@@ -0,0 +1,310 @@
+#include "bringUp.hpp"
+#include "wifiLog.hpp"
+#include "wifiManager.hpp"
+
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <esp_attr.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <lwip/dns.h>
+#include <lwip/tcpip.h>
+
+#ifdef CONFIG_WIFI_MANAGER_BRINGUP_SNTP_TIMEOUT_MS
+#define SNTP_TIMEOUT_MS CONFIG_WIFI_MANAGER_BRINGUP_SNTP_TIMEOUT_MS
+#define SNTP_CACHE_MAX_AGE_S CONFIG_WIFI_MANAGER_BRINGUP_SNTP_CACHE_MAX_AGE_S
+#define DNS_TIMEOUT_MS CONFIG_WIFI_MANAGER_BRINGUP_DNS_TIMEOUT_MS
+#else
+#define SNTP_TIMEOUT_MS 5000
+#define SNTP_CACHE_MAX_AGE_S 3600
+#define DNS_TIMEOUT_MS 3000
+#endif
+
+#define READY_BIT BIT0
+#define FAILED_BIT BIT1
+
+BringUp::Stage BringUp::stages[max_stages];
+BringUp::Timing BringUp::timings[max_stages];
+int BringUp::stage_count = 0;
+
+QueueHandle_t BringUp::queue	   = nullptr;
+SemaphoreHandle_t BringUp::mutex  = nullptr;
+EventGroupHandle_t BringUp::group = nullptr;
+std::atomic<uint32_t> BringUp::generation(0);
+esp_ip4_addr_t BringUp::lease	   = {};
+int64_t BringUp::ip_us		   = 0;
+int64_t BringUp::ready_at_us	   = 0;
+uint32_t BringUp::queued	   = 0;
+uint32_t BringUp::finished	   = 0;
+uint32_t BringUp::failed	   = 0;
+bool BringUp::running	   = false;
+
+// Survives deep sleep and software restarts together with the RTC clock. RTC_DATA_ATTR
+// would be reloaded on a software restart; no-init memory is random after power-on,
+// hence the check word
+#define SNTP_CACHE_MAGIC 0x534e5450u
+
+struct SntpCache {
+	uint32_t magic;
+	uint32_t check;  // magic ^ last_sync
+	time_t last_sync;
+};
+
+RTC_NOINIT_ATTR static SntpCache rtc_sntp;
+
+static time_t cached_sync() {
+	if (rtc_sntp.magic != SNTP_CACHE_MAGIC || rtc_sntp.check != (SNTP_CACHE_MAGIC ^ static_cast<uint32_t>(rtc_sntp.last_sync))) return 0;
+	return rtc_sntp.last_sync;
+}
+static SemaphoreHandle_t sntp_synced = nullptr;
+
+struct DnsBatch {
+	const char* const* hosts;
+	int count;
+	SemaphoreHandle_t answered;
+	std::atomic<int> resolved;
+};
+
+int BringUp::add_stage(const Stage &stage) {
+	if (queue || stage_count == max_stages || !stage.run) return -1;
+	stages[stage_count] = stage;
+	return stage_count++;
+}
+
+int BringUp::add_sntp(const char *server, bool required) {
+	Stage stage = {"sntp", sntp_stage, const_cast<char *>(server), 0, required};
+	return add_stage(stage);
+}
+
+int BringUp::add_dns(const char *const *hosts, int count, bool required) {
+	DnsBatch *batch = new DnsBatch();
+	batch->hosts	 = hosts;
+	batch->count	 = count;
+	batch->answered = xSemaphoreCreateCounting(count, 0);
+	Stage stage	 = {"dns", dns_stage, batch, 0, required};
+	return add_stage(stage);
+}
+
+esp_err_t BringUp::start(int workers, UBaseType_t priority) {
+	if (queue) return ESP_ERR_INVALID_STATE;
+
+	// Room for a full generation plus the stale jobs of the one it replaced
+	queue = xQueueCreate(2 * max_stages, sizeof(Job));
+	mutex = xSemaphoreCreateMutex();
+	group = xEventGroupCreate();
+	if (!queue || !mutex || !group) return ESP_ERR_NO_MEM;
+
+	for (int i = 0; i < workers; i++) {
+		if (xTaskCreate(worker, "bringup", 4096, nullptr, priority, nullptr) != pdPASS) return ESP_ERR_NO_MEM;
+	}
+
+	uint32_t mask = WIFI_EVENT_MASK(WiFiEventType::IpAcquired) | WIFI_EVENT_MASK(WiFiEventType::Ip6Acquired) |
+				 WIFI_EVENT_MASK(WiFiEventType::IpLost) | WIFI_EVENT_MASK(WiFiEventType::LinkDown);
+	if (WiFiEvents::subscribe(on_event, nullptr, mask) < 0) return ESP_ERR_NO_MEM;
+
+	// Connect() may have returned already
+	LinkSnapshot link = WiFi::get_link();
+	if (link.state == LinkState::Up) {
+		WiFiEvent event	 = {};
+		event.timestamp_us = esp_timer_get_time();
+		event.type	 = WiFiEventType::IpAcquired;
+		event.ip		 = link.ip_info.ip;
+		on_event(event, nullptr);
+	}
+	return ESP_OK;
+}
+
+void BringUp::on_event(const WiFiEvent &event, void *arg) {
+	// Up follows WiFi::IpPolicy, so the address that completed it may be of either family
+	bool up = WiFi::get_link().state == LinkState::Up;
+
+	Job jobs[max_stages];
+	int count = 0;
+	xSemaphoreTake(mutex, portMAX_DELAY);
+	if (event.type == WiFiEventType::IpAcquired || event.type == WiFiEventType::Ip6Acquired) {
+		// A changed IPv4 address starts over; a DHCP renewal of the same lease and the
+		// further addresses of a running pipeline do not
+		bool changed = event.type == WiFiEventType::IpAcquired && event.ip.addr != lease.addr;
+		if (event.type == WiFiEventType::IpAcquired) lease = event.ip;
+		if (up && (!running || changed)) count = restart(event.timestamp_us, jobs);
+	} else if (!up) {
+		// Jobs still running finish into a stale generation and are ignored
+		generation++;
+		running	 = false;
+		lease.addr = 0;
+		xEventGroupClearBits(group, READY_BIT | FAILED_BIT);
+	}
+	xSemaphoreGive(mutex);
+	enqueue(jobs, count);
+}
+
+int BringUp::restart(int64_t now_us, Job *jobs) {
+	generation++;
+	running	  = true;
+	ip_us	  = now_us;
+	ready_at_us = 0;
+	queued	  = 0;
+	finished	  = 0;
+	failed	  = 0;
+	memset(timings, 0, sizeof(timings));
+	xEventGroupClearBits(group, READY_BIT | FAILED_BIT);
+	return schedule(jobs);
+}
+
+// Under mutex; returns the jobs that became runnable, for enqueue() once the mutex is released
+int BringUp::schedule(Job *jobs) {
+	uint32_t required = 0;
+	int count	   = 0;
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (int i = 0; i < stage_count; i++) {
+			uint32_t bit = BRINGUP_AFTER(i);
+			if (stages[i].required) required |= bit;
+			if ((queued | finished) & bit) continue;
+
+			if (stages[i].depends & failed) {
+				timings[i].result = ESP_ERR_INVALID_STATE;
+				timings[i].done	  = true;
+				finished |= bit;
+				failed |= bit;
+				changed = true;
+			} else if ((stages[i].depends & ~finished) == 0) {
+				jobs[count++] = {static_cast<uint8_t>(i), generation};
+				queued |= bit;
+			}
+		}
+	}
+
+	if (failed & required) {
+		xEventGroupSetBits(group, FAILED_BIT);
+	} else if ((finished & required) == required && !ready_at_us) {
+		ready_at_us = esp_timer_get_time();
+		xEventGroupSetBits(group, READY_BIT);
+		WIFI_LOG(BringUpReady, static_cast<int32_t>((ready_at_us - ip_us) / 1000));
+	}
+	return count;
+}
+
+// Not under the mutex: the workers need it to finish the jobs that free queue space
+void BringUp::enqueue(const Job *jobs, int count) {
+	for (int i = 0; i < count; i++) xQueueSend(queue, &jobs[i], portMAX_DELAY);
+}
+
+void BringUp::complete(const Job &job, esp_err_t result, int64_t started_us) {
+	Job jobs[max_stages];
+	int count = 0;
+	xSemaphoreTake(mutex, portMAX_DELAY);
+	if (job.generation == generation) {
+		uint32_t bit	  = BRINGUP_AFTER(job.stage);
+		Timing &t	  = timings[job.stage];
+		t.start_us	  = started_us - ip_us;
+		t.duration_us = esp_timer_get_time() - started_us;
+		t.result	  = result;
+		t.done	  = true;
+		finished |= bit;
+		if (result != ESP_OK) {
+			failed |= bit;
+			WIFI_LOG(BringUpStageFailed, job.stage, result);
+		}
+		count = schedule(jobs);
+	}
+	xSemaphoreGive(mutex);
+	enqueue(jobs, count);
+}
+
+void BringUp::worker(void *arg) {
+	Job job;
+	for (;;) {
+		if (xQueueReceive(queue, &job, portMAX_DELAY) != pdTRUE) continue;
+
+		// Stale jobs are dropped without the mutex, so that they drain quickly
+		if (job.generation != generation) continue;
+
+		int64_t started = esp_timer_get_time();
+		esp_err_t err   = stages[job.stage].run(stages[job.stage].arg);
+		complete(job, err, started);
+	}
+}
+
+bool BringUp::ready(TickType_t timeout) {
+	if (!group) return false;
+	return xEventGroupWaitBits(group, READY_BIT | FAILED_BIT, pdFALSE, pdFALSE, timeout) & READY_BIT;
+}
+
+BringUp::Timing BringUp::timing(int stage) {
+	Timing t = {};
+	if (stage < 0 || stage >= stage_count || !mutex) return t;
+	xSemaphoreTake(mutex, portMAX_DELAY);
+	t = timings[stage];
+	xSemaphoreGive(mutex);
+	return t;
+}
+
+int64_t BringUp::ready_us() {
+	if (!mutex) return 0;
+	xSemaphoreTake(mutex, portMAX_DELAY);
+	int64_t us = ready_at_us ? ready_at_us - ip_us : 0;
+	xSemaphoreGive(mutex);
+	return us;
+}
+
+static void on_time_sync(struct timeval *tv) {
+	rtc_sntp.last_sync = tv->tv_sec;
+	rtc_sntp.check	    = SNTP_CACHE_MAGIC ^ static_cast<uint32_t>(tv->tv_sec);
+	rtc_sntp.magic	    = SNTP_CACHE_MAGIC;
+	xSemaphoreGive(sntp_synced);
+}
+
+esp_err_t BringUp::sntp_stage(void *arg) {
+	if (!sntp_synced) {
+		sntp_synced = xSemaphoreCreateBinary();
+		sntp_setoperatingmode(SNTP_OPMODE_POLL);
+		sntp_setservername(0, static_cast<const char *>(arg));
+		sntp_set_time_sync_notification_cb(on_time_sync);
+		// Keeps polling in the background from here on
+		sntp_init();
+	}
+
+	// The clock kept running in the RTC; a recent sync is good enough to go on with
+	time_t now	= time(nullptr);
+	time_t last_sync = cached_sync();
+	if (last_sync && now >= last_sync && now - last_sync < SNTP_CACHE_MAX_AGE_S) return ESP_OK;
+
+	return xSemaphoreTake(sntp_synced, pdMS_TO_TICKS(SNTP_TIMEOUT_MS)) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+static void dns_found(const char *name, const ip_addr_t *addr, void *arg) {
+	DnsBatch *batch = static_cast<DnsBatch *>(arg);
+	if (addr) batch->resolved++;
+	xSemaphoreGive(batch->answered);
+}
+
+// lwIP's raw DNS API belongs to the tcpip thread; all queries go out at once
+static void dns_query_all(void *arg) {
+	DnsBatch *batch = static_cast<DnsBatch *>(arg);
+	for (int i = 0; i < batch->count; i++) {
+		ip_addr_t addr;
+		err_t err = dns_gethostbyname(batch->hosts[i], &addr, dns_found, batch);
+		if (err == ERR_OK) batch->resolved++;
+		if (err != ERR_INPROGRESS) xSemaphoreGive(batch->answered);
+	}
+}
+
+esp_err_t BringUp::dns_stage(void *arg) {
+	DnsBatch *batch = static_cast<DnsBatch *>(arg);
+	// Late answers of a previous run
+	while (xSemaphoreTake(batch->answered, 0) == pdTRUE) {
+	}
+	batch->resolved = 0;
+
+	if (tcpip_callback(dns_query_all, batch) != ERR_OK) return ESP_FAIL;
+
+	TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(DNS_TIMEOUT_MS);
+	for (int i = 0; i < batch->count; i++) {
+		TickType_t now = xTaskGetTickCount();
+		if (now >= deadline || xSemaphoreTake(batch->answered, deadline - now) != pdTRUE) return ESP_ERR_TIMEOUT;
+	}
+	return batch->resolved == batch->count ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/event_groups.h>
+
+#include <esp_err.h>
+
+#include "wifiEvents.hpp"
+
+#define BRINGUP_AFTER(stage) (1u << (stage))
+
+/*
+ * Work that has to happen after every IP acquisition (time, name
+ * resolution, broker connects), declared once and run on a small worker
+ * pool as soon as each stage's dependencies are done.
+ * The pipeline starts when the link comes Up, restarts on a new IPv4 address
+ * and is cancelled when the link goes down.
+ */
+class BringUp {
+    public:
+	typedef esp_err_t (*stage_fn_t)(void* arg);
+
+	static const int max_stages = 12;
+
+	struct Stage {
+		const char* name;
+		stage_fn_t run;
+		void* arg;
+		uint32_t depends;  // BRINGUP_AFTER() of each prerequisite
+		bool required;	   // ready() waits for it
+	};
+
+	struct Timing {
+		int64_t start_us;	 // Since the IP was acquired
+		int64_t duration_us;
+		esp_err_t result;	 // ESP_ERR_INVALID_STATE when a prerequisite failed
+		bool done;
+	};
+
+	// Stages are declared before start(); the returned id goes into BRINGUP_AFTER()
+	static int add_stage(const Stage& stage);
+	// SNTP; finishes at once when the RTC kept a recent sync across the restart
+	static int add_sntp(const char* server, bool required = true);
+	// Resolves the hosts concurrently into lwIP's DNS cache, which honors the record TTLs
+	static int add_dns(const char* const* hosts, int count, bool required = false);
+
+	static esp_err_t start(int workers = 3, UBaseType_t priority = 5);
+
+	// True once every required stage succeeded, false on timeout or a failed required stage
+	static bool ready(TickType_t timeout = portMAX_DELAY);
+	static Timing timing(int stage);
+	// IP acquisition to ready, 0 while not ready
+	static int64_t ready_us();
+
+    private:
+	BringUp();
+
+	struct Job {
+		uint8_t stage;
+		uint32_t generation;
+	};
+
+	static Stage stages[max_stages];
+	static Timing timings[max_stages];
+	static int stage_count;
+
+	static QueueHandle_t queue;
+	static SemaphoreHandle_t mutex;
+	static EventGroupHandle_t group;
+	static std::atomic<uint32_t> generation;
+	static esp_ip4_addr_t lease;  // IPv4 address the pipeline last ran for
+	static int64_t ip_us;
+	static int64_t ready_at_us;
+	static uint32_t queued;
+	static uint32_t finished;
+	static uint32_t failed;
+	static bool running;
+
+	static void on_event(const WiFiEvent& event, void* arg);
+	static int restart(int64_t now_us, Job* jobs);
+	static int schedule(Job* jobs);
+	static void enqueue(const Job* jobs, int count);
+	static void complete(const Job& job, esp_err_t result, int64_t started_us);
+	static void worker(void* arg);
+
+	static esp_err_t sntp_stage(void* arg);
+	static esp_err_t dns_stage(void* arg);
+};
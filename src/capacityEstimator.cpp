@@ -0,0 +1,158 @@
+#include "capacityEstimator.hpp"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+struct Rate {
+	int8_t sensitivity;	// dBm, ESP32 datasheet
+	uint32_t kbps;
+};
+
+static const Rate rates_11b[] = {{-98, 1000}, {-96, 2000}, {-93, 5500}, {-88, 11000}};
+static const Rate rates_11g[] = {{-92, 6000}, {-91, 9000}, {-89, 12000}, {-87, 18000}, {-84, 24000}, {-80, 36000}, {-76, 48000}, {-74, 54000}};
+// MCS0-7, long guard interval
+static const Rate rates_ht20[] = {{-89, 6500}, {-86, 13000}, {-84, 19500}, {-81, 26000}, {-78, 39000}, {-74, 52000}, {-72, 58500}, {-70, 65000}};
+static const Rate rates_ht40[] = {{-86, 13500}, {-83, 27000}, {-81, 40500}, {-78, 54000}, {-75, 81000}, {-71, 108000}, {-69, 121500}, {-67, 135000}};
+static const Rate rates_lr[]   = {{-102, 250}, {-99, 500}};
+
+template <size_t N>
+static void pick(const Rate (&table)[N], int need, uint32_t &best, uint32_t &floor) {
+	if (!floor || table[0].kbps < floor) floor = table[0].kbps;
+	for (const Rate &r : table) {
+		if (r.sensitivity <= need && r.kbps > best) best = r.kbps;
+	}
+}
+
+CapacityEstimator::Config CapacityEstimator::default_config() {
+	Config c		 = {};
+	c.fade_margin_db	 = 8;
+	c.mac_efficiency_pct = 60;
+	c.drift_kbps	 = 1000;
+	c.model_error_kbps	 = 8000;
+	c.goodput_error_kbps = 1000;
+	c.busy_pct		 = 90;
+	c.hysteresis_pct	 = 20;
+	c.min_notify_ms	 = 2000;
+	return c;
+}
+
+CapacityEstimator::CapacityEstimator(const Config &config) : config(config) {
+	reset();
+}
+
+void CapacityEstimator::reset() {
+	started	    = false;
+	last	    = Observation();
+	up		    = Filter();
+	down	    = Filter();
+	loss	    = 0;
+	scale	    = 1;
+	current	    = Estimate();
+	reported    = Estimate();
+	reported_ms = 0;
+}
+
+uint32_t CapacityEstimator::phy_rate_kbps(int8_t rssi, uint8_t phy, uint8_t margin_db) {
+	if (rssi == 0) return 0;
+	int need	   = rssi - margin_db;
+	uint32_t best  = 0;
+	uint32_t floor = 0;
+	if (phy & phy_11b) pick(rates_11b, need, best, floor);
+	if (phy & phy_11g) pick(rates_11g, need, best, floor);
+	if (phy & phy_11n) {
+		if (phy & phy_ht40) pick(rates_ht40, need, best, floor);
+		else pick(rates_ht20, need, best, floor);
+	}
+	if (phy & phy_lr) pick(rates_lr, need, best, floor);
+	// Associated on a mode the table does not know: assume 11g
+	if (!floor) pick(rates_11g, need, best, floor);
+	return best ? best : floor;
+}
+
+void CapacityEstimator::measure(Filter &f, float kbps, float error_kbps) {
+	float r    = error_kbps * error_kbps;
+	float gain = f.variance / (f.variance + r);
+	f.kbps += gain * (kbps - f.kbps);
+	f.variance *= 1 - gain;
+}
+
+bool CapacityEstimator::moved(uint32_t now, uint32_t from, uint32_t to) const {
+	if ((from == 0) != (to == 0)) return true;
+	uint32_t diff = from > to ? from - to : to - from;
+	return static_cast<uint64_t>(diff) * 100 > static_cast<uint64_t>(config.hysteresis_pct) * from &&
+		  now - reported_ms >= config.min_notify_ms;
+}
+
+// The counters wrap modulo 2^32 but may also restart from zero, e.g. after
+// WiFiQos::reset_stats(); one that went backwards counts from zero
+static uint32_t counter_delta(uint32_t now, uint32_t before) {
+	return now - before > UINT32_MAX / 2 ? now : now - before;
+}
+
+bool CapacityEstimator::update(const Observation &obs) {
+	if (obs.rssi == 0) {
+		bool had = started;
+		reset();
+		current.time_ms = obs.time_ms;
+		return had;
+	}
+
+	float model_error = static_cast<float>(config.model_error_kbps);
+	uint32_t phy	     = phy_rate_kbps(obs.rssi, obs.phy, config.fade_margin_db);
+	if (!started) {
+		float model = phy * config.mac_efficiency_pct / 100.0f;
+		up		   = Filter{model, model_error * model_error};
+		down	   = up;
+		started	   = true;
+		last	   = obs;
+	} else {
+		uint32_t dt_ms = obs.time_ms - last.time_ms;
+		if (dt_ms == 0) return false;
+		float dt = dt_ms / 1000.0f;
+
+		uint32_t sent	= counter_delta(obs.tx_packets, last.tx_packets);
+		uint32_t failed = counter_delta(obs.tx_failures, last.tx_failures);
+		if (sent + failed) loss += 0.2f * (static_cast<float>(failed) / (sent + failed) - loss);
+
+		float base  = phy * config.mac_efficiency_pct / 100.0f * (1 - loss);
+		float model = base * scale;
+		float drift = static_cast<float>(config.drift_kbps);
+		for (Filter *f : {&up, &down}) {
+			f->variance += drift * drift * dt;
+			measure(*f, model, model_error);
+		}
+
+		// Bits per millisecond are kbit/s
+		float error		= static_cast<float>(config.goodput_error_kbps);
+		float up_kbps	= counter_delta(obs.up_bytes, last.up_bytes) * 8.0f / dt_ms;
+		float down_kbps = counter_delta(obs.down_bytes, last.down_bytes) * 8.0f / dt_ms;
+		bool refused	= counter_delta(obs.tx_refused, last.tx_refused) != 0;
+		if (refused || up_kbps > up.kbps || up_kbps * 100 >= up.kbps * config.busy_pct) {
+			measure(up, up_kbps, error);
+			// Saturated goodput calibrates the rate model to this radio and AP
+			if (base > 0) scale = std::min(4.0f, std::max(0.25f, scale + 0.1f * (up_kbps / base - scale)));
+		}
+		if (down_kbps > down.kbps || down_kbps * 100 >= down.kbps * config.busy_pct) measure(down, down_kbps, error);
+		last = obs;
+	}
+
+	current.time_ms	       = obs.time_ms;
+	current.phy_kbps	       = phy;
+	current.up_kbps	       = static_cast<uint32_t>(std::max(up.kbps, 0.0f));
+	current.down_kbps	       = static_cast<uint32_t>(std::max(down.kbps, 0.0f));
+	current.up_error_kbps   = static_cast<uint32_t>(std::sqrt(up.variance));
+	current.down_error_kbps = static_cast<uint32_t>(std::sqrt(down.variance));
+	current.loss_permille   = static_cast<uint16_t>(loss * 1000);
+
+	if (!moved(obs.time_ms, reported.up_kbps, current.up_kbps) && !moved(obs.time_ms, reported.down_kbps, current.down_kbps)) return false;
+	reported	   = current;
+	reported_ms = obs.time_ms;
+	return true;
+}
+
+CapacityEstimator::Estimate CapacityEstimator::estimate() const {
+	return current;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Usable uplink and downlink throughput of the station, free of driver
+ * calls so that tools/capacity_replay can drive it with recorded traces.
+ *
+ * Each direction is a scalar Kalman filter. Every observation contributes
+ * the rate model: the fastest PHY rate whose receive sensitivity the RSSI
+ * clears by the fade margin, times the MAC efficiency, times the delivery
+ * ratio. Observed goodput only says something about capacity while the
+ * application pushes against it, so it is a measurement when it exceeds
+ * the estimate, when sends were refused (uplink), or when it reaches
+ * busy_pct of the estimate, and is ignored otherwise. Without goodput
+ * evidence the estimates drift back to the model, scaled by the ratio of
+ * saturated uplink goodput to the model seen so far on this link.
+ * update() reports a change once an estimate moved by hysteresis_pct since
+ * the last report, at most every min_notify_ms; losing or gaining the link
+ * is reported at once.
+ */
+class CapacityEstimator {
+    public:
+	// Observation::phy bits, the same as Telemetry::Sample::phy
+	static const uint8_t phy_11b  = 1 << 0;
+	static const uint8_t phy_11g  = 1 << 1;
+	static const uint8_t phy_11n  = 1 << 2;
+	static const uint8_t phy_lr	  = 1 << 3;
+	static const uint8_t phy_ht40 = 1 << 4;
+
+	struct Config {
+		uint8_t fade_margin_db;	    // Above the sensitivity of a rate before it is usable
+		uint8_t mac_efficiency_pct;   // Goodput share of the PHY rate on a clean channel
+		uint32_t drift_kbps;	    // Capacity change per second the filter allows for
+		uint32_t model_error_kbps;    // Standard error of the rate model
+		uint32_t goodput_error_kbps;  // Standard error of a goodput sample
+		uint8_t busy_pct;		    // Goodput share of the estimate that counts as saturated
+		uint8_t hysteresis_pct;
+		uint32_t min_notify_ms;
+	};
+
+	// Totals are cumulative, the estimator works on the differences
+	struct Observation {
+		uint32_t time_ms;
+		int8_t rssi;  // 0 while not associated
+		uint8_t phy;
+		uint32_t tx_packets;
+		uint32_t tx_failures;  // Dropped and errored frames, standing in for MAC retries
+		uint32_t tx_refused;   // Sends the stack refused for lack of buffers, a full uplink
+		uint32_t up_bytes;	   // Application goodput
+		uint32_t down_bytes;
+	};
+
+	struct Estimate {
+		uint32_t time_ms;
+		uint32_t phy_kbps;  // Modelled PHY rate
+		uint32_t up_kbps;
+		uint32_t down_kbps;
+		uint32_t up_error_kbps;  // Standard deviation of the estimates
+		uint32_t down_error_kbps;
+		uint16_t loss_permille;  // Smoothed failure ratio
+	};
+
+	static Config default_config();
+	explicit CapacityEstimator(const Config& config);
+
+	// True when the estimate changed enough to be reported
+	bool update(const Observation& obs);
+	Estimate estimate() const;
+	void reset();
+
+	// Fastest rate of the PHY modes whose sensitivity rssi clears by margin_db,
+	// the slowest one when none does; 0 for rssi 0
+	static uint32_t phy_rate_kbps(int8_t rssi, uint8_t phy, uint8_t margin_db);
+
+    private:
+	struct Filter {
+		float kbps;
+		float variance;
+	};
+
+	Config config;
+	bool started;
+	Observation last;
+	Filter up;
+	Filter down;
+	float loss;
+	float scale;  // Saturated goodput over the rate model
+	Estimate current;
+	Estimate reported;
+	uint32_t reported_ms;
+
+	void measure(Filter& f, float kbps, float error_kbps);
+	bool moved(uint32_t now, uint32_t from, uint32_t to) const;
+};
@@ -0,0 +1,262 @@
+#include "configStore.hpp"
+
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <nvs.h>
+#else
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define TAG "WiFi Manager"
+
+#ifdef CONFIG_WIFI_MANAGER_CONFIG_COALESCE_MS
+#define CONFIG_COALESCE_MS CONFIG_WIFI_MANAGER_CONFIG_COALESCE_MS
+#else
+#define CONFIG_COALESCE_MS 5000
+#endif
+
+#define CONFIG_MAGIC 0x46434d57  // "WMCF"
+#define BLOB_SIZE (sizeof(Header) + sizeof(StoredConfig))
+
+std::mutex ConfigStore::data_lock;
+std::mutex ConfigStore::io_lock;
+StoredConfig ConfigStore::config;
+uint32_t ConfigStore::stored_crc	  = 0;
+int ConfigStore::active_slot	  = 1;  // The first write goes to slot 0
+static ConfigStore::Stats initial_stats() {
+	ConfigStore::Stats stats = {};
+	stats.loaded_slot		= -1;
+	return stats;
+}
+
+ConfigStore::Stats ConfigStore::stats = initial_stats();
+bool ConfigStore::is_loaded		  = false;
+
+static char location[32];
+
+static int64_t now_us() {
+#ifdef ESP_PLATFORM
+	return esp_timer_get_time();
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+uint32_t ConfigStore::crc32(const void *data, size_t len, uint32_t crc) {
+	// Reflected CRC-32 (IEEE), bitwise; the blob is small and written rarely
+	const uint8_t *p = static_cast<const uint8_t *>(data);
+	crc		    = ~crc;
+	while (len--) {
+		crc ^= *p++;
+		for (int i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+	return ~crc;
+}
+
+uint32_t ConfigStore::blob_crc(const Header &header, const void *payload, size_t len) {
+	return crc32(payload, len, crc32(&header, offsetof(Header, crc)));
+}
+
+#ifdef ESP_PLATFORM
+static const char *slot_key(int slot) {
+	return slot ? "cfg_b" : "cfg_a";
+}
+
+int ConfigStore::read_slot(int slot, uint8_t *buf, size_t len, size_t &read) {
+	nvs_handle_t handle;
+	esp_err_t err = nvs_open(location, NVS_READONLY, &handle);
+	if (err) return err;
+	read = len;
+	err  = nvs_get_blob(handle, slot_key(slot), buf, &read);
+	nvs_close(handle);
+	return err;
+}
+
+int ConfigStore::write_slot(int slot, const uint8_t *buf, size_t len) {
+	nvs_handle_t handle;
+	esp_err_t err = nvs_open(location, NVS_READWRITE, &handle);
+	if (err) return err;
+	err = nvs_set_blob(handle, slot_key(slot), buf, len);
+	if (!err) err = nvs_commit(handle);
+	nvs_close(handle);
+	return err;
+}
+
+static esp_timer_handle_t flush_timer = nullptr;
+static TaskHandle_t flush_task	     = nullptr;
+
+// A flash write or page erase blocks for tens of milliseconds, too long for the esp_timer task
+static void flush_worker(void *arg) {
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		ConfigStore::flush();
+	}
+}
+
+static void on_flush_timer(void *arg) {
+	xTaskNotifyGive(flush_task);
+}
+
+void ConfigStore::schedule_flush() {
+	if (!flush_task && xTaskCreate(flush_worker, "config_flush", 3072, nullptr, tskIDLE_PRIORITY + 1, &flush_task) != pdPASS) {
+		flush_task = nullptr;
+		return;
+	}
+	if (!flush_timer) {
+		esp_timer_create_args_t args = {};
+		args.callback			   = on_flush_timer;
+		args.name				   = "config_flush";
+		if (esp_timer_create(&args, &flush_timer)) return;
+	}
+	// Already pending: the earlier deadline stands, so a steady trickle still gets written
+	if (!esp_timer_is_active(flush_timer)) esp_timer_start_once(flush_timer, CONFIG_COALESCE_MS * 1000ULL);
+}
+#else
+static void slot_path(int slot, char *path, size_t len) {
+	snprintf(path, len, "%s.%c", location, slot ? 'b' : 'a');
+}
+
+int ConfigStore::read_slot(int slot, uint8_t *buf, size_t len, size_t &read) {
+	char path[48];
+	slot_path(slot, path, sizeof(path));
+	FILE *f = fopen(path, "rb");
+	if (!f) return errno;
+	read = fread(buf, 1, len, f);
+	fclose(f);
+	return 0;
+}
+
+int ConfigStore::write_slot(int slot, const uint8_t *buf, size_t len) {
+	char path[48], tmp[52];
+	slot_path(slot, path, sizeof(path));
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+	FILE *f = fopen(tmp, "wb");
+	if (!f) return errno;
+	bool ok = fwrite(buf, 1, len, f) == len && fflush(f) == 0 && fsync(fileno(f)) == 0;
+	fclose(f);
+	// rename() replaces the slot atomically
+	if (!ok || rename(tmp, path) != 0) return errno ? errno : EIO;
+	return 0;
+}
+
+// The host harness calls flush() itself
+void ConfigStore::schedule_flush() {
+}
+#endif
+
+int ConfigStore::load(const char *where) {
+	std::lock_guard<std::mutex> io(io_lock);
+	strncpy(location, where, sizeof(location) - 1);
+	int64_t started = now_us();
+
+	uint8_t buf[BLOB_SIZE];
+	StoredConfig best   = {};
+	int best_slot	    = -1;
+	uint32_t best_seq   = 0;
+	int err		    = 0;
+	for (int slot = 0; slot < 2; slot++) {
+		size_t read = 0;
+		int e	  = read_slot(slot, buf, sizeof(buf), read);
+		if (e) {
+			err = e;
+			continue;
+		}
+
+		Header header;
+		if (read < sizeof(header)) continue;
+		memcpy(&header, buf, sizeof(header));
+		if (header.magic != CONFIG_MAGIC || header.version > version) continue;
+		if (header.size > sizeof(StoredConfig) || read < sizeof(header) + header.size) continue;
+		if (blob_crc(header, buf + sizeof(header), header.size) != header.crc) continue;
+		if (best_slot >= 0 && static_cast<int32_t>(header.sequence - best_seq) <= 0) continue;
+
+		memset(&best, 0, sizeof(best));
+		memcpy(&best, buf + sizeof(header), header.size);
+		best_slot = slot;
+		best_seq  = header.sequence;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(data_lock);
+		config	  = best;
+		stored_crc  = best_slot >= 0 ? crc32(&config, sizeof(config)) : 0;
+		active_slot = best_slot >= 0 ? best_slot : 1;
+		stats.loaded_slot = best_slot;
+		stats.sequence    = best_seq;
+		stats.load_us	    = static_cast<uint32_t>(now_us() - started);
+		is_loaded	    = true;
+	}
+	// Missing slots on a first boot are not an error
+	return best_slot >= 0 ? 0 : err;
+}
+
+bool ConfigStore::loaded() {
+	std::lock_guard<std::mutex> guard(data_lock);
+	return is_loaded;
+}
+
+StoredConfig ConfigStore::get() {
+	std::lock_guard<std::mutex> guard(data_lock);
+	return config;
+}
+
+int ConfigStore::flush() {
+	std::lock_guard<std::mutex> io(io_lock);
+
+	uint8_t buf[BLOB_SIZE];
+	Header header;
+	int slot;
+	{
+		std::lock_guard<std::mutex> guard(data_lock);
+		if (!is_loaded) return -1;
+		uint32_t crc = crc32(&config, sizeof(config));
+		if (crc == stored_crc) {
+			stats.unchanged++;
+			return 0;
+		}
+		header.magic	= CONFIG_MAGIC;
+		header.version	= version;
+		header.size	= sizeof(StoredConfig);
+		header.sequence = stats.sequence + 1;
+		header.crc	= blob_crc(header, &config, sizeof(config));
+		memcpy(buf, &header, sizeof(header));
+		memcpy(buf + sizeof(header), &config, sizeof(config));
+		slot = active_slot ^ 1;
+		// Compared against the copy taken here; later updates make the next flush write again
+		stored_crc = crc;
+	}
+
+	int err = write_slot(slot, buf, sizeof(buf));
+
+	std::lock_guard<std::mutex> guard(data_lock);
+	if (err) {
+		stats.errors++;
+		stored_crc = 0;
+#ifdef ESP_PLATFORM
+		ESP_LOGW(TAG, "config write error %d", err);
+#endif
+		// Tried again after the quiet period, not only on the next update()
+		schedule_flush();
+		return err;
+	}
+	active_slot	 = slot;
+	stats.sequence = header.sequence;
+	stats.writes++;
+	return 0;
+}
+
+ConfigStore::Stats ConfigStore::get_stats() {
+	std::lock_guard<std::mutex> guard(data_lock);
+	return stats;
+}
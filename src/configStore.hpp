@@ -0,0 +1,98 @@
+#pragma once
+
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "scanPlanner.hpp"
+
+/*
+ * Everything the manager keeps across restarts, in one fixed layout.
+ * Fields are only ever appended; a blob of an older version loads into the
+ * prefix it covers and the rest stays zero.
+ */
+struct StoredConfig {
+	char ssid[33];
+	char password[65];
+	uint8_t auth_mode;  // WiFi::AuthMode
+	uint8_t bssid[6];	  // Last associated AP
+	uint8_t channel;
+	uint32_t lease_ip;  // Last DHCP lease, network order
+	uint32_t lease_netmask;
+	uint32_t lease_gw;
+	char dpp_key[65];  // DPP bootstrapping private key (hex), empty for a new key every boot
+	ScanPlanner::Entry planner[ScanPlanner::history_size];
+	uint32_t boots;
+	uint32_t connects;
+	uint32_t roams;
+	uint32_t disconnects;
+};
+
+/*
+ * StoredConfig as one CRC protected blob in two slots. A write goes to the
+ * slot not holding the current copy, so that a power cut during the write
+ * leaves the previous one intact, and is skipped when nothing changed.
+ * update() only marks the copy dirty; on the device the write follows
+ * after a quiet period so that bursts of changes cost one flash write,
+ * on a low priority task of its own.
+ *
+ * Backed by NVS on the device and by two files on a Linux host.
+ */
+class ConfigStore {
+    public:
+	static const uint16_t version = 1;
+
+	struct Stats {
+		int loaded_slot;  // -1 when neither slot was valid
+		uint32_t sequence;
+		uint32_t load_us;
+		uint32_t writes;
+		uint32_t unchanged;	// flush() calls that found nothing new to write
+		uint32_t errors;
+	};
+
+	// location: NVS namespace on the device, path prefix on the host.
+	// Returns 0, or an esp_err_t (device) / errno (host) of the backend.
+	static int load(const char* location);
+	static bool loaded();
+
+	static StoredConfig get();
+	template <typename F>
+	static void update(F modify) {
+		{
+			std::lock_guard<std::mutex> guard(data_lock);
+			modify(config);
+		}
+		schedule_flush();
+	}
+	// Writes now when the copy differs from the stored one
+	static int flush();
+
+	static Stats get_stats();
+
+	static uint32_t crc32(const void* data, size_t len, uint32_t crc = 0);
+
+    private:
+	ConfigStore();
+
+	struct Header {
+		uint32_t magic;
+		uint16_t version;
+		uint16_t size;	  // Of the StoredConfig that follows
+		uint32_t sequence;
+		uint32_t crc;	  // Over magic..sequence and the payload
+	};
+
+	static std::mutex data_lock;
+	static std::mutex io_lock;
+	static StoredConfig config;
+	static uint32_t stored_crc;
+	static int active_slot;
+	static Stats stats;
+	static bool is_loaded;
+
+	static void schedule_flush();
+	static int read_slot(int slot, uint8_t* buf, size_t len, size_t& read);
+	static int write_slot(int slot, const uint8_t* buf, size_t len);
+	static uint32_t blob_crc(const Header& header, const void* payload, size_t len);
+};
@@ -0,0 +1,285 @@
+#include "healthMonitor.hpp"
+#include "wifiLog.hpp"
+#include "wifiManager.hpp"
+
+#include <errno.h>
+#include <lwip/sockets.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#ifdef CONFIG_WIFI_MANAGER_HEALTH_FAILURES
+#define HEALTH_INTERVAL_MIN_MS CONFIG_WIFI_MANAGER_HEALTH_INTERVAL_MIN_MS
+#define HEALTH_INTERVAL_MAX_MS CONFIG_WIFI_MANAGER_HEALTH_INTERVAL_MAX_MS
+#define HEALTH_TIMEOUT_MS CONFIG_WIFI_MANAGER_HEALTH_TIMEOUT_MS
+#define HEALTH_FAILURES CONFIG_WIFI_MANAGER_HEALTH_FAILURES
+#else
+#define HEALTH_INTERVAL_MIN_MS 500
+#define HEALTH_INTERVAL_MAX_MS 10000
+#define HEALTH_TIMEOUT_MS 300
+#define HEALTH_FAILURES 3
+#endif
+
+#define IP_HEADER_SIZE 20
+#define PROBE_HEADER_SIZE 8  // ICMP and UDP alike
+#define PROBE_ID 0x574d	   // "WM"
+#define HEALTH_ACTION_BACKOFF_MAX 8
+
+HealthMonitor::Config HealthMonitor::config;
+StoppableTask HealthMonitor::task;
+int64_t HealthMonitor::started_us	    = 0;
+
+portMUX_TYPE HealthMonitor::lock		= portMUX_INITIALIZER_UNLOCKED;
+HealthMonitor::Stats HealthMonitor::stats = {};
+
+// Run of lost probes, only touched by the monitor task
+static uint32_t lost_run	    = 0;
+static int64_t first_lost_us  = 0;
+// While degraded, the action runs again once the run reaches next_action
+static uint32_t next_action = 0;
+static uint32_t action_gap  = 0;
+
+HealthMonitor::Config HealthMonitor::default_config() {
+	Config config		  = {};
+	config.probe		  = Probe::Icmp;
+	config.port		  = 7;
+	config.payload		  = 8;
+	config.interval_min_ms = HEALTH_INTERVAL_MIN_MS;
+	config.interval_max_ms = HEALTH_INTERVAL_MAX_MS;
+	config.timeout_ms	  = HEALTH_TIMEOUT_MS;
+	config.failures	  = HEALTH_FAILURES;
+	config.action		  = FailAction::Notify;
+	return config;
+}
+
+uint32_t HealthMonitor::detection_bound_ms(const Config &config) {
+	// Silent right after a good probe: the long interval, then every probe times out
+	return config.interval_max_ms + config.failures * config.timeout_ms + (config.failures - 1) * config.interval_min_ms;
+}
+
+esp_err_t HealthMonitor::start(const Config &config, UBaseType_t priority, BaseType_t core) {
+	if (task.running()) return ESP_ERR_INVALID_STATE;
+	if (config.failures == 0 || config.interval_min_ms == 0 || config.interval_min_ms > config.interval_max_ms) return ESP_ERR_INVALID_ARG;
+
+	HealthMonitor::config = config;
+	started_us	  = esp_timer_get_time();
+	lost_run		  = 0;
+
+	portENTER_CRITICAL(&lock);
+	stats				 = {};
+	stats.interval_ms		 = config.interval_max_ms;
+	stats.detection_bound_ms = detection_bound_ms(config);
+	portEXIT_CRITICAL(&lock);
+
+	return task.start(run, "wifi_health", 3072, priority, core);
+}
+
+void HealthMonitor::stop() {
+	task.stop();
+}
+
+HealthMonitor::Stats HealthMonitor::get_stats() {
+	portENTER_CRITICAL(&lock);
+	Stats s = stats;
+	portEXIT_CRITICAL(&lock);
+	return s;
+}
+
+static uint16_t checksum(const uint8_t *data, size_t len) {
+	uint32_t sum = 0;
+	for (size_t i = 0; i + 1 < len; i += 2) sum += (data[i] << 8) | data[i + 1];
+	if (len & 1) sum += data[len - 1] << 8;
+	while (sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+	return static_cast<uint16_t>(~sum);
+}
+
+int HealthMonitor::open_socket(const esp_ip4_addr_t &target) {
+	int sock = config.probe == Probe::Icmp ? socket(AF_INET, SOCK_RAW, IPPROTO_ICMP) : socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock < 0) return -1;
+
+	struct sockaddr_in addr = {};
+	addr.sin_family		= AF_INET;
+	addr.sin_port		= htons(config.port);
+	addr.sin_addr.s_addr	= target.addr;
+	// Raw ICMP sockets accept connect() as well, which filters replies by source
+	if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+bool HealthMonitor::probe(int sock, const esp_ip4_addr_t &target, uint16_t seq, uint32_t &rtt_us) {
+	uint8_t packet[PROBE_HEADER_SIZE + 64] = {};
+	size_t payload = config.payload < 64 ? config.payload : 64;
+	size_t len;
+	if (config.probe == Probe::Icmp) {
+		len	    = PROBE_HEADER_SIZE + payload;
+		packet[0] = 8;  // Echo request
+		packet[4] = PROBE_ID >> 8;
+		packet[5] = PROBE_ID & 0xff;
+		packet[6] = seq >> 8;
+		packet[7] = seq & 0xff;
+		uint16_t sum = checksum(packet, len);
+		packet[2]	   = sum >> 8;
+		packet[3]	   = sum & 0xff;
+	} else {
+		len	    = payload < 2 ? 2 : payload;
+		packet[0] = seq >> 8;
+		packet[1] = seq & 0xff;
+	}
+
+	int64_t sent = esp_timer_get_time();
+	if (send(sock, packet, len, 0) != static_cast<int>(len)) return false;
+
+	int64_t deadline = sent + config.timeout_ms * 1000LL;
+	uint8_t reply[IP_HEADER_SIZE + 40 + sizeof(packet)];
+	for (int64_t now = sent; now < deadline; now = esp_timer_get_time()) {
+		struct timeval tv;
+		tv.tv_sec  = (deadline - now) / 1000000;
+		tv.tv_usec = (deadline - now) % 1000000;
+		setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+		int n = recv(sock, reply, sizeof(reply), 0);
+		if (n <= 0) return false;
+
+		const uint8_t *r = reply;
+		if (config.probe == Probe::Icmp) {
+			// Raw sockets deliver the IP header too
+			size_t ihl = (reply[0] & 0x0f) * 4;
+			if (static_cast<size_t>(n) < ihl + PROBE_HEADER_SIZE) continue;
+			r = reply + ihl;
+			if (r[0] != 0 || r[4] != (PROBE_ID >> 8) || r[5] != (PROBE_ID & 0xff)) continue;
+			if (r[6] != (seq >> 8) || r[7] != (seq & 0xff)) continue;
+		} else if (n != static_cast<int>(len) || r[0] != (seq >> 8) || r[1] != (seq & 0xff)) {
+			continue;
+		}
+		rtt_us = static_cast<uint32_t>(esp_timer_get_time() - sent);
+		return true;
+	}
+	return false;
+}
+
+void HealthMonitor::record(bool ok, uint32_t rtt_us, int64_t now_us) {
+	uint32_t packet = IP_HEADER_SIZE + PROBE_HEADER_SIZE + config.payload;
+
+	portENTER_CRITICAL(&lock);
+	stats.probes++;
+	stats.bytes += ok ? 2 * packet : packet;
+	// EWMA, weight 1/8 as TCP uses for SRTT
+	stats.loss_permille = stats.loss_permille - stats.loss_permille / 8 + (ok ? 0 : 1000 / 8);
+	if (ok) {
+		stats.rtt_ewma_us = stats.rtt_ewma_us ? stats.rtt_ewma_us - stats.rtt_ewma_us / 8 + rtt_us / 8 : rtt_us;
+		uint32_t next	= stats.interval_ms * 2;
+		stats.interval_ms = next < config.interval_max_ms ? next : config.interval_max_ms;
+	} else {
+		stats.lost++;
+		stats.interval_ms = config.interval_min_ms;
+	}
+	int64_t elapsed = now_us - started_us;
+	if (elapsed > 0) stats.overhead_bps = static_cast<uint32_t>(stats.bytes * 8 * 1000000 / elapsed);
+	bool degraded = stats.degraded;
+	portEXIT_CRITICAL(&lock);
+
+	if (ok) {
+		lost_run = 0;
+		if (degraded) set_degraded(false);
+		return;
+	}
+	// The lost probe went out one timeout ago
+	if (lost_run++ == 0) first_lost_us = now_us - config.timeout_ms * 1000LL;
+	if (lost_run == config.failures && !degraded) {
+		portENTER_CRITICAL(&lock);
+		stats.last_detection_ms = static_cast<uint32_t>((now_us - first_lost_us) / 1000);
+		portEXIT_CRITICAL(&lock);
+		action_gap  = config.failures;
+		next_action = lost_run + action_gap;
+		set_degraded(true);
+	} else if (degraded && lost_run >= next_action) {
+		// The action did not bring the host back; try again after twice as many losses, up to 8 times failures
+		if (action_gap < config.failures * HEALTH_ACTION_BACKOFF_MAX) action_gap *= 2;
+		next_action = lost_run + action_gap;
+		run_action();
+	}
+}
+
+void HealthMonitor::set_degraded(bool degraded) {
+	portENTER_CRITICAL(&lock);
+	stats.degraded = degraded;
+	if (degraded) stats.degraded_count++;
+	portEXIT_CRITICAL(&lock);
+
+	WiFiEvent event	 = {};
+	event.timestamp_us = esp_timer_get_time();
+	event.type	 = degraded ? WiFiEventType::LinkDegraded : WiFiEventType::LinkRestored;
+	WiFiEvents::publish_monitor(event);
+
+	if (config.callback) config.callback(degraded, config.callback_arg);
+	if (degraded) run_action();
+}
+
+void HealthMonitor::run_action() {
+	if (config.action == FailAction::Notify) return;
+	portENTER_CRITICAL(&lock);
+	stats.actions++;
+	portEXIT_CRITICAL(&lock);
+
+	switch (config.action) {
+		case FailAction::Reassociate:
+			// WIFI_EVENT_STA_DISCONNECTED reconnects
+			esp_wifi_disconnect();
+			break;
+		case FailAction::Roam:
+			if (WiFi::roam_now() != ESP_OK) esp_wifi_disconnect();
+			break;
+		default:
+			break;
+	}
+}
+
+void HealthMonitor::run(void *arg) {
+	int sock		   = -1;
+	esp_ip4_addr_t target = {};
+	uint16_t seq	   = 0;
+
+	while (!task.stopping()) {
+		if (!WiFi::wait_for(LinkState::Up, pdMS_TO_TICKS(1000))) {
+			// A lost link is the manager's business, not a health failure; a degraded
+			// link counts its losses again from the new association
+			lost_run	  = 0;
+			next_action = action_gap;
+			if (sock >= 0) close(sock);
+			sock = -1;
+			continue;
+		}
+
+		esp_ip4_addr_t host = config.host.addr ? config.host : WiFi::get_link().ip_info.gw;
+		if (!host.addr) {
+			// Up on IPv6 alone, nothing to probe until the DHCPv4 lease arrives
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(config.interval_max_ms));
+			continue;
+		}
+		if (sock < 0 || host.addr != target.addr) {
+			if (sock >= 0) close(sock);
+			target = host;
+			sock	  = open_socket(target);
+			if (sock < 0) {
+				WIFI_LOG(HealthSocketError, errno);
+				ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(config.interval_max_ms));
+				continue;
+			}
+		}
+
+		uint32_t rtt_us = 0;
+		bool ok		= probe(sock, target, ++seq, rtt_us);
+		record(ok, rtt_us, esp_timer_get_time());
+
+		portENTER_CRITICAL(&lock);
+		uint32_t interval = stats.interval_ms;
+		portEXIT_CRITICAL(&lock);
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(interval));
+	}
+
+	if (sock >= 0) close(sock);
+	task.exit();
+}
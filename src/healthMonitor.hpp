@@ -0,0 +1,88 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_err.h>
+#include <esp_netif.h>
+
+#include "stoppableTask.hpp"
+
+/*
+ * Probes the gateway (or a configured host) while the link is up, so that a
+ * link that is associated and holds an IP but no longer forwards is noticed.
+ * The interval backs off to interval_max_ms while probes succeed and drops to
+ * interval_min_ms after the first loss; `failures` consecutive losses make
+ * the link degraded. The action runs again while losses go on, after
+ * 2, 4 and then 8 times `failures` further losses.
+ */
+class HealthMonitor {
+    public:
+	enum class Probe {
+		Icmp,  // Echo request
+		Udp,   // Datagram to an echo service (RFC 862), the reply must match
+	};
+
+	enum class FailAction {
+		Notify,	    // Event and callback only
+		Reassociate,  // Drop and rejoin the AP
+		Roam,	    // Move to another AP of the network, see WiFi::roam_now()
+	};
+
+	// Called on the monitor task; switching to another network is up to the application
+	typedef void (*degraded_callback_t)(bool degraded, void* arg);
+
+	struct Config {
+		Probe probe;
+		esp_ip4_addr_t host;  // 0 for the gateway
+		uint16_t port;	    // Udp only
+		uint16_t payload;	    // Bytes after the ICMP or UDP header
+		uint32_t interval_min_ms;
+		uint32_t interval_max_ms;
+		uint32_t timeout_ms;
+		uint8_t failures;
+		FailAction action;
+		degraded_callback_t callback;
+		void* callback_arg;
+	};
+
+	struct Stats {
+		bool degraded;
+		uint32_t probes;
+		uint32_t lost;
+		uint32_t degraded_count;
+	uint32_t actions;	 // FailAction runs, the first on degrading and the retries
+		uint32_t rtt_ewma_us;
+		uint16_t loss_permille;	 // EWMA over probes
+		uint32_t interval_ms;	 // Current probe interval
+		uint32_t detection_bound_ms;  // Worst case from the configuration
+		uint32_t last_detection_ms;	  // First lost probe to degraded, last occurrence
+		uint64_t bytes;			  // Probe traffic at IP level, both directions
+		uint32_t overhead_bps;	  // Average of the above since start
+	};
+
+	static Config default_config();
+	static esp_err_t start(const Config& config, UBaseType_t priority = 3, BaseType_t core = tskNO_AFFINITY);
+	static void stop();
+
+	static Stats get_stats();
+	// Longest time from the gateway going silent to degraded
+	static uint32_t detection_bound_ms(const Config& config);
+
+    private:
+	HealthMonitor();
+
+	static Config config;
+	static StoppableTask task;
+	static int64_t started_us;
+
+	static portMUX_TYPE lock;
+	static Stats stats;
+
+	static void run(void* arg);
+	static bool probe(int sock, const esp_ip4_addr_t& target, uint16_t seq, uint32_t& rtt_us);
+	static int open_socket(const esp_ip4_addr_t& target);
+	static void record(bool ok, uint32_t rtt_us, int64_t now_us);
+	static void set_degraded(bool degraded);
+	static void run_action();
+};
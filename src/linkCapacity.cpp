@@ -0,0 +1,127 @@
+#include "linkCapacity.hpp"
+#include "wifiManager.hpp"
+
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <lwip/stats.h>
+
+#include "telemetry.hpp"
+#include "wifiQos.hpp"
+
+static_assert(CapacityEstimator::phy_11b == Telemetry::phy_11b && CapacityEstimator::phy_11g == Telemetry::phy_11g &&
+			   CapacityEstimator::phy_11n == Telemetry::phy_11n && CapacityEstimator::phy_lr == Telemetry::phy_lr &&
+			   CapacityEstimator::phy_ht40 == Telemetry::phy_ht40,
+		    "PHY bits of the estimator and the telemetry differ");
+
+LinkCapacity::Config LinkCapacity::config;
+StoppableTask LinkCapacity::task;
+int LinkCapacity::subscription	 = -1;
+
+Seqlock<CapacityEstimator::Estimate> LinkCapacity::estimate;
+std::atomic<uint32_t> LinkCapacity::up_bytes(0);
+std::atomic<uint32_t> LinkCapacity::down_bytes(0);
+
+// Only the task touches these; lwIP's counters may be 16 bits
+static uint16_t last_xmit, last_failed;
+static uint32_t tx_packets, tx_failures;
+
+LinkCapacity::Config LinkCapacity::default_config() {
+	Config c	   = {};
+	c.estimator = CapacityEstimator::default_config();
+	c.period_ms = 1000;
+	return c;
+}
+
+esp_err_t LinkCapacity::start(const Config &config, UBaseType_t priority, BaseType_t core) {
+	if (task.running()) return ESP_ERR_INVALID_STATE;
+	if (config.period_ms == 0) return ESP_ERR_INVALID_ARG;
+
+	LinkCapacity::config = config;
+	estimate.write(CapacityEstimator::Estimate());
+
+	uint32_t mask = WIFI_EVENT_MASK(WiFiEventType::LinkUp) | WIFI_EVENT_MASK(WiFiEventType::LinkDown) | WIFI_EVENT_MASK(WiFiEventType::Roam);
+	subscription  = WiFiEvents::subscribe(on_event, nullptr, mask);
+	if (subscription < 0) return ESP_ERR_NO_MEM;
+
+	if (task.start(run, "wifi_capacity", 3072, priority, core) != ESP_OK) {
+		WiFiEvents::unsubscribe(subscription);
+		subscription = -1;
+		return ESP_ERR_NO_MEM;
+	}
+	return ESP_OK;
+}
+
+void LinkCapacity::stop() {
+	if (!task.running()) return;
+	WiFiEvents::unsubscribe(subscription);
+	subscription = -1;
+	task.stop();
+}
+
+CapacityEstimator::Estimate LinkCapacity::get() {
+	return estimate.read();
+}
+
+void LinkCapacity::add_goodput(uint32_t up, uint32_t down) {
+	up_bytes.fetch_add(up, std::memory_order_relaxed);
+	down_bytes.fetch_add(down, std::memory_order_relaxed);
+}
+
+// On the event task
+void LinkCapacity::on_event(const WiFiEvent &event, void *arg) {
+	task.notify();
+}
+
+void LinkCapacity::observe(CapacityEstimator::Observation &obs) {
+	obs.time_ms = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+
+	wifi_ap_record_t ap;
+	if (is_associated(WiFi::get_link().state) && esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+		obs.rssi = ap.rssi;
+		obs.phy	 = (ap.phy_11b ? CapacityEstimator::phy_11b : 0) | (ap.phy_11g ? CapacityEstimator::phy_11g : 0) |
+			   (ap.phy_11n ? CapacityEstimator::phy_11n : 0) | (ap.phy_lr ? CapacityEstimator::phy_lr : 0) |
+			   (ap.second != WIFI_SECOND_CHAN_NONE ? CapacityEstimator::phy_ht40 : 0);
+	}
+
+#if LWIP_STATS && LINK_STATS
+	uint16_t xmit	 = static_cast<uint16_t>(lwip_stats.link.xmit);
+	uint16_t failed = static_cast<uint16_t>(lwip_stats.link.drop + lwip_stats.link.err);
+	tx_packets += static_cast<uint16_t>(xmit - last_xmit);
+	tx_failures += static_cast<uint16_t>(failed - last_failed);
+	last_xmit	= xmit;
+	last_failed = failed;
+#endif
+	obs.tx_packets  = tx_packets;
+	obs.tx_failures = tx_failures;
+
+	obs.up_bytes   = up_bytes.load(std::memory_order_relaxed);
+	obs.down_bytes = down_bytes.load(std::memory_order_relaxed);
+	for (int ac = 0; ac < WiFiQos::categories; ac++) {
+		WiFiQos::Stats s = WiFiQos::get_stats(static_cast<WiFiQos::AccessCategory>(ac));
+		obs.up_bytes += s.bytes;
+		obs.tx_refused += s.drops;
+	}
+}
+
+void LinkCapacity::run(void *arg) {
+	CapacityEstimator estimator(config.estimator);
+#if LWIP_STATS && LINK_STATS
+	last_xmit	= static_cast<uint16_t>(lwip_stats.link.xmit);
+	last_failed = static_cast<uint16_t>(lwip_stats.link.drop + lwip_stats.link.err);
+#endif
+	tx_packets = tx_failures = 0;
+
+	while (!task.stopping()) {
+		CapacityEstimator::Observation obs = {};
+		observe(obs);
+		bool changed = estimator.update(obs);
+		CapacityEstimator::Estimate e = estimator.estimate();
+		estimate.write(e);
+		if (changed && config.callback) config.callback(e, config.callback_arg);
+
+		// A link event wakes the task early
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(config.period_ms));
+	}
+
+	task.exit();
+}
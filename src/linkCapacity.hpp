@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_err.h>
+
+#include "capacityEstimator.hpp"
+#include "linkState.hpp"
+#include "wifiEvents.hpp"
+#include "stoppableTask.hpp"
+
+/*
+ * Live uplink and downlink capacity of the station for bitrate adaptation.
+ * A small task feeds CapacityEstimator once per period with the RSSI and
+ * PHY mode of the current AP, lwIP's link counters, and the goodput sent
+ * through WiFiQos plus what the application reports with add_goodput().
+ * Link events are observed at once.
+ * get() never blocks; the callback runs on the task when an estimate moved
+ * past the hysteresis, or the link came or went.
+ */
+class LinkCapacity {
+    public:
+	typedef void (*callback_t)(const CapacityEstimator::Estimate& estimate, void* arg);
+
+	struct Config {
+		CapacityEstimator::Config estimator;
+		uint32_t period_ms;
+		callback_t callback;
+		void* callback_arg;
+	};
+
+	static Config default_config();
+	static esp_err_t start(const Config& config, UBaseType_t priority = 2, BaseType_t core = tskNO_AFFINITY);
+	static void stop();
+
+	static CapacityEstimator::Estimate get();
+	// Goodput that does not go through WiFiQos::transmit(), e.g. received stream bytes
+	static void add_goodput(uint32_t up_bytes, uint32_t down_bytes);
+
+    private:
+	LinkCapacity();
+
+	static Config config;
+	static StoppableTask task;
+	static int subscription;
+
+	static Seqlock<CapacityEstimator::Estimate> estimate;
+	static std::atomic<uint32_t> up_bytes;
+	static std::atomic<uint32_t> down_bytes;
+
+	static void run(void* arg);
+	static void on_event(const WiFiEvent& event, void* arg);
+	static void observe(CapacityEstimator::Observation& obs);
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_netif.h>
+#endif
+
+/*
+ * Sequence lock for small trivially copyable values.
+ * Readers never block the writers and retry when they raced with a write.
+ * Writers are serialized with a short critical section, so that a writer
+ * is never preempted while the sequence is odd.
+ */
+template <typename T>
+class Seqlock {
+    public:
+	Seqlock() : seq(0), value() {}
+
+	T read() const {
+		T copy;
+		for (int spins = 0;; spins++) {
+			uint32_t before = seq.load(std::memory_order_acquire);
+			if ((before & 1) == 0) {
+				memcpy(&copy, &value, sizeof(T));
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (seq.load(std::memory_order_relaxed) == before) return copy;
+			}
+#ifdef ESP_PLATFORM
+			// A writer on the other core is mid-copy; give it the CPU if this goes on
+			if (spins > 16) vTaskDelay(1);
+#endif
+		}
+	}
+
+	// Runs f(T&) on the current value as one atomic update
+	template <typename F>
+	void update(F f) {
+		lock();
+		T next = value;
+		f(next);
+		uint32_t s = seq.load(std::memory_order_relaxed);
+		seq.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		memcpy(&value, &next, sizeof(T));
+		seq.store(s + 2, std::memory_order_release);
+		unlock();
+	}
+
+	void write(const T &next) {
+		update([&](T &v) { v = next; });
+	}
+
+    private:
+	std::atomic<uint32_t> seq;
+	T value;
+
+#ifdef ESP_PLATFORM
+	portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+	void lock() { portENTER_CRITICAL(&mux); }
+	void unlock() { portEXIT_CRITICAL(&mux); }
+#else
+	std::atomic_flag busy = ATOMIC_FLAG_INIT;
+	void lock() {
+		while (busy.test_and_set(std::memory_order_acquire)) {
+		}
+	}
+	void unlock() { busy.clear(std::memory_order_release); }
+#endif
+};
+
+#ifdef ESP_PLATFORM
+enum class LinkState : uint8_t {
+	Stopped,
+	Connecting,  // Started, scanning or authenticating
+	Associated,  // Layer 2 up, no IP yet
+	Up,		   // Addresses acquired as WiFi::IpPolicy requires
+	Failed,	   // Gave up after the maximum retries
+};
+
+// Failed is declared after Up, so ordered comparisons would count it as associated
+inline bool is_associated(LinkState state) {
+	return state == LinkState::Associated || state == LinkState::Up;
+}
+
+struct LinkSnapshot {
+	LinkState state;
+	int8_t rssi;
+	uint8_t channel;
+	uint8_t bssid[6];
+	esp_netif_ip_info_t ip_info;	// Zero until DHCP assigned an address
+	esp_ip6_addr_t ip6_link_local;
+	esp_ip6_addr_t ip6_global;	// SLAAC, stateless DHCPv6 or unique local; zero until assigned
+	uint32_t generation;  // Incremented on every state change
+};
+#endif
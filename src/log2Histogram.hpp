@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Percentiles of a histogram with power of two buckets: bucket b counts values
+ * below 2^b, the last one everything longer. A percentile is the upper bound
+ * of the bucket it falls in, or overflow_value in the last bucket.
+ */
+static inline uint32_t log2_percentile(const uint32_t *histogram, int buckets, uint32_t permille, uint32_t overflow_value) {
+	uint64_t total = 0;
+	for (int b = 0; b < buckets; b++) total += histogram[b];
+	if (total == 0) return 0;
+
+	// 64 bits, as total * permille overflows once total passes 4.3 million
+	uint64_t need = (total * permille + 999) / 1000, seen = 0;
+	int b		  = 0;
+	for (; b < buckets - 1; b++) {
+		seen += histogram[b];
+		if (seen >= need) break;
+	}
+	return b < buckets - 1 ? (1u << b) : overflow_value;
+}
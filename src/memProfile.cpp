@@ -0,0 +1,164 @@
+#include "memProfile.hpp"
+
+#include <stdio.h>
+
+#include <atomic>
+
+#ifdef ESP_PLATFORM
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "wifiLog.hpp"
+#endif
+
+#ifdef ESP_PLATFORM
+bool MemProfile::enabled = MEM_PROFILE;
+#else
+bool MemProfile::enabled = false;
+#endif
+MemProfile::Record MemProfile::records[MemProfile::phases];
+uint32_t MemProfile::budgets[MemProfile::phases] = {
+    0,				   // Netif
+    MEM_BUDGET_WIFI_INIT,  // WifiInit
+    MEM_BUDGET_DPP,		   // DppInit
+    MEM_BUDGET_DPP,		   // DppBootstrap
+    0,				   // WifiStart
+    0,				   // Connect
+    MEM_BUDGET_QR,		   // QrEncode
+};
+
+// Fed by the host allocator hook only
+static std::atomic<size_t> used(0);
+static std::atomic<size_t> peak(0);
+static std::atomic<uint32_t> allocations(0);
+
+static void raise_peak(size_t value) {
+	size_t current = peak.load(std::memory_order_relaxed);
+	while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+	}
+}
+
+MemProfile::Scope::Scope(Phase phase) : phase(phase), active(enabled) {
+	if (!active) return;
+#ifdef ESP_PLATFORM
+	free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+	min_before  = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+#else
+	free_before = 0;
+	min_before  = 0;
+#endif
+	// The phase's peak starts over here; the enclosing phase gets it back in the destructor
+	used_before		= used.load(std::memory_order_relaxed);
+	outer_peak		= peak.exchange(used_before, std::memory_order_relaxed);
+	allocations_before = allocations.load(std::memory_order_relaxed);
+}
+
+MemProfile::Scope::~Scope() {
+	if (!active) return;
+	Record& r = records[static_cast<int>(phase)];
+
+	size_t top = peak.load(std::memory_order_relaxed);
+	raise_peak(outer_peak);
+
+	int32_t delta;
+	uint32_t peak_bytes;
+#ifdef ESP_PLATFORM
+	uint32_t free_after = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+	uint32_t min_after  = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+	delta			= static_cast<int32_t>(free_before - free_after);
+	// A new low was reached inside the phase; otherwise only the kept bytes are known
+	peak_bytes = min_after < min_before ? free_before - min_after : (delta > 0 ? delta : 0);
+
+	uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+	if (r.runs == 0 || largest < r.largest_free_block) r.largest_free_block = largest;
+	r.min_free = min_after;
+
+	uint32_t stack = uxTaskGetStackHighWaterMark(nullptr);
+	if (r.runs == 0 || stack < r.stack_free) r.stack_free = stack;
+	// Looked up each time, the loop may have been deleted and created again
+	TaskHandle_t event_task = xTaskGetHandle("sys_evt");
+	if (event_task) {
+		uint32_t event_stack = uxTaskGetStackHighWaterMark(event_task);
+		if (r.event_stack_free == 0 || event_stack < r.event_stack_free) r.event_stack_free = event_stack;
+	}
+#else
+	delta	   = static_cast<int32_t>(used.load(std::memory_order_relaxed) - used_before);
+	peak_bytes = static_cast<uint32_t>(top - used_before);
+	r.allocations = allocations.load(std::memory_order_relaxed) - allocations_before;
+#endif
+	(void)top;
+
+	r.runs++;
+	r.heap_delta = delta;
+	if (peak_bytes > r.peak_bytes) r.peak_bytes = peak_bytes;
+	uint32_t budget = budgets[static_cast<int>(phase)];
+	if (budget && peak_bytes > budget) {
+		r.over_budget++;
+#ifdef ESP_PLATFORM
+		WIFI_LOG(MemOverBudget, static_cast<int>(phase), peak_bytes, budget);
+#endif
+	}
+}
+
+void MemProfile::enable(bool on) {
+	enabled = on;
+}
+
+void MemProfile::set_budget(Phase phase, uint32_t bytes) {
+	budgets[static_cast<int>(phase)] = bytes;
+}
+
+MemProfile::Record MemProfile::get(Phase phase) {
+	Record r = records[static_cast<int>(phase)];
+	r.budget = budgets[static_cast<int>(phase)];
+	return r;
+}
+
+bool MemProfile::within_budget() {
+	for (const Record& r : records) {
+		if (r.over_budget) return false;
+	}
+	return true;
+}
+
+void MemProfile::reset() {
+	for (Record& r : records) r = Record();
+}
+
+const char* MemProfile::name(Phase phase) {
+	switch (phase) {
+		case Phase::Netif: return "netif";
+		case Phase::WifiInit: return "wifi_init";
+		case Phase::DppInit: return "dpp_init";
+		case Phase::DppBootstrap: return "dpp_bootstrap";
+		case Phase::WifiStart: return "wifi_start";
+		case Phase::Connect: return "connect";
+		case Phase::QrEncode: return "qr_encode";
+	}
+	return "?";
+}
+
+int MemProfile::report(writer_t writer, void* arg) {
+	for (int i = 0; i < phases; i++) {
+		Record r = get(static_cast<Phase>(i));
+		if (!r.runs) continue;
+		char line[192];
+		int len = snprintf(line, sizeof(line),
+					    "%-13s runs %u delta %d peak %u budget %u over %u largest %u min_free %u stack %u event_stack %u allocs %u\n",
+					    name(static_cast<Phase>(i)), r.runs, r.heap_delta, r.peak_bytes, r.budget, r.over_budget,
+					    r.largest_free_block, r.min_free, r.stack_free, r.event_stack_free, r.allocations);
+		if (len < 0) return -1;
+		int err = writer(line, static_cast<size_t>(len) < sizeof(line) ? len : sizeof(line) - 1, arg);
+		if (err) return err;
+	}
+	return 0;
+}
+
+void MemProfile::on_alloc(size_t bytes) {
+	raise_peak(used.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+	allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MemProfile::on_free(size_t bytes) {
+	used.fetch_sub(bytes, std::memory_order_relaxed);
+}
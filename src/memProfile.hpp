@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef CONFIG_WIFI_MANAGER_MEM_PROFILE
+#define MEM_PROFILE true
+#else
+#define MEM_PROFILE false
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_MEM_BUDGET_WIFI_INIT
+#define MEM_BUDGET_WIFI_INIT CONFIG_WIFI_MANAGER_MEM_BUDGET_WIFI_INIT
+#else
+#define MEM_BUDGET_WIFI_INIT 0
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_MEM_BUDGET_DPP
+#define MEM_BUDGET_DPP CONFIG_WIFI_MANAGER_MEM_BUDGET_DPP
+#else
+#define MEM_BUDGET_DPP 0
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_MEM_BUDGET_QR
+#define MEM_BUDGET_QR CONFIG_WIFI_MANAGER_MEM_BUDGET_QR
+#else
+#define MEM_BUDGET_QR 8192
+#endif
+
+/*
+ * Heap and stack use of the setup phases: each run of a phase records how
+ * much heap it kept and peaked at, the largest free block and the stack
+ * high-water marks of the caller and of the default event loop task.
+ *
+ * On the device the peak comes from the heap's minimum free size, so it is
+ * exact when the phase sets a new low and a lower bound otherwise. Hosts have
+ * no heap to ask: a test installs operator new/delete that call on_alloc() and
+ * on_free(), and then the peak and allocation count are exact.
+ * A run whose peak exceeds the phase's budget is counted, and logged on the
+ * device. Phases may nest but are expected to run on one task at a time.
+ */
+class MemProfile {
+    public:
+	enum class Phase : uint8_t {
+		Netif,		// esp_netif_init(), the default event loop and the interfaces
+		WifiInit,		// esp_wifi_init()
+		DppInit,		// esp_supp_dpp_init()
+		DppBootstrap,	// esp_supp_dpp_bootstrap_gen()
+		WifiStart,		// Mode, configuration and esp_wifi_start()
+		Connect,		// esp_wifi_start() to connected or failed
+		QrEncode,		// QrCode::encodeText()
+	};
+	static const int phases = static_cast<int>(Phase::QrEncode) + 1;
+
+	struct Record {
+		uint32_t runs;
+		int32_t heap_delta;		  // Bytes the last run kept, negative when it freed more
+		uint32_t peak_bytes;		  // Most bytes in use above the start of a run, worst run
+		uint32_t largest_free_block;  // After a run, smallest seen; device only
+		uint32_t min_free;		  // Lowest free heap since boot, after the last run; device only
+		uint32_t stack_free;		  // Caller's stack high-water mark in bytes, smallest seen
+		uint32_t event_stack_free;	  // Same for the "sys_evt" task, 0 before it exists
+		uint32_t allocations;	  // Last run; host hook only
+		uint32_t budget;		  // Peak bytes, 0 for none
+		uint32_t over_budget;	  // Runs whose peak exceeded the budget
+	};
+
+	// Measures a phase for the lifetime of the object
+	class Scope {
+	    public:
+		explicit Scope(Phase phase);
+		~Scope();
+
+	    private:
+		Phase phase;
+		bool active;
+		uint32_t free_before;
+		uint32_t min_before;
+		size_t used_before;
+		size_t outer_peak;
+		uint32_t allocations_before;
+	};
+
+	// Returns 0 to go on
+	typedef int (*writer_t)(const void* data, size_t len, void* arg);
+
+	// On by default with CONFIG_WIFI_MANAGER_MEM_PROFILE, off on hosts
+	static void enable(bool on);
+	static void set_budget(Phase phase, uint32_t bytes);
+	static Record get(Phase phase);
+	// False once any phase went over its budget
+	static bool within_budget();
+	// Clears the records, keeps the budgets
+	static void reset();
+	static const char* name(Phase phase);
+	// One text line per phase that ran
+	static int report(writer_t writer, void* arg);
+
+	// Host allocator hook
+	static void on_alloc(size_t bytes);
+	static void on_free(size_t bytes);
+
+    private:
+	MemProfile();
+
+	static bool enabled;
+	static Record records[phases];
+	static uint32_t budgets[phases];
+};
@@ -0,0 +1,104 @@
+#include "pcapFormat.hpp"
+
+#include <string.h>
+
+// Radiotap fields present: TSFT, flags, rate, channel, antenna signal (dBm), MCS
+#define RADIOTAP_PRESENT ((1u << 0) | (1u << 1) | (1u << 2) | (1u << 3) | (1u << 5) | (1u << 19))
+
+static const uint8_t dpp_oui[] = {0x50, 0x6f, 0x9a, 0x1a};  // Wi-Fi Alliance, DPP
+static const uint8_t eapol_snap[] = {0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00, 0x88, 0x8e};
+
+static void put16(uint8_t *p, uint16_t v) {
+	p[0] = static_cast<uint8_t>(v);
+	p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+	put16(p, static_cast<uint16_t>(v));
+	put16(p + 2, static_cast<uint16_t>(v >> 16));
+}
+
+static uint32_t classify_action(const uint8_t *body, size_t len) {
+	if (len >= 1 && body[0] == 4) {  // Public action
+		if (len >= 6 && body[1] == 9 && memcmp(body + 2, dpp_oui, sizeof(dpp_oui)) == 0) return PcapFormat::dpp;
+		if (len >= 2 && body[1] >= 10 && body[1] <= 13) return PcapFormat::dpp;  // GAS, which carries the DPP configuration
+	}
+	return PcapFormat::action;
+}
+
+uint32_t PcapFormat::classify(const uint8_t *frame, size_t len) {
+	if (len < 10) return 0;
+	uint8_t type	 = (frame[0] >> 2) & 3;
+	uint8_t subtype = frame[0] >> 4;
+	uint8_t flags	 = frame[1];
+
+	if (type == 1) return control;
+	if (type == 0) {
+		if (len < 24) return 0;
+		switch (subtype) {
+			case 0:
+			case 1:
+			case 2:
+			case 3: return assoc;
+			case 4:
+			case 5: return probe;
+			case 8: return beacon;
+			case 10:
+			case 12: return deauth;
+			case 11: return auth;
+			case 13:
+			case 14: return classify_action(frame + 24, len - 24);
+			default: return action;
+		}
+	}
+	if (type != 2) return 0;
+
+	// Address 4 with both DS bits, QoS control, and HT control on QoS frames with the order bit
+	size_t header = 24;
+	if ((flags & 0x03) == 0x03) header += 6;
+	if (subtype & 0x08) {
+		header += 2;
+		if (flags & 0x80) header += 4;
+	}
+	bool is_protected = flags & 0x40;
+	if (!is_protected && len >= header + sizeof(eapol_snap) && memcmp(frame + header, eapol_snap, sizeof(eapol_snap)) == 0) return eapol;
+	return data;
+}
+
+size_t PcapFormat::file_header(uint8_t *out, uint32_t snaplen) {
+	put32(out, magic);
+	put16(out + 4, 2);	// Version 2.4
+	put16(out + 6, 4);
+	put32(out + 8, 0);	// GMT offset
+	put32(out + 12, 0);	// Timestamp accuracy
+	put32(out + 16, snaplen + radiotap_size);
+	put32(out + 20, linktype_radiotap);
+	return file_header_size;
+}
+
+size_t PcapFormat::record_header(uint8_t *out, const Radio &radio, size_t captured, size_t original) {
+	put32(out, static_cast<uint32_t>(radio.time_us / 1000000));
+	put32(out + 4, static_cast<uint32_t>(radio.time_us % 1000000));
+	put32(out + 8, static_cast<uint32_t>(captured + radiotap_size));
+	put32(out + 12, static_cast<uint32_t>(original + radiotap_size));
+
+	uint8_t *rt = out + 16;
+	memset(rt, 0, radiotap_size);
+	put16(rt + 2, radiotap_size);
+	put32(rt + 4, RADIOTAP_PRESENT);
+	put32(rt + 8, static_cast<uint32_t>(radio.time_us));
+	put32(rt + 12, static_cast<uint32_t>(radio.time_us >> 32));
+	// rt[16]: flags, no FCS in the frame
+	rt[17]	    = radio.ht ? 0 : radio.rate;
+	uint16_t mhz = radio.channel == 14 ? 2484 : static_cast<uint16_t>(2407 + 5 * radio.channel);
+	bool cck	    = !radio.ht && (radio.rate == 2 || radio.rate == 4 || radio.rate == 11 || radio.rate == 22);  // 802.11b rates
+	put16(rt + 18, mhz);
+	put16(rt + 20, 0x0080 | (cck ? 0x0020 : 0x0040));	// 2 GHz, CCK or OFDM
+	rt[22] = static_cast<uint8_t>(radio.rssi);
+	if (radio.ht) {
+		rt[23] = 0x07;	// Bandwidth, MCS index and guard interval known
+		rt[24] = static_cast<uint8_t>((radio.ht40 ? 1 : 0) | (radio.short_gi ? 0x04 : 0));
+		rt[25] = radio.mcs;
+	}
+	return record_header_size;
+}
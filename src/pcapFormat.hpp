@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 802.11 frame classes and the pcap file layout (LINKTYPE_IEEE802_11_RADIOTAP)
+ * for WiFiCapture, free of driver calls so that tools/pcap_synth can check
+ * them on synthetic frames.
+ * Every record carries the same radiotap header: TSF (the capture time),
+ * flags, legacy rate, channel, signal and MCS. Frames are stored without
+ * their FCS. All fields are written little-endian.
+ */
+class PcapFormat {
+    public:
+	// classify() results, combined into capture filters
+	static const uint32_t beacon  = 1 << 0;
+	static const uint32_t probe	  = 1 << 1;  // Request and response
+	static const uint32_t auth	  = 1 << 2;
+	static const uint32_t assoc	  = 1 << 3;  // (Re)association request and response
+	static const uint32_t deauth  = 1 << 4;  // And disassociation
+	static const uint32_t action  = 1 << 5;  // Action frames other than DPP
+	static const uint32_t dpp	  = 1 << 6;  // DPP public action frames and the GAS configuration exchange
+	static const uint32_t eapol	  = 1 << 7;  // Unprotected data with the EAPOL ethertype
+	static const uint32_t data	  = 1 << 8;  // Other data
+	static const uint32_t control = 1 << 9;
+	// Everything that happens between scan and an established link, except beacons
+	static const uint32_t connect = probe | auth | assoc | deauth | dpp | eapol;
+
+	static const uint32_t magic		 = 0xa1b2c3d4;  // Microsecond timestamps
+	static const uint32_t linktype_radiotap = 127;
+	static const size_t file_header_size	 = 24;
+	static const size_t radiotap_size	 = 26;
+	static const size_t record_header_size = 16 + radiotap_size;
+
+	struct Radio {
+		uint64_t time_us;
+		int8_t rssi;
+		uint8_t channel;
+		uint8_t rate;  // Legacy rate in 500 kbit/s units, 0 for HT
+		uint8_t mcs;   // HT only
+		bool ht;
+		bool ht40;
+		bool short_gi;
+	};
+
+	// One class bit, 0 for a frame too short to tell
+	static uint32_t classify(const uint8_t* frame, size_t len);
+
+	static size_t file_header(uint8_t* out, uint32_t snaplen);
+	// Record header and radiotap header; the captured bytes follow
+	static size_t record_header(uint8_t* out, const Radio& radio, size_t captured, size_t original);
+
+    private:
+	PcapFormat();
+};
@@ -0,0 +1,183 @@
+#include "portal.hpp"
+#include "wifiManager.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+
+#ifdef CONFIG_WIFI_MANAGER_PORTAL
+// Linked in by target_add_binary_data() in CMakeLists.txt
+extern const uint8_t portal_asset_start[] asm("_binary_portal_html_gz_start");
+extern const uint8_t portal_asset_end[] asm("_binary_portal_html_gz_end");
+#endif
+
+// ssid=<32 bytes>&password=<63 bytes> with every byte escaped as %XX, e.g. UTF-8 SSIDs
+#define PORTAL_BODY_MAX (5 + 32 * 3 + 10 + 63 * 3)
+
+httpd_handle_t Portal::server = nullptr;
+portMUX_TYPE Portal::lock	= portMUX_INITIALIZER_UNLOCKED;
+Portal::Stats Portal::stats	= {};
+
+esp_err_t Portal::start() {
+#ifdef CONFIG_WIFI_MANAGER_PORTAL
+	if (server) return ESP_ERR_INVALID_STATE;
+
+	httpd_config_t config   = HTTPD_DEFAULT_CONFIG();
+	config.max_uri_handlers = 3;
+	config.max_open_sockets = 3;
+	config.lru_purge_enable = true;
+
+	size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+	esp_err_t err	    = httpd_start(&server, &config);
+	if (err) return err;
+
+	static const httpd_uri_t handlers[] = {
+		{"/", HTTP_GET, page, nullptr},
+		{"/connect", HTTP_POST, connect, nullptr},
+		{"/status", HTTP_GET, status, nullptr},
+	};
+	for (const httpd_uri_t &handler : handlers) httpd_register_uri_handler(server, &handler);
+
+	size_t free_after = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+	portENTER_CRITICAL(&lock);
+	stats			= {};
+	stats.asset_bytes = static_cast<uint32_t>(portal_asset_end - portal_asset_start);
+	stats.heap_bytes  = free_before > free_after ? static_cast<uint32_t>(free_before - free_after) : 0;
+	stats.stack_bytes = static_cast<uint32_t>(config.stack_size);
+	portEXIT_CRITICAL(&lock);
+	return ESP_OK;
+#else
+	return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void Portal::stop() {
+	if (!server) return;
+	httpd_stop(server);
+	server = nullptr;
+}
+
+bool Portal::running() {
+	return server != nullptr;
+}
+
+Portal::Stats Portal::get_stats() {
+	portENTER_CRITICAL(&lock);
+	Stats s = stats;
+	portEXIT_CRITICAL(&lock);
+	return s;
+}
+
+void Portal::record(int64_t started_us) {
+	uint32_t us = static_cast<uint32_t>(esp_timer_get_time() - started_us);
+	portENTER_CRITICAL(&lock);
+	stats.requests++;
+	stats.last_us = us;
+	if (us > stats.max_us) stats.max_us = us;
+	stats.total_us += us;
+	portEXIT_CRITICAL(&lock);
+}
+
+esp_err_t Portal::page(httpd_req_t *req) {
+#ifdef CONFIG_WIFI_MANAGER_PORTAL
+	int64_t started = esp_timer_get_time();
+	httpd_resp_set_type(req, "text/html");
+	httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+	// Sent from the flash mapped buffer, no copy on the heap
+	esp_err_t err = httpd_resp_send(req, reinterpret_cast<const char *>(portal_asset_start), portal_asset_end - portal_asset_start);
+	record(started);
+	return err;
+#else
+	return ESP_FAIL;
+#endif
+}
+
+static int hex_digit(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// Decodes the value of key from an application/x-www-form-urlencoded body; false when absent or too long
+static bool form_value(const char *body, const char *key, char *out, size_t out_len) {
+	size_t key_len = strlen(key);
+	for (const char *p = body; p; p = strchr(p, '&') ? strchr(p, '&') + 1 : nullptr) {
+		if (strncmp(p, key, key_len) != 0 || p[key_len] != '=') continue;
+
+		size_t n = 0;
+		for (p += key_len + 1; *p && *p != '&'; p++) {
+			char c = *p;
+			if (c == '+') {
+				c = ' ';
+			} else if (c == '%') {
+				int hi = hex_digit(p[1]), lo = hi < 0 ? -1 : hex_digit(p[2]);
+				if (lo < 0) return false;
+				c = static_cast<char>(hi << 4 | lo);
+				p += 2;
+			}
+			if (n + 1 >= out_len) return false;
+			out[n++] = c;
+		}
+		out[n] = 0;
+		return true;
+	}
+	return false;
+}
+
+esp_err_t Portal::connect(httpd_req_t *req) {
+	int64_t started = esp_timer_get_time();
+	char body[PORTAL_BODY_MAX + 1];
+	if (req->content_len > PORTAL_BODY_MAX) {
+		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, nullptr);
+		return ESP_FAIL;
+	}
+
+	size_t received = 0;
+	while (received < req->content_len) {
+		int n = httpd_req_recv(req, body + received, req->content_len - received);
+		if (n == HTTPD_SOCK_ERR_TIMEOUT) continue;
+		if (n <= 0) return ESP_FAIL;
+		received += n;
+	}
+	body[received] = 0;
+
+	char ssid[33], password[64] = "";
+	if (!form_value(body, "ssid", ssid, sizeof(ssid)) || !ssid[0] ||
+	    (strstr(body, "password=") && !form_value(body, "password", password, sizeof(password)))) {
+		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, nullptr);
+		return ESP_FAIL;
+	}
+
+	// The AP stays up while the station tries; the page polls /status for the outcome
+	esp_err_t err = WiFi::provision(ssid, password);
+	memset(password, 0, sizeof(password));
+	memset(body, 0, sizeof(body));
+	if (err) {
+		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, nullptr);
+		return ESP_FAIL;
+	}
+	httpd_resp_set_status(req, "202 Accepted");
+	err = httpd_resp_send(req, nullptr, 0);
+	record(started);
+	return err;
+}
+
+esp_err_t Portal::status(httpd_req_t *req) {
+	static const char *const names[] = {"stopped", "connecting", "associated", "up", "failed"};
+	int64_t started = esp_timer_get_time();
+
+	LinkSnapshot link = WiFi::get_link();
+	char json[64];
+	const uint8_t *ip = reinterpret_cast<const uint8_t *>(&link.ip_info.ip.addr);
+	int len		   = snprintf(json, sizeof(json), "{\"state\":\"%s\",\"ip\":\"%u.%u.%u.%u\"}",
+						 names[static_cast<int>(link.state)], ip[0], ip[1], ip[2], ip[3]);
+	httpd_resp_set_type(req, "application/json");
+	httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+	esp_err_t err = httpd_resp_send(req, json, len);
+	record(started);
+	return err;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+#include <esp_err.h>
+#include <esp_http_server.h>
+
+/*
+ * Provisioning page for phones without DPP, served on the SoftAP that
+ * WiFi::wait_portal() brings up next to the station.
+ *   GET  /         The page, gzipped at build time and sent straight from flash
+ *   POST /connect  ssid and password, form encoded; tried at once by the station
+ *   GET  /status   {"state": ..., "ip": ...} of the station
+ * Needs CONFIG_WIFI_MANAGER_PORTAL, which embeds the page.
+ */
+class Portal {
+    public:
+	struct Stats {
+		uint32_t requests;
+		uint32_t last_us;	  // Handler entry to the last byte handed to the socket
+		uint32_t max_us;
+		uint64_t total_us;
+		uint32_t asset_bytes;  // The gzipped page, in flash
+		uint32_t heap_bytes;   // Taken by the running server
+		uint32_t stack_bytes;
+	};
+
+	static esp_err_t start();
+	static void stop();
+	static bool running();
+	static Stats get_stats();
+
+    private:
+	Portal();
+
+	static httpd_handle_t server;
+	static portMUX_TYPE lock;
+	static Stats stats;
+
+	static void record(int64_t started_us);
+	static esp_err_t page(httpd_req_t* req);
+	static esp_err_t connect(httpd_req_t* req);
+	static esp_err_t status(httpd_req_t* req);
+};
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "qrcodegen.hpp"
+
+#if __cplusplus < 201402L
+#error "qrStatic.hpp evaluates the encoder with C++14 constexpr; build the including source with -std=gnu++14 or later"
+#endif
+
+namespace qrcodegen {
+
+/*
+ * QrCode::encodeText() run by the compiler, for texts fixed at build time
+ * such as a product's setup or support URL. It follows the runtime encoder
+ * step by step (byte segment, padding, RS blocks, placement, mask penalty),
+ * so the symbol is the same module for module. The result is a packed grid;
+ * defined at namespace scope or as a static constexpr it sits in flash with
+ * the other constants and costs no cycles or heap at run time.
+ *
+ *   static constexpr qrcodegen::StaticQrCode support = qrcodegen::StaticQrCode::encode("https://example.com/help");
+ *   if (support.getModule(x, y)) ...
+ */
+class StaticQrCode final {
+    public:
+	static constexpr int version = QrCode::version;
+	static constexpr int size	 = QrCode::size;
+	// Longest text a byte segment can carry at this version and ECC level
+	static constexpr int capacity = ((((16 * version + 128) * version + 64 - 25) / 8 - 18 * 2) * 8 - 4 - 8) / 8;
+
+	template <size_t N>
+	static constexpr StaticQrCode encode(const char (&text)[N]) {
+		static_assert(N - 1 <= capacity, "text does not fit the device's QR version");
+		return encode(text, N - 1);
+	}
+	// Any text, also at run time; stops at the terminator, max_len or capacity, whichever comes first
+	static constexpr StaticQrCode encode(const char* text, size_t max_len) {
+		Grid grid = {};
+		draw_function_patterns(grid);
+		Codewords data = encode_data(text, max_len);
+		draw_codewords(grid, add_ecc_and_interleave(data));
+
+		// Mask choice as in the QrCode constructor: the first lowest penalty wins
+		int mask	    = 0;
+		long lowest = -1;
+		for (int m = 0; m < 8; m++) {
+			Grid trial = grid;
+			apply_mask(trial, m);
+			draw_format_bits(trial, m);
+			long penalty = penalty_score(trial);
+			if (lowest < 0 || penalty < lowest) {
+				mask   = m;
+				lowest = penalty;
+			}
+		}
+		apply_mask(grid, mask);
+		draw_format_bits(grid, mask);
+
+		StaticQrCode qr;
+		qr.mask_ = mask;
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				int i = y * size + x;
+				if (grid.dark[y][x]) qr.bits[i >> 3] |= static_cast<uint8_t>(1 << (i & 7));
+			}
+		}
+		return qr;
+	}
+
+	constexpr bool getModule(int x, int y) const {
+		return 0 <= x && x < size && 0 <= y && y < size && (bits[(y * size + x) >> 3] >> ((y * size + x) & 7) & 1);
+	}
+	constexpr int getMask() const { return mask_; }
+
+	// FNV-1a over the modules in row order, one byte per module, and the mask
+	constexpr uint32_t hash() const {
+		uint32_t h = 2166136261u;
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) h = (h ^ (getModule(x, y) ? 1u : 0u)) * 16777619u;
+		}
+		return (h ^ static_cast<uint32_t>(mask_)) * 16777619u;
+	}
+
+    private:
+	static constexpr int ecc_per_block  = 18;  // Ecc::LOW at version 6, as in QrCode
+	static constexpr int blocks		  = 2;
+	static constexpr int raw_codewords  = ((16 * version + 128) * version + 64 - 25) / 8;
+	static constexpr int data_codewords = raw_codewords - ecc_per_block * blocks;
+
+	struct Grid {
+		bool dark[size][size];
+		bool function[size][size];
+	};
+
+	struct Codewords {
+		uint8_t bytes[raw_codewords];
+	};
+
+	uint8_t bits[(size * size + 7) / 8];
+	int mask_;
+
+	constexpr StaticQrCode() : bits(), mask_(0) {}
+
+	static constexpr void set_function(Grid& g, int x, int y, bool dark) {
+		g.dark[y][x]	   = dark;
+		g.function[y][x] = true;
+	}
+
+	static constexpr int abs(int v) { return v < 0 ? -v : v; }
+	static constexpr int max(int a, int b) { return a < b ? b : a; }
+
+	static constexpr void draw_format_bits(Grid& g, int mask) {
+		int data = 1 << 3 | mask;
+		int rem  = data;
+		for (int i = 0; i < 10; i++) rem = (rem << 1) ^ ((rem >> 9) * 0x537);
+		int bits = (data << 10 | rem) ^ 0x5412;
+
+		for (int i = 0; i <= 5; i++) set_function(g, 8, i, bits >> i & 1);
+		set_function(g, 8, 7, bits >> 6 & 1);
+		set_function(g, 8, 8, bits >> 7 & 1);
+		set_function(g, 7, 8, bits >> 8 & 1);
+		for (int i = 9; i < 15; i++) set_function(g, 14 - i, 8, bits >> i & 1);
+
+		for (int i = 0; i < 8; i++) set_function(g, size - 1 - i, 8, bits >> i & 1);
+		for (int i = 8; i < 15; i++) set_function(g, 8, size - 15 + i, bits >> i & 1);
+		set_function(g, 8, size - 8, true);
+	}
+
+	static constexpr void draw_function_patterns(Grid& g) {
+		for (int i = 0; i < size; i++) {
+			set_function(g, 6, i, i % 2 == 0);
+			set_function(g, i, 6, i % 2 == 0);
+		}
+
+		const int finders[3][2] = {{3, 3}, {size - 4, 3}, {3, size - 4}};
+		for (const auto& f : finders) {
+			for (int dy = -4; dy <= 4; dy++) {
+				for (int dx = -4; dx <= 4; dx++) {
+					int dist = max(abs(dx), abs(dy));
+					int x = f[0] + dx, y = f[1] + dy;
+					if (0 <= x && x < size && 0 <= y && y < size) set_function(g, x, y, dist != 2 && dist != 4);
+				}
+			}
+		}
+
+		// Alignment positions are {6, size - 7} up to version 6; only the one off the finder corners is drawn
+		for (int dy = -2; dy <= 2; dy++) {
+			for (int dx = -2; dx <= 2; dx++) set_function(g, size - 7 + dx, size - 7 + dy, max(abs(dx), abs(dy)) != 1);
+		}
+
+		draw_format_bits(g, 0);
+	}
+
+	// Lambdas are not constexpr before C++17
+	static constexpr void append_bits(Codewords& c, int& bit, uint32_t value, int count) {
+		for (int i = count - 1; i >= 0; i--, bit++) {
+			if (value >> i & 1) c.bytes[bit >> 3] |= static_cast<uint8_t>(0x80 >> (bit & 7));
+		}
+	}
+
+	static constexpr Codewords encode_data(const char* text, size_t max_len) {
+		int len = 0;
+		while (len < capacity && static_cast<size_t>(len) < max_len && text[len] != '\0') len++;
+
+		Codewords c = {};
+		int bit	    = 0;
+		append_bits(c, bit, 0x4, 4);  // Byte mode
+		append_bits(c, bit, static_cast<uint32_t>(len), 8);
+		for (int i = 0; i < len; i++) append_bits(c, bit, static_cast<uint8_t>(text[i]), 8);
+
+		// Terminator and padding to a byte are zero bits
+		int capacity_bits = data_codewords * 8;
+		bit += capacity_bits - bit < 4 ? capacity_bits - bit : 4;
+		bit += (8 - bit % 8) % 8;
+		for (uint8_t pad = 0xEC; bit < capacity_bits; pad ^= 0xEC ^ 0x11) append_bits(c, bit, pad, 8);
+		return c;
+	}
+
+	static constexpr uint8_t gf_multiply(uint8_t x, uint8_t y) {
+		int z = 0;
+		for (int i = 7; i >= 0; i--) {
+			z = (z << 1) ^ ((z >> 7) * 0x11D);
+			z ^= ((y >> i) & 1) * x;
+		}
+		return static_cast<uint8_t>(z);
+	}
+
+	static constexpr Codewords add_ecc_and_interleave(const Codewords& data) {
+		uint8_t divisor[ecc_per_block] = {};
+		divisor[ecc_per_block - 1]	 = 1;
+		uint8_t root			 = 1;
+		for (int i = 0; i < ecc_per_block; i++) {
+			for (int j = 0; j < ecc_per_block; j++) {
+				divisor[j] = gf_multiply(divisor[j], root);
+				if (j + 1 < ecc_per_block) divisor[j] ^= divisor[j + 1];
+			}
+			root = gf_multiply(root, 0x02);
+		}
+
+		const int short_blocks = blocks - raw_codewords % blocks;
+		const int short_len	   = raw_codewords / blocks;  // Data and ECC of a short block
+		uint8_t block[blocks][short_len + 1] = {};
+		for (int b = 0, k = 0; b < blocks; b++) {
+			int data_len = short_len - ecc_per_block + (b < short_blocks ? 0 : 1);
+			uint8_t ecc[ecc_per_block] = {};
+			for (int i = 0; i < data_len; i++, k++) {
+				uint8_t factor = data.bytes[k] ^ ecc[0];
+				for (int j = 0; j + 1 < ecc_per_block; j++) ecc[j] = ecc[j + 1];
+				ecc[ecc_per_block - 1] = 0;
+				for (int j = 0; j < ecc_per_block; j++) ecc[j] ^= gf_multiply(divisor[j], factor);
+				block[b][i] = data.bytes[k];
+			}
+			// Short blocks keep a gap at the long blocks' last data byte
+			for (int j = 0; j < ecc_per_block; j++) block[b][short_len + 1 - ecc_per_block + j] = ecc[j];
+		}
+
+		Codewords result = {};
+		int n		     = 0;
+		for (int i = 0; i < short_len + 1; i++) {
+			for (int b = 0; b < blocks; b++) {
+				if (i != short_len - ecc_per_block || b >= short_blocks) result.bytes[n++] = block[b][i];
+			}
+		}
+		return result;
+	}
+
+	static constexpr void draw_codewords(Grid& g, const Codewords& data) {
+		int i = 0;
+		for (int right = size - 1; right >= 1; right -= 2) {
+			if (right == 6) right = 5;
+			for (int vert = 0; vert < size; vert++) {
+				for (int j = 0; j < 2; j++) {
+					int x	    = right - j;
+					bool upward = ((right + 1) & 2) == 0;
+					int y	    = upward ? size - 1 - vert : vert;
+					if (!g.function[y][x] && i < raw_codewords * 8) {
+						g.dark[y][x] = data.bytes[i >> 3] >> (7 - (i & 7)) & 1;
+						i++;
+					}
+				}
+			}
+		}
+	}
+
+	static constexpr bool mask_bit(int mask, int x, int y) {
+		switch (mask) {
+			case 0: return (x + y) % 2 == 0;
+			case 1: return y % 2 == 0;
+			case 2: return x % 3 == 0;
+			case 3: return (x + y) % 3 == 0;
+			case 4: return (x / 3 + y / 2) % 2 == 0;
+			case 5: return x * y % 2 + x * y % 3 == 0;
+			case 6: return (x * y % 2 + x * y % 3) % 2 == 0;
+			default: return ((x + y) % 2 + x * y % 3) % 2 == 0;
+		}
+	}
+
+	static constexpr void apply_mask(Grid& g, int mask) {
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				if (!g.function[y][x] && mask_bit(mask, x, y)) g.dark[y][x] = !g.dark[y][x];
+			}
+		}
+	}
+
+	static constexpr int finder_patterns(const int (&history)[7]) {
+		int n	    = history[1];
+		bool core = n > 0 && history[2] == n && history[3] == n * 3 && history[4] == n && history[5] == n;
+		return (core && history[0] >= n * 4 && history[6] >= n ? 1 : 0) + (core && history[6] >= n * 4 && history[0] >= n ? 1 : 0);
+	}
+
+	static constexpr void add_history(int run, int (&history)[7]) {
+		if (history[0] == 0) run += size;  // Light border before the first run
+		for (int i = 6; i > 0; i--) history[i] = history[i - 1];
+		history[0] = run;
+	}
+
+	// Runs and finder-like patterns along one row, or one column when vertical
+	static constexpr long line_penalty(const Grid& g, int line, bool vertical) {
+		long result	   = 0;
+		bool color	   = false;
+		int run	   = 0;
+		int history[7] = {};
+		for (int i = 0; i < size; i++) {
+			bool dark = vertical ? g.dark[i][line] : g.dark[line][i];
+			if (dark == color) {
+				run++;
+				if (run == 5) result += 3;
+				else if (run > 5) result++;
+			} else {
+				add_history(run, history);
+				if (!color) result += finder_patterns(history) * 40;
+				color = dark;
+				run	= 1;
+			}
+		}
+		if (color) {
+			add_history(run, history);
+			run = 0;
+		}
+		add_history(run + size, history);  // Light border after the last run
+		return result + finder_patterns(history) * 40;
+	}
+
+	static constexpr long penalty_score(const Grid& g) {
+		long result = 0;
+		for (int i = 0; i < size; i++) result += line_penalty(g, i, false) + line_penalty(g, i, true);
+
+		for (int y = 0; y < size - 1; y++) {
+			for (int x = 0; x < size - 1; x++) {
+				bool c = g.dark[y][x];
+				if (c == g.dark[y][x + 1] && c == g.dark[y + 1][x] && c == g.dark[y + 1][x + 1]) result += 3;
+			}
+		}
+
+		int dark = 0;
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) dark += g.dark[y][x];
+		}
+		int total = size * size;
+		long k	  = (abs(dark * 20 - total * 10) + total - 1) / total - 1;
+		return result + k * 10;
+	}
+};
+
+}
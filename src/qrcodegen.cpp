@@ -30,8 +30,9 @@
 #include <sstream>
 #include <utility>
 #include "qrcodegen.hpp"
-
-#include <esp_log.h>
+#include "memProfile.hpp"
+#include "rsKernel.hpp"
+#include "wifiTrace.hpp"
 
 using std::int8_t;
 using std::size_t;
@@ -112,13 +113,42 @@ const std::vector<bool> &QrSegment::getData() const {
 	return data;
 }
 
+bool QrCode::fits(const char *text) {
+	int dataUsedBits = QrSegment::getTotalBits(QrSegment::makeSegments(text));
+	return dataUsedBits != -1 && dataUsedBits <= getNumDataCodewords() * 8;
+}
+
 QrCode QrCode::encodeText(const char *text) {
-	vector<QrSegment> segs = QrSegment::makeSegments(text);
+	MemProfile::Scope phase(MemProfile::Phase::QrEncode);
+	WIFI_TRACE_SCOPE("qr_encode");
+	return QrCode(makeDataCodewords(text), -1);
+}
+
+vector<QrCode> QrCode::encodeTexts(const vector<const char *> &texts) {
+	vector<vector<uint8_t> > data;
+	vector<const vector<uint8_t> *> dataPtrs;
+	data.reserve(texts.size());
+	for (const char *text : texts) {
+		data.push_back(makeDataCodewords(text));
+		dataPtrs.push_back(&data.back());
+	}
 
-	int mask = -1;
+	vector<vector<uint8_t> > ecc(texts.size());
+	computeEcc(dataPtrs.data(), ecc.data(), texts.size());
 
+	vector<QrCode> result;
+	result.reserve(texts.size());
+	for (size_t i = 0; i < texts.size(); i++)
+		result.push_back(QrCode(Interleaved(), interleave(data[i], ecc[i]), -1));
+	return result;
+}
+
+vector<uint8_t> QrCode::makeDataCodewords(const char *text) {
+	WIFI_TRACE_SCOPE("qr_segment");
+	vector<QrSegment> segs = QrSegment::makeSegments(text);
 	int dataUsedBits = QrSegment::getTotalBits(segs);
 	assert(dataUsedBits != -1);
+	(void)dataUsedBits;  // Only read by the asserts, which NDEBUG removes
 
 	// Concatenate all segments to create the data bit string
 	BitBuffer bb;
@@ -145,46 +175,28 @@ QrCode QrCode::encodeText(const char *text) {
 	for (size_t i = 0; i < bb.size(); i++)
 		dataCodewords.at(i >> 3) |= (bb.at(i) ? 1 : 0) << (7 - (i & 7));
 
-	ESP_LOG_BUFFER_HEXDUMP("a", dataCodewords.data(), dataCodewords.size(), ESP_LOG_INFO);
-	ESP_LOG_BUFFER_HEXDUMP("a", text, strlen(text), ESP_LOG_INFO);
-
-	vector<uint8_t> bb8; // its same with dataCodewords
-	for (int i = 0; i < bb.size() / 8; i++) {
-			bb8.push_back(
-		    bb[i * 8 + 0] << 7 |
-		    bb[i * 8 + 1] << 6 |
-		    bb[i * 8 + 2] << 5 |
-		    bb[i * 8 + 3] << 4 |
-		    bb[i * 8 + 4] << 3 |
-		    bb[i * 8 + 5] << 2 |
-		    bb[i * 8 + 6] << 1 |
-		    bb[i * 8 + 7] << 0);
-	}
-	ESP_LOG_BUFFER_HEXDUMP("a", bb8.data(), bb8.size(), ESP_LOG_INFO);
-	for (int i=0; i<bb.size(); i++) {
-		if (i % 41 == 0) printf("\n");
-		printf("%c", bb[i] ? '0' : ' ');
-	}
-	printf("\n");
+	return dataCodewords;
+}
 
-	// Create the QR Code object
-	return QrCode(dataCodewords, mask);
+QrCode::QrCode(const vector<uint8_t> &dataCodewords, int msk) : QrCode(Interleaved(), addEccAndInterleave(dataCodewords), msk) {
 }
 
-QrCode::QrCode(const vector<uint8_t> &dataCodewords, int msk) {
+QrCode::QrCode(Interleaved, const vector<uint8_t> &allCodewords, int msk) {
 	size_t sz	 = static_cast<size_t>(size);
 	modules	 = vector<vector<bool> >(sz, vector<bool>(sz));  // Initially all light
 	isFunction = vector<vector<bool> >(sz, vector<bool>(sz));
 
-	// Compute ECC, draw modules
+	// Draw modules
+	WIFI_TRACE_BEGIN("qr_render");
 	drawFunctionPatterns();
-	const vector<uint8_t> allCodewords = addEccAndInterleave(dataCodewords);
 	drawCodewords(allCodewords);
+	WIFI_TRACE_END("qr_render");
 
 	// Do masking
 	if (msk == -1) {  // Automatically choose best mask
 		long minPenalty = LONG_MAX;
 		for (int i = 0; i < 8; i++) {
+			WIFI_TRACE_SCOPE("qr_mask", i);
 			applyMask(i);
 			drawFormatBits(i);
 			long penalty = getPenaltyScore();
@@ -197,6 +209,7 @@ QrCode::QrCode(const vector<uint8_t> &dataCodewords, int msk) {
 	}
 	assert(0 <= msk && msk <= 7);
 	mask = msk;
+	WIFI_TRACE_INSTANT("qr_mask_chosen", msk);
 	applyMask(msk);	  // Apply the final choice of mask
 	drawFormatBits(msk);  // Overwrite old format bits
 
@@ -295,7 +308,44 @@ bool QrCode::module(int x, int y) const {
 	return modules.at(static_cast<size_t>(y)).at(static_cast<size_t>(x));
 }
 
-vector<uint8_t> QrCode::addEccAndInterleave(const vector<uint8_t> &data) const {
+vector<uint8_t> QrCode::addEccAndInterleave(const vector<uint8_t> &data) {
+	const vector<uint8_t> *dataPtr = &data;
+	vector<uint8_t> ecc;
+	computeEcc(&dataPtr, &ecc, 1);
+	return interleave(data, ecc);
+}
+
+void QrCode::computeEcc(const vector<uint8_t> *const *data, vector<uint8_t> *ecc, size_t count) {
+	WIFI_TRACE_SCOPE("qr_ecc", static_cast<int32_t>(count));
+	// Calculate parameter numbers
+	int numBlocks	    = NUM_ERROR_CORRECTION_BLOCKS;
+	int blockEccLen    = ECC_CODEWORDS_PER_BLOCK;
+	int rawCodewords   = getNumRawDataModules() / 8;
+	int numShortBlocks = numBlocks - rawCodewords % numBlocks;
+	int shortBlockLen  = rawCodewords / numBlocks;
+
+	// Short blocks and long blocks (one more data byte) of all sequences
+	vector<const uint8_t *> blockData[2];
+	vector<uint8_t *> blockEcc[2];
+	for (size_t n = 0; n < count; n++) {
+		ecc[n].assign(static_cast<size_t>(numBlocks * blockEccLen), 0);
+		for (int i = 0, k = 0; i < numBlocks; i++) {
+			int isLong = i < numShortBlocks ? 0 : 1;
+			blockData[isLong].push_back(data[n]->data() + k);
+			blockEcc[isLong].push_back(ecc[n].data() + i * blockEccLen);
+			k += shortBlockLen - blockEccLen + isLong;
+		}
+	}
+
+	const vector<uint8_t> rsDiv = reedSolomonComputeDivisor(blockEccLen);
+	for (int isLong = 0; isLong < 2; isLong++) {
+		if (!blockData[isLong].empty())
+			RsKernel::remainder(blockData[isLong].data(), static_cast<size_t>(shortBlockLen - blockEccLen + isLong),
+							blockEcc[isLong].data(), blockData[isLong].size(), rsDiv.data(), blockEccLen);
+	}
+}
+
+vector<uint8_t> QrCode::interleave(const vector<uint8_t> &data, const vector<uint8_t> &ecc) {
 	// Calculate parameter numbers
 	int numBlocks	    = NUM_ERROR_CORRECTION_BLOCKS;
 	int blockEccLen    = ECC_CODEWORDS_PER_BLOCK;
@@ -305,14 +355,12 @@ vector<uint8_t> QrCode::addEccAndInterleave(const vector<uint8_t> &data) const {
 
 	// Split data into blocks and append ECC to each block
 	vector<vector<uint8_t> > blocks;
-	const vector<uint8_t> rsDiv = reedSolomonComputeDivisor(blockEccLen);
 	for (int i = 0, k = 0; i < numBlocks; i++) {
 		vector<uint8_t> dat(data.cbegin() + k, data.cbegin() + (k + shortBlockLen - blockEccLen + (i < numShortBlocks ? 0 : 1)));
 		k += static_cast<int>(dat.size());
-		const vector<uint8_t> ecc = reedSolomonComputeRemainder(dat, rsDiv);
 		if (i < numShortBlocks)
 			dat.push_back(0);
-		dat.insert(dat.end(), ecc.cbegin(), ecc.cend());
+		dat.insert(dat.end(), ecc.cbegin() + i * blockEccLen, ecc.cbegin() + (i + 1) * blockEccLen);
 		blocks.push_back(std::move(dat));
 	}
 
@@ -521,18 +569,6 @@ vector<uint8_t> QrCode::reedSolomonComputeDivisor(int degree) {
 	return result;
 }
 
-vector<uint8_t> QrCode::reedSolomonComputeRemainder(const vector<uint8_t> &data, const vector<uint8_t> &divisor) {
-	vector<uint8_t> result(divisor.size());
-	for (uint8_t b : data) {	 // Polynomial division
-		uint8_t factor = b ^ result.at(0);
-		result.erase(result.begin());
-		result.push_back(0);
-		for (size_t i = 0; i < result.size(); i++)
-			result.at(i) ^= reedSolomonMultiply(divisor.at(i), factor);
-	}
-	return result;
-}
-
 uint8_t QrCode::reedSolomonMultiply(uint8_t x, uint8_t y) {
 	// Russian peasant multiplication
 	int z = 0;
@@ -204,6 +204,15 @@ class QrCode final {
 	public: static QrCode encodeText(const char *text);	
 	
 	
+	// Whether encodeText() can take the text: byte mode at the fixed version and ECC level below.
+	public: static bool fits(const char *text);
+	
+	
+	// encodeText() for each of the texts, with the error correction of all their blocks
+	// computed in one batch. Every text must fit().
+	public: static std::vector<QrCode> encodeTexts(const std::vector<const char *> &texts);
+	
+	
 	/*---- Instance fields ----*/
 	
 	// Immutable scalar parameters:
@@ -245,6 +254,12 @@ class QrCode final {
 	 */
 	public: QrCode(const std::vector<std::uint8_t> &dataCodewords, int msk);
 	
+	
+	// Tag of the constructor that takes the codewords with error correction already interleaved.
+	private: struct Interleaved {};
+	
+	private: QrCode(Interleaved, const std::vector<std::uint8_t> &allCodewords, int msk);
+	
 		/* 
 	 * Returns this QR Code's mask, in the range [0, 7].
 	 */
@@ -292,9 +307,22 @@ class QrCode final {
 	
 	/*---- Private helper methods for constructor: Codewords and masking ----*/
 	
+	// Returns the data codewords of the given text, segment header and padding included.
+	private: static std::vector<std::uint8_t> makeDataCodewords(const char *text);
+	
+	
 	// Returns a new byte string representing the given data with the appropriate error correction
 	// codewords appended to it, based on this object's version and error correction level.
-	private: std::vector<std::uint8_t> addEccAndInterleave(const std::vector<std::uint8_t> &data) const;
+	private: static std::vector<std::uint8_t> addEccAndInterleave(const std::vector<std::uint8_t> &data);
+	
+	
+	// Computes the error correction codewords of every block of count data codeword sequences,
+	// all blocks of a length in one RsKernel call. ecc[i] receives the blocks' ECC one after another.
+	private: static void computeEcc(const std::vector<std::uint8_t> *const *data, std::vector<std::uint8_t> *ecc, std::size_t count);
+	
+	
+	// Returns the data and the ECC of computeEcc() interleaved into the final codeword sequence.
+	private: static std::vector<std::uint8_t> interleave(const std::vector<std::uint8_t> &data, const std::vector<std::uint8_t> &ecc);
 	
 	
 	// Draws the given sequence of 8-bit codewords (data and error correction) onto the entire
@@ -341,10 +369,6 @@ class QrCode final {
 	private: static std::vector<std::uint8_t> reedSolomonComputeDivisor(int degree);
 	
 	
-	// Returns the Reed-Solomon error correction codeword for the given data and divisor polynomials.
-	private: static std::vector<std::uint8_t> reedSolomonComputeRemainder(const std::vector<std::uint8_t> &data, const std::vector<std::uint8_t> &divisor);
-	
-	
 	// Returns the product of the two given field elements modulo GF(2^8/0x11D).
 	// All inputs are valid. This could be implemented as a 256*256 lookup table.
 	private: static std::uint8_t reedSolomonMultiply(std::uint8_t x, std::uint8_t y);
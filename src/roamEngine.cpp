@@ -0,0 +1,199 @@
+#include "roamEngine.hpp"
+
+#include <string.h>
+
+#define EID_NEIGHBOR_REPORT 52
+
+// Channels scanned when the AP does not answer with a neighbor report
+static const uint8_t fallback_channels[] = {1, 6, 11};
+
+RoamEngine::Config RoamEngine::default_config() {
+	Config config;
+	config.rssi_threshold	   = -70;
+	config.hysteresis_db	   = 8;
+	config.cooldown_ms		   = 10000;
+	config.neighbor_timeout_ms   = 100;
+	config.transition_timeout_ms = 2000;
+	return config;
+}
+
+RoamEngine::RoamEngine(const Config &config)
+    : config(config), state(State::Idle), trigger_us(0), transition_us(0), quiet_until(0), forced(false),
+	 current_rssi(0), current_channel(0), target(), candidate_count(0), known_count(0), counters() {
+	memset(current_bssid, 0, sizeof(current_bssid));
+}
+
+int RoamEngine::parse_neighbor_report(const uint8_t *report, size_t len, Candidate *out, int max) {
+	int n = 0;
+	// Element: id, length, BSSID(6), BSSID information(4), operating class, channel, PHY type, subelements
+	for (size_t pos = 0; pos + 2 <= len && n < max;) {
+		uint8_t id = report[pos], elen = report[pos + 1];
+		if (pos + 2 + elen > len) break;
+		if (id == EID_NEIGHBOR_REPORT && elen >= 13) {
+			const uint8_t *e = report + pos + 2;
+			memcpy(out[n].bssid, e, 6);
+			out[n].channel = e[11];
+			out[n].rssi	= INT8_MIN;
+			n++;
+		}
+		pos += 2 + elen;
+	}
+	return n;
+}
+
+RoamEngine::Step RoamEngine::on_rssi_low(int64_t now_us, int8_t rssi, const uint8_t bssid[6], uint8_t channel, bool force) {
+	Step step = {};
+	current_rssi	 = rssi;
+	current_channel = channel;
+	memcpy(current_bssid, bssid, sizeof(current_bssid));
+	if (state != State::Idle) return step;
+	if (!force && (now_us < quiet_until || rssi > config.rssi_threshold)) return step;
+
+	counters.triggers++;
+	forced	    = force;
+	trigger_us	    = now_us;
+	candidate_count = 0;
+	state		    = State::AwaitNeighbors;
+	step.action	    = Action::RequestNeighbors;
+	return step;
+}
+
+RoamEngine::Step RoamEngine::scan(const uint8_t *channels, int count) {
+	Step step = {};
+	for (int i = 0; i < count && step.channel_count < max_channels; i++) {
+		bool seen = false;
+		for (int j = 0; j < step.channel_count; j++) seen |= step.channels[j] == channels[i];
+		if (!seen && channels[i] != 0) step.channels[step.channel_count++] = channels[i];
+	}
+	state	    = State::Scanning;
+	step.action = Action::Scan;
+	return step;
+}
+
+RoamEngine::Step RoamEngine::scan_known() {
+	uint8_t channels[max_channels + sizeof(fallback_channels)];
+	int count = 0;
+	for (int i = 0; i < known_count; i++) channels[count++] = known_channels[i];
+	for (uint8_t c : fallback_channels) channels[count++] = c;
+	return scan(channels, count);
+}
+
+void RoamEngine::set_known_channels(const uint8_t *channels, int count) {
+	known_count = count < max_channels ? count : max_channels;
+	memcpy(known_channels, channels, known_count);
+}
+
+RoamEngine::Step RoamEngine::on_neighbor_report(const uint8_t *report, size_t len) {
+	if (state != State::AwaitNeighbors) return Step();
+
+	Candidate neighbors[max_candidates];
+	int n = parse_neighbor_report(report, len, neighbors, max_candidates);
+	uint8_t channels[max_candidates];
+	int count = 0;
+	for (int i = 0; i < n; i++)
+		if (memcmp(neighbors[i].bssid, current_bssid, 6)) channels[count++] = neighbors[i].channel;
+
+	if (count == 0) return scan_known();
+	return scan(channels, count);
+}
+
+void RoamEngine::on_scan_result(const Candidate &candidate) {
+	if (state != State::Scanning || candidate_count == max_candidates) return;
+	if (memcmp(candidate.bssid, current_bssid, 6) == 0) {
+		current_rssi = candidate.rssi;
+		return;
+	}
+	candidates[candidate_count++] = candidate;
+}
+
+RoamEngine::Step RoamEngine::on_scan_done(int64_t now_us) {
+	Step step = {};
+	if (state != State::Scanning) return step;
+
+	const Candidate *best = nullptr;
+	for (int i = 0; i < candidate_count; i++)
+		if (!best || candidates[i].rssi > best->rssi) best = &candidates[i];
+
+	if (!best || (!forced && best->rssi < current_rssi + config.hysteresis_db)) {
+		counters.no_candidate++;
+		state		   = State::Idle;
+		quiet_until = now_us + config.cooldown_ms * 1000LL;
+		return step;
+	}
+
+	target	    = *best;
+	transition_us = now_us;
+	state	    = State::Transitioning;
+	step.action   = Action::Transition;
+	step.target   = target;
+	return step;
+}
+
+void RoamEngine::on_associated(int64_t now_us, const uint8_t bssid[6], uint8_t channel) {
+	bool to_target = state == State::Transitioning && memcmp(bssid, target.bssid, 6) == 0;
+	memcpy(current_bssid, bssid, sizeof(current_bssid));
+	current_channel = channel;
+	if (state != State::Transitioning) return;
+
+	if (!to_target) {
+		give_up(now_us);
+		return;
+	}
+
+	uint32_t latency = static_cast<uint32_t>(now_us - trigger_us);
+	counters.roams++;
+	counters.last_latency_us = latency;
+	counters.last_handoff_us = static_cast<uint32_t>(now_us - transition_us);
+	counters.total_latency_us += latency;
+	if (latency > counters.max_latency_us) counters.max_latency_us = latency;
+	state		   = State::Idle;
+	quiet_until = now_us + config.cooldown_ms * 1000LL;
+}
+
+void RoamEngine::on_disconnected(int64_t now_us) {
+	// A transition without BTM goes through a disconnect of its own
+	if (state == State::AwaitNeighbors || state == State::Scanning) give_up(now_us);
+}
+
+RoamEngine::Step RoamEngine::on_timeout(int64_t now_us) {
+	switch (state) {
+		case State::AwaitNeighbors:
+			// No 802.11k answer, look where the network was seen and on the usual non-overlapping channels
+			return scan_known();
+		case State::Transitioning:
+			give_up(now_us);
+			break;
+		default:
+			break;
+	}
+	return Step();
+}
+
+void RoamEngine::give_up(int64_t now_us) {
+	counters.failed++;
+	state		   = State::Idle;
+	quiet_until = now_us + config.cooldown_ms * 1000LL;
+}
+
+int64_t RoamEngine::deadline_us() const {
+	switch (state) {
+		case State::AwaitNeighbors:
+			return trigger_us + config.neighbor_timeout_ms * 1000LL;
+		case State::Transitioning:
+			return transition_us + config.transition_timeout_ms * 1000LL;
+		default:
+			return 0;
+	}
+}
+
+int64_t RoamEngine::quiet_until_us() const {
+	return quiet_until;
+}
+
+bool RoamEngine::busy() const {
+	return state != State::Idle;
+}
+
+const RoamEngine::Stats &RoamEngine::stats() const {
+	return counters;
+}
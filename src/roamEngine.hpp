@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Decision logic of background roaming, free of driver calls so that
+ * tools/roam_sim can drive it with simulated time.
+ *
+ * RSSI low -> neighbor report (802.11k) -> partial scan of the neighbor
+ * channels -> transition to the best candidate that beats the current AP
+ * by the hysteresis margin.
+ * A forced attempt (WiFi::roam_now()) ignores the threshold and the cooldown,
+ * and moves to the strongest other AP found, as the current one is the problem.
+ */
+class RoamEngine {
+    public:
+	static const int max_channels   = 6;
+	static const int max_candidates = 8;
+
+	struct Config {
+		int8_t rssi_threshold;		  // Trigger level (dBm)
+		uint8_t hysteresis_db;		  // Candidate must be this much stronger
+		uint32_t cooldown_ms;		  // Quiet time after a roam or a failed attempt
+		uint32_t neighbor_timeout_ms;   // Wait for the neighbor report before falling back
+		uint32_t transition_timeout_ms;
+	};
+
+	struct Candidate {
+		uint8_t bssid[6];
+		uint8_t channel;
+		int8_t rssi;
+	};
+
+	enum class Action {
+		None,
+		RequestNeighbors,
+		Scan,		   // Scan channels[0..channel_count)
+		Transition,  // Reassociate to target
+	};
+
+	struct Step {
+		Action action;
+		uint8_t channel_count;
+		uint8_t channels[max_channels];
+		Candidate target;
+	};
+
+	struct Stats {
+		uint32_t triggers;
+		uint32_t roams;
+		uint32_t failed;		   // Transition did not end on the target
+		uint32_t no_candidate;	   // Nothing stronger found
+		uint32_t last_latency_us;  // Trigger to association with the new AP
+		uint32_t max_latency_us;
+		uint64_t total_latency_us;
+		uint32_t last_handoff_us;  // Transition start to association, the time without a link
+	};
+
+	static Config default_config();
+	explicit RoamEngine(const Config& config);
+
+	Step on_rssi_low(int64_t now_us, int8_t rssi, const uint8_t bssid[6], uint8_t channel, bool force = false);
+	Step on_neighbor_report(const uint8_t* report, size_t len);
+	Step on_timeout(int64_t now_us);
+	void on_scan_result(const Candidate& candidate);
+	Step on_scan_done(int64_t now_us);
+	void on_associated(int64_t now_us, const uint8_t bssid[6], uint8_t channel);
+	// Link lost before a transition was started, e.g. beacon loss during the scan
+	void on_disconnected(int64_t now_us);
+
+	// Channels the network was seen on, scanned when no neighbor report arrives
+	void set_known_channels(const uint8_t* channels, int count);
+
+	// Deadline for on_timeout() in the current state, 0 when none is pending
+	int64_t deadline_us() const;
+	// The trigger is ignored until then, re-arm the RSSI threshold at this time
+	int64_t quiet_until_us() const;
+	bool busy() const;
+	const Stats& stats() const;
+
+	// Parses Neighbor Report elements (IEEE 802.11-2016 9.4.2.37)
+	static int parse_neighbor_report(const uint8_t* report, size_t len, Candidate* out, int max);
+
+    private:
+	enum class State {
+		Idle,
+		AwaitNeighbors,
+		Scanning,
+		Transitioning,
+	};
+
+	Config config;
+	State state;
+	int64_t trigger_us;
+	int64_t transition_us;
+	int64_t quiet_until;
+	bool forced;
+	int8_t current_rssi;
+	uint8_t current_bssid[6];
+	uint8_t current_channel;
+	Candidate target;
+	Candidate candidates[max_candidates];
+	int candidate_count;
+	uint8_t known_channels[max_channels];
+	int known_count;
+	Stats counters;
+
+	Step scan(const uint8_t* channels, int count);
+	Step scan_known();
+	void give_up(int64_t now_us);
+};
@@ -0,0 +1,182 @@
+#include "rsKernel.hpp"
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RS_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+namespace qrcodegen {
+
+namespace {
+
+struct Tables {
+	alignas(16) uint8_t lo[RsKernel::max_degree][16];  // divisor[j] * n
+	alignas(16) uint8_t hi[RsKernel::max_degree][16];  // divisor[j] * (n << 4)
+};
+
+typedef void (*kernel_fn_t)(const Tables& t, const uint8_t* const* data, size_t len, uint8_t* const* ecc, size_t blocks, int degree);
+
+std::atomic<int> active_kind(-1);
+
+uint8_t multiply(uint8_t x, uint8_t y) {
+	int z = 0;
+	for (int i = 7; i >= 0; i--) {
+		z = (z << 1) ^ ((z >> 7) * 0x11D);
+		z ^= ((y >> i) & 1) * x;
+	}
+	return static_cast<uint8_t>(z);
+}
+
+void build_tables(Tables& t, const uint8_t* divisor, int degree) {
+	for (int j = 0; j < degree; j++) {
+		for (int n = 0; n < 16; n++) {
+			t.lo[j][n] = multiply(divisor[j], static_cast<uint8_t>(n));
+			t.hi[j][n] = multiply(divisor[j], static_cast<uint8_t>(n << 4));
+		}
+	}
+}
+
+void scalar(const Tables& t, const uint8_t* const* data, size_t len, uint8_t* const* ecc, size_t blocks, int degree) {
+	for (size_t b = 0; b < blocks; b++) {
+		uint8_t r[RsKernel::max_degree] = {};
+		for (size_t i = 0; i < len; i++) {
+			uint8_t f = data[b][i] ^ r[0];
+			for (int j = 0; j < degree; j++) {
+				uint8_t p = t.lo[j][f & 0x0f] ^ t.hi[j][f >> 4];
+				r[j]	    = (j + 1 < degree ? r[j + 1] : 0) ^ p;
+			}
+		}
+		memcpy(ecc[b], r, degree);
+	}
+}
+
+#ifdef RS_KERNEL_X86
+// 16 blocks per step, one in each byte lane
+__attribute__((target("ssse3"))) void ssse3(const Tables& t, const uint8_t* const* data, size_t len, uint8_t* const* ecc, size_t blocks, int degree) {
+	const __m128i nibble = _mm_set1_epi8(0x0f);
+	for (size_t first = 0; first < blocks; first += 16) {
+		size_t lanes = std::min<size_t>(16, blocks - first);
+		__m128i r[RsKernel::max_degree];
+		for (int j = 0; j < degree; j++) r[j] = _mm_setzero_si128();
+
+		alignas(16) uint8_t column[16] = {};
+		for (size_t i = 0; i < len; i++) {
+			for (size_t l = 0; l < lanes; l++) column[l] = data[first + l][i];
+			__m128i f  = _mm_xor_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(column)), r[0]);
+			__m128i lo = _mm_and_si128(f, nibble);
+			__m128i hi = _mm_and_si128(_mm_srli_epi16(f, 4), nibble);
+			for (int j = 0; j < degree; j++) {
+				__m128i p = _mm_xor_si128(_mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(t.lo[j])), lo),
+								    _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(t.hi[j])), hi));
+				r[j]	    = j + 1 < degree ? _mm_xor_si128(r[j + 1], p) : p;
+			}
+		}
+
+		alignas(16) uint8_t out[RsKernel::max_degree][16];
+		for (int j = 0; j < degree; j++) _mm_store_si128(reinterpret_cast<__m128i*>(out[j]), r[j]);
+		for (size_t l = 0; l < lanes; l++) {
+			for (int j = 0; j < degree; j++) ecc[first + l][j] = out[j][l];
+		}
+	}
+}
+
+// 32 blocks per step; pshufb looks up within each 128 bit half, so the tables are broadcast to both
+__attribute__((target("avx2"))) void avx2(const Tables& t, const uint8_t* const* data, size_t len, uint8_t* const* ecc, size_t blocks, int degree) {
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	for (size_t first = 0; first < blocks; first += 32) {
+		size_t lanes = blocks - first;
+		if (lanes <= 16) {
+			ssse3(t, data + first, len, ecc + first, lanes, degree);
+			break;
+		}
+		lanes = std::min<size_t>(32, lanes);
+		__m256i r[RsKernel::max_degree];
+		for (int j = 0; j < degree; j++) r[j] = _mm256_setzero_si256();
+
+		alignas(32) uint8_t column[32] = {};
+		for (size_t i = 0; i < len; i++) {
+			for (size_t l = 0; l < lanes; l++) column[l] = data[first + l][i];
+			__m256i f  = _mm256_xor_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(column)), r[0]);
+			__m256i lo = _mm256_and_si256(f, nibble);
+			__m256i hi = _mm256_and_si256(_mm256_srli_epi16(f, 4), nibble);
+			for (int j = 0; j < degree; j++) {
+				__m256i tlo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.lo[j])));
+				__m256i thi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.hi[j])));
+				__m256i p	= _mm256_xor_si256(_mm256_shuffle_epi8(tlo, lo), _mm256_shuffle_epi8(thi, hi));
+				r[j]		= j + 1 < degree ? _mm256_xor_si256(r[j + 1], p) : p;
+			}
+		}
+
+		alignas(32) uint8_t out[RsKernel::max_degree][32];
+		for (int j = 0; j < degree; j++) _mm256_store_si256(reinterpret_cast<__m256i*>(out[j]), r[j]);
+		for (size_t l = 0; l < lanes; l++) {
+			for (int j = 0; j < degree; j++) ecc[first + l][j] = out[j][l];
+		}
+	}
+}
+#endif
+
+kernel_fn_t kernel(RsKernel::Kind kind) {
+	switch (kind) {
+#ifdef RS_KERNEL_X86
+		case RsKernel::Kind::Avx2: return avx2;
+		case RsKernel::Kind::Ssse3: return ssse3;
+#endif
+		default: return scalar;
+	}
+}
+
+}
+
+bool RsKernel::supported(Kind kind) {
+	switch (kind) {
+		case Kind::Scalar: return true;
+#ifdef RS_KERNEL_X86
+		case Kind::Ssse3: return __builtin_cpu_supports("ssse3");
+		case Kind::Avx2: return __builtin_cpu_supports("avx2");
+#endif
+		default: return false;
+	}
+}
+
+RsKernel::Kind RsKernel::best() {
+	if (supported(Kind::Avx2)) return Kind::Avx2;
+	if (supported(Kind::Ssse3)) return Kind::Ssse3;
+	return Kind::Scalar;
+}
+
+RsKernel::Kind RsKernel::active() {
+	int kind = active_kind.load(std::memory_order_relaxed);
+	if (kind < 0) {
+		kind = static_cast<int>(best());
+		active_kind.store(kind, std::memory_order_relaxed);
+	}
+	return static_cast<Kind>(kind);
+}
+
+bool RsKernel::use(Kind kind) {
+	if (!supported(kind)) return false;
+	active_kind.store(static_cast<int>(kind), std::memory_order_relaxed);
+	return true;
+}
+
+const char* RsKernel::name(Kind kind) {
+	switch (kind) {
+		case Kind::Ssse3: return "ssse3";
+		case Kind::Avx2: return "avx2";
+		default: return "scalar";
+	}
+}
+
+void RsKernel::remainder(const uint8_t* const* data, size_t len, uint8_t* const* ecc, size_t blocks, const uint8_t* divisor, int degree) {
+	Tables t;
+	build_tables(t, divisor, degree);
+	kernel(active())(t, data, len, ecc, blocks, degree);
+}
+
+}
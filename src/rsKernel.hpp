@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace qrcodegen {
+
+/*
+ * Reed-Solomon remainders over GF(2^8/0x11D) for many equal-length blocks
+ * at once, the ECC step of QrCode.
+ *
+ * Every kernel multiplies by the divisor's coefficients through split-nibble
+ * tables (c*lo ^ c*hi, 16 entries each) built once per call. The vector
+ * kernels put one block in each byte lane and look up all lanes with one
+ * pshufb per nibble: 16 blocks per step with SSSE3, 32 with AVX2. The scalar
+ * kernel is the portable fallback and the one used on the device.
+ *
+ * The fastest kernel the CPU supports is picked on first use; use() forces
+ * one, for benchmarks.
+ */
+class RsKernel {
+    public:
+	enum class Kind { Scalar, Ssse3, Avx2 };
+
+	static const int max_degree = 30;  // Most ECC codewords per block in any QR version
+
+	// ecc[b] receives the degree remainder bytes of data[b]; divisor as in
+	// QrCode::reedSolomonComputeDivisor(), highest power first without the leading 1
+	static void remainder(const uint8_t* const* data, size_t len, uint8_t* const* ecc, size_t blocks, const uint8_t* divisor, int degree);
+
+	static Kind best();
+	static Kind active();
+	// False when the CPU lacks the instructions
+	static bool use(Kind kind);
+	static bool supported(Kind kind);
+	static const char* name(Kind kind);
+
+    private:
+	RsKernel();
+};
+
+}
@@ -0,0 +1,108 @@
+#include "scanPlanner.hpp"
+
+#include <string.h>
+
+ScanPlanner::ScanPlanner() : clock(0) {
+	memset(history, 0, sizeof(history));
+	memset(&stats, 0, sizeof(stats));
+}
+
+uint32_t ScanPlanner::hash(const uint8_t *ssid, size_t ssid_len) {
+	// FNV-1a, never returns 0 so that 0 can mark an empty slot
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < ssid_len && ssid[i] != '\0'; i++) {
+		h ^= ssid[i];
+		h *= 16777619u;
+	}
+	return h ? h : 1;
+}
+
+ScanPlanner::Entry *ScanPlanner::find(uint32_t ssid_hash) {
+	for (Entry &e : history)
+		if (e.ssid_hash == ssid_hash) return &e;
+	return nullptr;
+}
+
+const ScanPlanner::Entry *ScanPlanner::find(uint32_t ssid_hash) const {
+	for (const Entry &e : history)
+		if (e.ssid_hash == ssid_hash) return &e;
+	return nullptr;
+}
+
+void ScanPlanner::observe(const uint8_t *ssid, size_t ssid_len, uint8_t channel, uint8_t weight) {
+	if (channel < 1 || channel > max_channel) return;
+	uint32_t h = hash(ssid, ssid_len);
+
+	Entry *e = find(h);
+	if (!e) {
+		// Reuse the least recently used slot
+		e = &history[0];
+		for (Entry &c : history)
+			if (c.last_used < e->last_used) e = &c;
+		memset(e, 0, sizeof(Entry));
+		e->ssid_hash = h;
+	}
+	e->last_used = ++clock;
+
+	uint8_t &s = e->score[channel - 1];
+	if (s > 255 - weight) {
+		// Age every channel so that a moved AP is picked up again
+		for (uint8_t &a : e->score) a >>= 1;
+	}
+	s += weight;
+}
+
+ScanPlanner::Plan ScanPlanner::plan(const uint8_t *ssid, size_t ssid_len, int max_channels) const {
+	Plan p = {};
+	if (max_channels > max_targeted) max_channels = max_targeted;
+
+	const Entry *e = find(hash(ssid, ssid_len));
+	if (!e) return p;
+
+	// Selection of the highest scores, ties go to the lower channel
+	bool used[max_channel] = {};
+	while (p.count < max_channels) {
+		int best = -1;
+		for (int i = 0; i < max_channel; i++) {
+			if (used[i] || e->score[i] == 0) continue;
+			if (best < 0 || e->score[i] > e->score[best]) best = i;
+		}
+		if (best < 0) break;
+		used[best]			= true;
+		p.channels[p.count++] = static_cast<uint8_t>(best + 1);
+	}
+	return p;
+}
+
+void ScanPlanner::record_targeted(bool hit, uint8_t channels_scanned, uint32_t elapsed_us, uint32_t full_sweep_estimate_us) {
+	stats.planned++;
+	stats.channels_scanned += channels_scanned;
+	stats.time_spent_us += elapsed_us;
+	if (hit) {
+		stats.hits++;
+		if (full_sweep_estimate_us > elapsed_us) stats.time_saved_us += full_sweep_estimate_us - elapsed_us;
+	} else {
+		stats.misses++;
+	}
+}
+
+void ScanPlanner::record_full_sweep() {
+	stats.full_sweeps++;
+}
+
+const ScanPlanner::Counters &ScanPlanner::counters() const {
+	return stats;
+}
+
+const ScanPlanner::Entry *ScanPlanner::entries() const {
+	return history;
+}
+
+void ScanPlanner::restore(const Entry *entries, int count) {
+	if (count > history_size) count = history_size;
+	memset(history, 0, sizeof(history));
+	memcpy(history, entries, sizeof(Entry) * count);
+	clock = 0;
+	for (const Entry &e : history)
+		if (e.last_used > clock) clock = e.last_used;
+}
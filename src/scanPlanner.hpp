@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Remembers on which channels our SSIDs were seen (scan results and successful
+ * associations) and plans a short targeted scan of those channels before
+ * falling back to the driver's full sweep.
+ * Pure bookkeeping; WiFi drives the actual esp_wifi_scan_start() calls.
+ */
+class ScanPlanner {
+    public:
+	static const int max_channel	  = 14;
+	static const int history_size	  = 8;	// Number of SSIDs remembered
+	static const int max_targeted	  = 4;	// Upper bound for planned channels
+	static const uint8_t weight_scan  = 2;
+	static const uint8_t weight_assoc = 8;
+
+	struct Plan {
+		uint8_t channels[max_targeted];
+		uint8_t count;
+	};
+
+	struct Counters {
+		uint32_t planned;		  // Connection attempts that used a targeted scan
+		uint32_t hits;		  // Targeted scan found the SSID
+		uint32_t misses;		  // Targeted scan came up empty, widened to full sweep
+		uint32_t full_sweeps;	  // Connection attempts without any history
+		uint32_t channels_scanned;  // Channels visited by targeted scans
+		uint64_t time_spent_us;	  // Time spent in targeted scans
+		uint64_t time_saved_us;	  // Estimated full sweep time minus targeted scan time, for hits
+	};
+
+	// Persistable form of one history slot
+	struct Entry {
+		uint32_t ssid_hash;
+		uint32_t last_used;
+		uint8_t score[max_channel];	 // Index 0 is channel 1
+	};
+
+	ScanPlanner();
+
+	void observe(const uint8_t *ssid, size_t ssid_len, uint8_t channel, uint8_t weight);
+	Plan plan(const uint8_t *ssid, size_t ssid_len, int max_channels) const;
+
+	void record_targeted(bool hit, uint8_t channels_scanned, uint32_t elapsed_us, uint32_t full_sweep_estimate_us);
+	void record_full_sweep();
+
+	const Counters &counters() const;
+	const Entry *entries() const;
+	void restore(const Entry *entries, int count);
+
+	static uint32_t hash(const uint8_t *ssid, size_t ssid_len);
+
+    private:
+	Entry history[history_size];
+	uint32_t clock;
+	Counters stats;
+
+	Entry *find(uint32_t ssid_hash);
+	const Entry *find(uint32_t ssid_hash) const;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bounded lock-free ring for exactly one producer and one consumer task.
+ * N must be a power of two. A push into a full ring fails and is counted.
+ */
+template <typename T, size_t N>
+class SpscRing {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+    public:
+	SpscRing() : head(0), tail(0), drops(0) {}
+
+	// Producer side
+	bool push(const T &item) {
+		uint32_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == N) {
+			drops.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		slots[h & (N - 1)] = item;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Producer side, in place: fill the returned slot, then commit(); nullptr (counted) when full
+	T *claim() {
+		uint32_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == N) {
+			drops.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		return &slots[h & (N - 1)];
+	}
+
+	void commit() {
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Consumer side, in place: the oldest item until release(); nullptr when empty
+	const T *peek() const {
+		uint32_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) return nullptr;
+		return &slots[t & (N - 1)];
+	}
+
+	void release() {
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Consumer side
+	bool pop(T &item) {
+		uint32_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) return false;
+		item = slots[t & (N - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t size() const {
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+
+	uint32_t dropped() const {
+		return drops.load(std::memory_order_relaxed);
+	}
+
+    private:
+	T slots[N];
+	std::atomic<uint32_t> head;
+	std::atomic<uint32_t> tail;
+	std::atomic<uint32_t> drops;
+};
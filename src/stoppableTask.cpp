@@ -0,0 +1,59 @@
+#include "stoppableTask.hpp"
+
+StoppableTask::StoppableTask() : task(nullptr), stop_requested(false), exited(nullptr) {}
+
+esp_err_t StoppableTask::start(TaskFunction_t run, const char *name, uint32_t stack, UBaseType_t priority, BaseType_t core) {
+	if (task) return ESP_ERR_INVALID_STATE;
+	if (!exited) {
+		exited = xSemaphoreCreateBinary();
+		if (!exited) return ESP_ERR_NO_MEM;
+	}
+	// Left over when the last task stopped itself
+	xSemaphoreTake(exited, 0);
+
+	stop_requested = false;
+	// The handle is written before the task first runs
+	if (xTaskCreatePinnedToCore(run, name, stack, nullptr, priority, &task, core) != pdPASS) {
+		task = nullptr;
+		return ESP_ERR_NO_MEM;
+	}
+	return ESP_OK;
+}
+
+void StoppableTask::stop() {
+	if (!task) return;
+	request_stop();
+	wait();
+}
+
+void StoppableTask::request_stop() {
+	stop_requested = true;
+	notify();
+}
+
+void StoppableTask::wait() {
+	if (task && !is_current()) xSemaphoreTake(exited, portMAX_DELAY);
+}
+
+void StoppableTask::exit() {
+	task = nullptr;
+	xSemaphoreGive(exited);
+	vTaskDelete(nullptr);
+}
+
+void StoppableTask::notify() {
+	TaskHandle_t t = task;
+	if (t) xTaskNotifyGive(t);
+}
+
+bool StoppableTask::running() const {
+	return task != nullptr;
+}
+
+bool StoppableTask::stopping() const {
+	return stop_requested;
+}
+
+bool StoppableTask::is_current() const {
+	return task == xTaskGetCurrentTaskHandle();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+#include <esp_err.h>
+
+/*
+ * The task of a background service that can be stopped and started again.
+ * The task function polls stopping(), sleeps with ulTaskNotifyTake() so that
+ * notify() and stop() wake it, and ends with exit(). stop() returns once the
+ * task has exited, so that start() may follow at once; called from the task
+ * itself, e.g. in a user callback, it only asks it to end.
+ */
+class StoppableTask {
+    public:
+	StoppableTask();
+
+	// ESP_ERR_INVALID_STATE while the task runs
+	esp_err_t start(TaskFunction_t run, const char* name, uint32_t stack, UBaseType_t priority, BaseType_t core);
+	void stop();
+
+	// The parts of stop(), for a task that waits on something else than its notification
+	void request_stop();
+	void wait();
+
+	// Last call of the task function
+	void exit();
+
+	void notify();
+	bool running() const;
+	bool stopping() const;
+	// True on the task itself
+	bool is_current() const;
+
+    private:
+	TaskHandle_t task;
+	volatile bool stop_requested;
+	SemaphoreHandle_t exited;  // Given by exit()
+};
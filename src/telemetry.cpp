@@ -0,0 +1,352 @@
+#include "telemetry.hpp"
+#include "wifiManager.hpp"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <initializer_list>
+
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <lwip/stats.h>
+
+#ifdef CONFIG_WIFI_MANAGER_TELEMETRY_PERIOD_MIN_MS
+#define TELEMETRY_PERIOD_MIN_MS CONFIG_WIFI_MANAGER_TELEMETRY_PERIOD_MIN_MS
+#define TELEMETRY_PERIOD_MAX_MS CONFIG_WIFI_MANAGER_TELEMETRY_PERIOD_MAX_MS
+#define TELEMETRY_RSSI_DELTA CONFIG_WIFI_MANAGER_TELEMETRY_RSSI_DELTA
+#else
+#define TELEMETRY_PERIOD_MIN_MS 1000
+#define TELEMETRY_PERIOD_MAX_MS 30000
+#define TELEMETRY_RSSI_DELTA 4
+#endif
+
+// Anything earlier means SNTP has not set the clock yet
+#define WALL_CLOCK_VALID_S 1600000000
+
+Telemetry::Config Telemetry::config;
+StoppableTask Telemetry::task;
+int Telemetry::subscription	      = -1;
+
+Telemetry::Slot Telemetry::slots[Telemetry::samples];
+std::atomic<uint32_t> Telemetry::head(0);
+std::atomic<uint32_t> Telemetry::period_ms(0);
+std::atomic<uint32_t> Telemetry::sample_us(0);
+std::atomic<uint32_t> Telemetry::events(0);
+std::atomic<uint32_t> Telemetry::disconnects(0);
+std::atomic<uint32_t> Telemetry::beacon_timeouts(0);
+
+// lwIP's counters are 16 bits unless LWIP_STATS_LARGE; the sampler widens them, only it touches these
+struct Widened {
+	uint32_t last;
+	uint32_t total;
+
+	template <typename T>
+	uint32_t update(T now) {
+		total += static_cast<T>(now - static_cast<T>(last));
+		last = now;
+		return total;
+	}
+};
+
+static Widened rx_packets, tx_packets, link_drops, tcp_retransmits;
+
+struct Telemetry::Bucket {
+	uint32_t count;
+	uint32_t associated;  // Samples with an RSSI
+	int rssi_min;
+	int rssi_max;
+	int rssi_sum;
+	Sample last;
+};
+
+Telemetry::Config Telemetry::default_config() {
+	Config config;
+	config.period_min_ms = TELEMETRY_PERIOD_MIN_MS;
+	config.period_max_ms = TELEMETRY_PERIOD_MAX_MS;
+	config.rssi_delta	   = TELEMETRY_RSSI_DELTA;
+	return config;
+}
+
+esp_err_t Telemetry::start(const Config &config, UBaseType_t priority, BaseType_t core) {
+	if (task.running()) return ESP_ERR_INVALID_STATE;
+	if (config.period_min_ms == 0 || config.period_min_ms > config.period_max_ms) return ESP_ERR_INVALID_ARG;
+
+	Telemetry::config = config;
+	disconnects	  = 0;
+	beacon_timeouts	  = 0;
+	rx_packets = tx_packets = link_drops = tcp_retransmits = Widened();
+	period_ms		  = config.period_min_ms;
+
+	uint32_t mask = WIFI_EVENT_MASK(WiFiEventType::LinkUp) | WIFI_EVENT_MASK(WiFiEventType::LinkDown) |
+				 WIFI_EVENT_MASK(WiFiEventType::Roam) | WIFI_EVENT_MASK(WiFiEventType::IpAcquired) |
+				 WIFI_EVENT_MASK(WiFiEventType::IpLost);
+	subscription = WiFiEvents::subscribe(on_event, nullptr, mask);
+	if (subscription < 0) return ESP_ERR_NO_MEM;
+
+	if (task.start(run, "wifi_telemetry", 3072, priority, core) != ESP_OK) {
+		WiFiEvents::unsubscribe(subscription);
+		subscription = -1;
+		return ESP_ERR_NO_MEM;
+	}
+	return ESP_OK;
+}
+
+void Telemetry::stop() {
+	if (!task.running()) return;
+	WiFiEvents::unsubscribe(subscription);
+	subscription = -1;
+	task.stop();
+}
+
+// On the event task
+void Telemetry::on_event(const WiFiEvent &event, void *arg) {
+	if (event.type == WiFiEventType::LinkDown) {
+		disconnects++;
+		if (event.reason == WIFI_REASON_BEACON_TIMEOUT) beacon_timeouts++;
+	}
+	events++;
+	task.notify();
+}
+
+void Telemetry::take(Sample &s) {
+	LinkSnapshot link = WiFi::get_link();
+	s.time_ms		  = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+	s.state		  = static_cast<uint8_t>(link.state);
+
+	wifi_ap_record_t ap;
+	if (is_associated(link.state) && esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+		s.rssi	= ap.rssi;
+		s.channel = ap.primary;
+		s.phy	= (ap.phy_11b ? phy_11b : 0) | (ap.phy_11g ? phy_11g : 0) | (ap.phy_11n ? phy_11n : 0) | (ap.phy_lr ? phy_lr : 0) |
+			   (ap.second != WIFI_SECOND_CHAN_NONE ? phy_ht40 : 0);
+	}
+
+	s.disconnects	    = disconnects;
+	s.beacon_timeouts = beacon_timeouts;
+#if LWIP_STATS && LINK_STATS
+	s.rx_packets = rx_packets.update(lwip_stats.link.recv);
+	s.tx_packets = tx_packets.update(lwip_stats.link.xmit);
+	s.link_drops = link_drops.update(static_cast<decltype(lwip_stats.link.drop)>(lwip_stats.link.drop + lwip_stats.link.err));
+#endif
+#if LWIP_STATS && TCP_STATS
+	s.tcp_retransmits = tcp_retransmits.update(lwip_stats.tcp.rexmit);
+#endif
+}
+
+// Single producer: only the sampler task writes
+void Telemetry::commit(const Sample &sample) {
+	uint32_t index = head.load(std::memory_order_relaxed);
+	Slot &slot	   = slots[index & (samples - 1)];
+
+	slot.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.sample = sample;
+	slot.seq.store(index + 1, std::memory_order_release);
+	head.store(index + 1, std::memory_order_release);
+}
+
+bool Telemetry::read_slot(uint32_t index, Sample &sample) {
+	const Slot &slot = slots[index & (samples - 1)];
+	uint32_t before  = slot.seq.load(std::memory_order_acquire);
+	memcpy(&sample, &slot.sample, sizeof(sample));
+	std::atomic_thread_fence(std::memory_order_acquire);
+	// Overwritten by a newer lap, or being written
+	return before == index + 1 && slot.seq.load(std::memory_order_relaxed) == before;
+}
+
+void Telemetry::run(void *arg) {
+	Sample previous = {};
+	bool first	    = true;
+	uint32_t period = config.period_min_ms;
+
+	while (!task.stopping()) {
+		int64_t started = esp_timer_get_time();
+		Sample s	    = {};
+		take(s);
+		commit(s);
+		sample_us = static_cast<uint32_t>(esp_timer_get_time() - started);
+
+		int swing	= s.rssi > previous.rssi ? s.rssi - previous.rssi : previous.rssi - s.rssi;
+		bool steady = !first && s.state == previous.state && s.channel == previous.channel && swing <= config.rssi_delta &&
+				    s.disconnects == previous.disconnects;
+		period = steady ? (period * 2 < config.period_max_ms ? period * 2 : config.period_max_ms) : config.period_min_ms;
+		period_ms = period;
+		previous	= s;
+		first	= false;
+
+		// A link event wakes the task early for a sample of the new state
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(period));
+	}
+
+	task.exit();
+}
+
+size_t Telemetry::read(Sample *out, size_t max) {
+	uint32_t end   = head.load(std::memory_order_acquire);
+	uint32_t begin = end > samples ? end - samples : 0;
+	size_t count   = 0;
+	for (uint32_t index = begin; index != end && count < max; index++) {
+		if (read_slot(index, out[count])) count++;
+	}
+	return count;
+}
+
+int Telemetry::dump(writer_t writer, void *arg) {
+	uint32_t end   = head.load(std::memory_order_acquire);
+	uint32_t begin = end > samples ? end - samples : 0;
+
+	Header header	    = {};
+	header.magic	    = magic;
+	header.version	    = version;
+	header.sample_size = sizeof(Sample);
+	header.written	    = end;
+	header.period_ms   = period_ms;
+	int err		    = writer(&header, sizeof(header), arg);
+
+	Sample s;
+	for (uint32_t index = begin; !err && index != end; index++) {
+		if (read_slot(index, s)) err = writer(&s, sizeof(s), arg);
+	}
+	return err;
+}
+
+int Telemetry::for_each_bucket(uint32_t bucket_ms, bucket_fn_t fn, void *arg) {
+	uint32_t end   = head.load(std::memory_order_acquire);
+	uint32_t begin = end > samples ? end - samples : 0;
+
+	Bucket b = {};
+	Sample s;
+	int err = 0;
+	for (uint32_t index = begin; !err && index != end; index++) {
+		if (!read_slot(index, s)) continue;
+		if (b.count && (bucket_ms == 0 || s.time_ms / bucket_ms != b.last.time_ms / bucket_ms)) {
+			err = fn(b, arg);
+			b	= {};
+		}
+		if (is_associated(static_cast<LinkState>(s.state)) && s.rssi) {
+			b.rssi_min = b.associated && b.rssi_min < s.rssi ? b.rssi_min : s.rssi;
+			b.rssi_max = b.associated && b.rssi_max > s.rssi ? b.rssi_max : s.rssi;
+			b.rssi_sum += s.rssi;
+			b.associated++;
+		}
+		b.count++;
+		b.last = s;
+	}
+	if (!err && b.count) err = fn(b, arg);
+	return err;
+}
+
+enum class Metric { Rssi, Channel, State, Phy, Disconnects, BeaconTimeouts, RxPackets, TxPackets, LinkDrops, TcpRetransmits };
+enum class Agg { Last, Min, Max, Mean };
+
+static const struct {
+	const char *name;
+	const char *type;
+	const char *unit;
+	const char *help;
+} families[] = {
+    {"wifi_rssi_dbm", "gauge", "dbm", "Signal strength of the AP"},
+    {"wifi_channel", "gauge", nullptr, "Primary channel"},
+    {"wifi_link_state", "gauge", nullptr, "LinkState: 0 stopped, 1 connecting, 2 associated, 3 up, 4 failed"},
+    {"wifi_phy_mode", "gauge", nullptr, "PHY bits: 1 11b, 2 11g, 4 11n, 8 LR, 16 HT40"},
+    {"wifi_disconnects", "counter", nullptr, "Disconnects since the sampler started"},
+    {"wifi_beacon_timeouts", "counter", nullptr, "Disconnects for lost beacons"},
+    {"wifi_rx_packets", "counter", nullptr, "Frames received by lwIP"},
+    {"wifi_tx_packets", "counter", nullptr, "Frames sent by lwIP"},
+    {"wifi_link_drops", "counter", nullptr, "Frames dropped or in error at link level"},
+    {"wifi_tcp_retransmits", "counter", nullptr, "TCP segments retransmitted"},
+};
+
+struct ExportContext {
+	Telemetry::writer_t writer;
+	void *arg;
+	Metric metric;
+	Agg agg;
+	int64_t epoch_ms;  // Added to Sample::time_ms
+};
+
+static int write_line(const ExportContext &c, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static int write_line(const ExportContext &c, const char *format, ...) {
+	char line[160];
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if (len < 0) return -1;
+	return c.writer(line, static_cast<size_t>(len) < sizeof(line) ? len : sizeof(line) - 1, c.arg);
+}
+
+int Telemetry::write_point(const Bucket &b, void *arg) {
+	const ExportContext &c = *static_cast<const ExportContext *>(arg);
+	const Sample &s	       = b.last;
+	bool associated	       = b.associated > 0;
+	int64_t value	       = 0;
+	switch (c.metric) {
+		case Metric::Rssi:
+			if (!associated) return 0;
+			value = c.agg == Agg::Min ? b.rssi_min : c.agg == Agg::Max ? b.rssi_max : c.agg == Agg::Mean ? b.rssi_sum / static_cast<int>(b.associated) : s.rssi;
+			break;
+		case Metric::Channel:
+			if (!associated) return 0;
+			value = s.channel;
+			break;
+		case Metric::State: value = s.state; break;
+		case Metric::Phy:
+			if (!associated) return 0;
+			value = s.phy;
+			break;
+		case Metric::Disconnects: value = s.disconnects; break;
+		case Metric::BeaconTimeouts: value = s.beacon_timeouts; break;
+		case Metric::RxPackets: value = s.rx_packets; break;
+		case Metric::TxPackets: value = s.tx_packets; break;
+		case Metric::LinkDrops: value = s.link_drops; break;
+		case Metric::TcpRetransmits: value = s.tcp_retransmits; break;
+	}
+
+	static const char *const aggs[] = {"", "{agg=\"min\"}", "{agg=\"max\"}", "{agg=\"mean\"}"};
+	const char *name = families[static_cast<int>(c.metric)].name;
+	bool counter	 = families[static_cast<int>(c.metric)].type[0] == 'c';
+	int64_t ms	 = c.epoch_ms + s.time_ms;
+	return write_line(c, "%s%s%s %lld %lld.%03d\n", name, counter ? "_total" : "", aggs[static_cast<int>(c.agg)], static_cast<long long>(value),
+				   static_cast<long long>(ms / 1000), static_cast<int>(ms % 1000));
+}
+
+int Telemetry::export_openmetrics(writer_t writer, void *arg, uint32_t bucket_ms) {
+	ExportContext c = {writer, arg, Metric::Rssi, Agg::Last, 0};
+
+	struct timeval now;
+	gettimeofday(&now, nullptr);
+	if (now.tv_sec > WALL_CLOCK_VALID_S) c.epoch_ms = now.tv_sec * 1000LL + now.tv_usec / 1000 - esp_timer_get_time() / 1000;
+
+	int err = 0;
+	for (size_t i = 0; !err && i < sizeof(families) / sizeof(families[0]); i++) {
+		c.metric = static_cast<Metric>(i);
+		err	   = write_line(c, "# TYPE %s %s\n", families[i].name, families[i].type);
+		if (!err && families[i].unit) err = write_line(c, "# UNIT %s %s\n", families[i].name, families[i].unit);
+		if (!err) err = write_line(c, "# HELP %s %s\n", families[i].name, families[i].help);
+
+		// Every series of a family is written in one piece, in time order
+		if (c.metric == Metric::Rssi && bucket_ms) {
+			for (Agg agg : {Agg::Min, Agg::Max, Agg::Mean}) {
+				c.agg = agg;
+				if (!err) err = for_each_bucket(bucket_ms, write_point, &c);
+			}
+			c.agg = Agg::Last;
+		} else if (!err) {
+			err = for_each_bucket(bucket_ms, write_point, &c);
+		}
+	}
+	if (!err) err = writer("# EOF\n", 6, arg);
+	return err;
+}
+
+Telemetry::Stats Telemetry::get_stats() {
+	Stats s;
+	s.written	= head.load(std::memory_order_relaxed);
+	s.period_ms = period_ms;
+	s.sample_us = sample_us;
+	s.events	= events;
+	return s;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_err.h>
+
+#include "wifiEvents.hpp"
+#include "stoppableTask.hpp"
+
+#ifdef CONFIG_WIFI_MANAGER_TELEMETRY_SAMPLES
+#define TELEMETRY_SAMPLES CONFIG_WIFI_MANAGER_TELEMETRY_SAMPLES
+#else
+#define TELEMETRY_SAMPLES 128
+#endif
+
+/*
+ * Radio and traffic time series of the station after it is up: a small task
+ * samples RSSI, channel, PHY mode and the link counters into a RAM ring,
+ * lock-free for readers, and the oldest samples are overwritten.
+ * The period doubles up to period_max_ms while the link is steady and drops
+ * to period_min_ms on an RSSI swing or a link event, which is also sampled
+ * at once.
+ * export_openmetrics() writes the ring as OpenMetrics text, optionally
+ * downsampled into buckets with min/max/mean; dump() writes it raw.
+ */
+class Telemetry {
+    public:
+	static const uint32_t magic	  = 0x53544d57;  // "WMTS"
+	static const uint16_t version = 1;
+	static const size_t samples	  = TELEMETRY_SAMPLES;
+
+	// Sample::phy bits
+	static const uint8_t phy_11b  = 1 << 0;
+	static const uint8_t phy_11g  = 1 << 1;
+	static const uint8_t phy_11n  = 1 << 2;
+	static const uint8_t phy_lr	  = 1 << 3;
+	static const uint8_t phy_ht40 = 1 << 4;
+
+	struct Sample {
+		uint32_t time_ms;	 // Since boot
+		int8_t rssi;	 // 0 while not associated
+		uint8_t channel;
+		uint8_t state;	 // LinkState
+		uint8_t phy;
+		// Totals since start()
+		uint32_t disconnects;
+		uint32_t beacon_timeouts;  // Disconnects for lost beacons
+		uint32_t rx_packets;	   // Link level; these three need CONFIG_LWIP_STATS
+		uint32_t tx_packets;
+		uint32_t link_drops;	   // Dropped and errored frames
+		uint32_t tcp_retransmits;  // Needs CONFIG_LWIP_STATS
+	};
+
+	// Precedes the samples of a dump
+	struct Header {
+		uint32_t magic;
+		uint16_t version;
+		uint16_t sample_size;
+		uint32_t written;	// Samples taken since start()
+		uint32_t period_ms;  // Current period
+	};
+
+	struct Config {
+		uint32_t period_min_ms;
+		uint32_t period_max_ms;
+		uint8_t rssi_delta;  // dB between two samples that count as a change
+	};
+
+	struct Stats {
+		uint32_t written;
+		uint32_t period_ms;
+		uint32_t sample_us;  // Cost of the last sample
+		uint32_t events;	   // Link events that triggered an early sample
+	};
+
+	// Returns 0 to go on
+	typedef int (*writer_t)(const void* data, size_t len, void* arg);
+
+	static Config default_config();
+	static esp_err_t start(const Config& config, UBaseType_t priority = 2, BaseType_t core = tskNO_AFFINITY);
+	static void stop();
+
+	// Copies up to max samples, oldest first; returns the count
+	static size_t read(Sample* out, size_t max);
+	// Header, then the samples, oldest first
+	static int dump(writer_t writer, void* arg);
+	// bucket_ms 0 writes every sample; otherwise RSSI is written as min/max/mean
+	// and the other values as the last of each bucket. Timestamps are wall
+	// clock once the time is set, seconds since boot before.
+	static int export_openmetrics(writer_t writer, void* arg, uint32_t bucket_ms = 0);
+
+	static Stats get_stats();
+
+    private:
+	Telemetry();
+
+	static_assert(samples >= 2 && (samples & (samples - 1)) == 0, "CONFIG_WIFI_MANAGER_TELEMETRY_SAMPLES must be a power of two");
+
+	struct Slot {
+		std::atomic<uint32_t> seq;  // index + 1 once complete, 0 while written
+		Sample sample;
+	};
+
+	struct Bucket;
+	typedef int (*bucket_fn_t)(const Bucket& bucket, void* arg);
+
+	static Config config;
+	static StoppableTask task;
+	static int subscription;
+
+	static Slot slots[samples];
+	static std::atomic<uint32_t> head;
+	static std::atomic<uint32_t> period_ms;
+	static std::atomic<uint32_t> sample_us;
+	static std::atomic<uint32_t> events;
+	static std::atomic<uint32_t> disconnects;
+	static std::atomic<uint32_t> beacon_timeouts;
+
+	static void run(void* arg);
+	static void on_event(const WiFiEvent& event, void* arg);
+	static void take(Sample& sample);
+	static void commit(const Sample& sample);
+	static bool read_slot(uint32_t index, Sample& sample);
+	static int for_each_bucket(uint32_t bucket_ms, bucket_fn_t fn, void* arg);
+	static int write_point(const Bucket& bucket, void* arg);
+};
@@ -0,0 +1,181 @@
+#include "txBatcher.hpp"
+#include "log2Histogram.hpp"
+#include "wifiManager.hpp"
+
+#include <string.h>
+
+#ifdef CONFIG_WIFI_MANAGER_TX_BATCH_SIZE
+#define TX_BATCH_SIZE CONFIG_WIFI_MANAGER_TX_BATCH_SIZE
+#else
+#define TX_BATCH_SIZE 16
+#endif
+
+// The station stays awake for a few ms after the beacon it woke up for
+#define WAKE_WINDOW_US 2000
+
+// Queue markers, never run as work
+#define ITEM_TIMER reinterpret_cast<void*>(1)
+#define ITEM_STOP  reinterpret_cast<void*>(2)
+
+QueueHandle_t TxBatcher::queue = nullptr;
+StoppableTask TxBatcher::task;
+TxBatcher::Item TxBatcher::pending[TX_BATCH_SIZE];
+int TxBatcher::pending_count = 0;
+int64_t TxBatcher::anchor_us = 0;
+
+portMUX_TYPE TxBatcher::lock = portMUX_INITIALIZER_UNLOCKED;
+TxBatcher::Stats TxBatcher::stats = {};
+uint32_t TxBatcher::histogram[latency_buckets];
+
+esp_timer_handle_t TxBatcher::wake_timer = nullptr;
+
+void TxBatcher::on_wake_timer(void* arg) {
+	Item item = {nullptr, ITEM_TIMER, 0, 0};
+	xQueueSend(queue, &item, 0);
+}
+
+esp_err_t TxBatcher::start(UBaseType_t priority, BaseType_t core) {
+	if (task.running()) return ESP_ERR_INVALID_STATE;
+
+	if (!queue) {
+		queue = xQueueCreate(TX_BATCH_SIZE, sizeof(Item));
+		if (!queue) return ESP_ERR_NO_MEM;
+	}
+	// Markers left over when the last run was stopped from a work item
+	xQueueReset(queue);
+	if (!wake_timer) {
+		esp_timer_create_args_t args = {};
+		args.callback			   = on_wake_timer;
+		args.name				   = "tx_batch";
+		esp_err_t err			   = esp_timer_create(&args, &wake_timer);
+		if (err) return err;
+	}
+
+	return task.start(scheduler, "tx_batch", 3072, priority, core);
+}
+
+void TxBatcher::stop() {
+	if (!task.running()) return;
+	// A work item must not wait for queue space, its task is the only consumer;
+	// the scheduler ends once the batch returns
+	if (task.is_current()) {
+		task.request_stop();
+		return;
+	}
+	Item item = {nullptr, ITEM_STOP, 0, 0};
+	xQueueSend(queue, &item, portMAX_DELAY);
+	task.wait();
+}
+
+esp_err_t TxBatcher::enqueue(work_t work, void* arg, uint32_t max_delay_ms) {
+	if (!task.running() || !work) return ESP_ERR_INVALID_STATE;
+
+	int64_t now = esp_timer_get_time();
+	Item item	= {work, arg, now, now + static_cast<int64_t>(max_delay_ms) * 1000};
+	if (xQueueSend(queue, &item, 0) != pdTRUE) {
+		portENTER_CRITICAL(&lock);
+		stats.dropped++;
+		portEXIT_CRITICAL(&lock);
+		return ESP_ERR_NO_MEM;
+	}
+
+	portENTER_CRITICAL(&lock);
+	stats.enqueued++;
+	portEXIT_CRITICAL(&lock);
+	return ESP_OK;
+}
+
+void TxBatcher::sync_wake(int64_t now_us) {
+	anchor_us = now_us;
+}
+
+int64_t TxBatcher::next_wake(int64_t now) {
+	int64_t interval = WiFi::wake_interval_us();
+	if (interval == 0) return now;
+
+	int64_t anchor = anchor_us ? anchor_us : WiFi::wake_anchor_us();
+	int64_t since  = (now - anchor) % interval;
+	if (since < 0) since += interval;
+	if (since < WAKE_WINDOW_US) return now;
+	return now + interval - since;
+}
+
+void TxBatcher::release(bool aligned) {
+	int64_t now = esp_timer_get_time();
+	int n	    = pending_count;
+
+	uint32_t latency[TX_BATCH_SIZE];
+	for (int i = 0; i < n; i++) {
+		pending[i].work(pending[i].arg);
+		latency[i] = static_cast<uint32_t>((now - pending[i].enqueued_us) / 1000);
+	}
+	pending_count = 0;
+
+	// Sent one by one, every item would have cost a wakeup of its own
+	uint32_t avoided = 0;
+	if (WiFi::wake_interval_us() != 0) avoided = aligned ? n : n - 1;
+
+	portENTER_CRITICAL(&lock);
+	stats.released += n;
+	stats.wakeups_avoided += avoided;
+	if (aligned)
+		stats.aligned_batches++;
+	else
+		stats.early_flushes++;
+	for (int i = 0; i < n; i++) {
+		int b = 0;
+		while (b < latency_buckets - 1 && latency[i] >= (1u << b)) b++;
+		histogram[b]++;
+		if (latency[i] > stats.latency_max_ms) stats.latency_max_ms = latency[i];
+	}
+	portEXIT_CRITICAL(&lock);
+}
+
+void TxBatcher::scheduler(void* arg) {
+	Item item;
+	while (!task.stopping()) {
+		xQueueReceive(queue, &item, portMAX_DELAY);
+		if (item.arg == ITEM_STOP && !item.work) break;
+		if (item.work) {
+			pending[pending_count++] = item;
+			if (pending_count == TX_BATCH_SIZE) {
+				release(false);
+				continue;
+			}
+		}
+		if (pending_count == 0) continue;
+
+		int64_t now		  = esp_timer_get_time();
+		int64_t wake	  = next_wake(now);
+		int64_t deadline = INT64_MAX;
+		for (int i = 0; i < pending_count; i++)
+			if (pending[i].deadline_us < deadline) deadline = pending[i].deadline_us;
+
+		if (wake <= now) {
+			release(true);
+		} else if (deadline <= now) {
+			release(false);
+		} else {
+			esp_timer_stop(wake_timer);
+			esp_timer_start_once(wake_timer, (wake < deadline ? wake : deadline) - now);
+		}
+	}
+
+	esp_timer_stop(wake_timer);
+	if (pending_count) release(false);
+	task.exit();
+}
+
+TxBatcher::Stats TxBatcher::get_stats() {
+	uint32_t h[latency_buckets];
+	Stats s;
+	portENTER_CRITICAL(&lock);
+	s = stats;
+	memcpy(h, histogram, sizeof(h));
+	portEXIT_CRITICAL(&lock);
+
+	s.latency_p50_ms = log2_percentile(h, latency_buckets, 500, s.latency_max_ms);
+	s.latency_p90_ms = log2_percentile(h, latency_buckets, 900, s.latency_max_ms);
+	s.latency_p99_ms = log2_percentile(h, latency_buckets, 990, s.latency_max_ms);
+	return s;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+
+#include <esp_err.h>
+#include <esp_timer.h>
+
+#include "stoppableTask.hpp"
+
+/*
+ * Holds delay tolerant outbound work until the station's next modem sleep
+ * wake window (see WiFi::wake_interval_us()) and runs it as one batch, so
+ * that the radio is not woken for every packet.
+ * An item whose deadline would pass before the next window flushes the batch early.
+ */
+class TxBatcher {
+    public:
+	typedef void (*work_t)(void* arg);
+
+	struct Stats {
+		uint32_t enqueued;
+		uint32_t released;
+		uint32_t dropped;		    // Queue was full
+		uint32_t aligned_batches;   // Released on a wake window
+		uint32_t early_flushes;	    // Released before the window, by deadline or a full batch
+		uint32_t wakeups_avoided;   // Items that would have woken the radio on their own
+		uint32_t latency_p50_ms;    // Added latency percentiles, upper bound of the histogram bucket
+		uint32_t latency_p90_ms;
+		uint32_t latency_p99_ms;
+		uint32_t latency_max_ms;
+	};
+
+	static esp_err_t start(UBaseType_t priority = 5, BaseType_t core = tskNO_AFFINITY);
+	static void stop();
+
+	// Runs work(arg) on the scheduler task no later than max_delay_ms from now
+	static esp_err_t enqueue(work_t work, void* arg, uint32_t max_delay_ms);
+
+	// Re-anchors the wake window phase to a moment the station is known to be awake,
+	// e.g. on reception of downlink traffic
+	static void sync_wake(int64_t now_us);
+
+	static Stats get_stats();
+
+    private:
+	TxBatcher();
+
+	struct Item {
+		work_t work;
+		void* arg;
+		int64_t enqueued_us;
+		int64_t deadline_us;
+	};
+
+	static const int latency_buckets = 17;	// <1ms, <2ms, ... <32768ms, longer
+
+	static QueueHandle_t queue;
+	static StoppableTask task;
+	static Item pending[];
+	static int pending_count;
+	static int64_t anchor_us;
+	static esp_timer_handle_t wake_timer;
+
+	static portMUX_TYPE lock;
+	static Stats stats;
+	static uint32_t histogram[latency_buckets];
+
+	static void scheduler(void* arg);
+	static void on_wake_timer(void* arg);
+	static int64_t next_wake(int64_t now);
+	static void release(bool aligned);
+};
@@ -0,0 +1,565 @@
+#include "wifiBench.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#ifdef ESP_PLATFORM
+#include <lwip/sockets.h>
+#include <lwip/stats.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include "wifiManager.hpp"
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_MAGIC 0x57464242	// "WFBB"
+
+enum : uint32_t {
+	CMD_DATA = 1,	 // seq, a = send time (us, low 32 bits)
+	CMD_FIN,		 // seq = datagrams sent
+	CMD_REPORT,	 // seq = datagrams received, a = lost, b = jitter (us), c = bytes; UDP adds the high bytes word
+	CMD_STREAM,	 // a = duration (ms), b = packet size, c = rate (kbps)
+	CMD_PING,		 // seq, a = send time, echoed as is
+};
+
+struct WiFiBench::Header {
+	uint32_t magic;
+	uint32_t cmd;
+	uint32_t seq;
+	uint32_t a;
+	uint32_t b;
+	uint32_t c;
+};
+
+// Receiver side accounting of a UDP stream
+struct WiFiBench::UdpStats {
+	uint32_t received;
+	uint64_t bytes;
+	int32_t last_transit;
+	double jitter_us;
+
+	void add(uint32_t sent, uint32_t now, size_t len) {
+		// Clocks of both sides are unrelated, only differences of transit times matter
+		int32_t transit = static_cast<int32_t>(now - sent);
+		if (received) {
+			int32_t d = transit - last_transit;
+			jitter_us += (fabs(static_cast<double>(d)) - jitter_us) / 16;
+		}
+		last_transit = transit;
+		received++;
+		bytes += len;
+	}
+};
+
+static int64_t now_us() {
+#ifdef ESP_PLATFORM
+	return esp_timer_get_time();
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+static void sleep_us(int64_t us) {
+#ifdef ESP_PLATFORM
+	// Anything below a tick is left to the socket back pressure
+	if (us >= portTICK_PERIOD_MS * 1000) vTaskDelay(us / 1000 / portTICK_PERIOD_MS);
+#else
+	if (us > 0) usleep(static_cast<useconds_t>(us));
+#endif
+}
+
+static void close_socket(int sock) {
+#ifdef ESP_PLATFORM
+	lwip_close(sock);
+#else
+	close(sock);
+#endif
+}
+
+static void set_timeout(int sock, uint32_t ms) {
+	timeval tv;
+	tv.tv_sec  = ms / 1000;
+	tv.tv_usec = (ms % 1000) * 1000;
+	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+static uint32_t tcp_retransmits(int sock) {
+#ifdef ESP_PLATFORM
+#if LWIP_STATS && MIB2_STATS
+	return lwip_stats.mib2.tcpretranssegs;
+#else
+	return 0;
+#endif
+#else
+	tcp_info info;
+	socklen_t len = sizeof(info);
+	if (getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &len)) return 0;
+	return info.tcpi_total_retrans;
+#endif
+}
+
+static void put_header(uint8_t* buf, uint32_t cmd, uint32_t seq, uint32_t a, uint32_t b, uint32_t c) {
+	uint32_t w[6] = {htonl(BENCH_MAGIC), htonl(cmd), htonl(seq), htonl(a), htonl(b), htonl(c)};
+	memcpy(buf, w, sizeof(w));
+}
+
+static bool get_header(const uint8_t* buf, size_t len, uint32_t* w) {
+	if (len < 6 * sizeof(uint32_t)) return false;
+	memcpy(w, buf, 6 * sizeof(uint32_t));
+	for (int i = 0; i < 6; i++) w[i] = ntohl(w[i]);
+	return w[0] == BENCH_MAGIC;
+}
+
+static bool send_all(int sock, const uint8_t* buf, size_t len) {
+	while (len) {
+		ssize_t n = send(sock, buf, len, 0);
+		if (n <= 0) return false;
+		buf += n;
+		len -= n;
+	}
+	return true;
+}
+
+static bool recv_all(int sock, uint8_t* buf, size_t len) {
+	while (len) {
+		ssize_t n = recv(sock, buf, len, 0);
+		if (n <= 0) return false;
+		buf += n;
+		len -= n;
+	}
+	return true;
+}
+
+static int open_socket(const WiFiBench::Config& config, int type, sockaddr_in& peer) {
+	memset(&peer, 0, sizeof(peer));
+	peer.sin_family = AF_INET;
+	peer.sin_port	= htons(config.port);
+	if (inet_pton(AF_INET, config.peer, &peer.sin_addr) != 1) return -1;
+
+	int sock = socket(AF_INET, type, 0);
+	if (sock < 0) return -1;
+	if (connect(sock, reinterpret_cast<sockaddr*>(&peer), sizeof(peer))) {
+		close_socket(sock);
+		return -1;
+	}
+	return sock;
+}
+
+static void percentiles(std::vector<uint32_t>& samples, WiFiBench::Result& result) {
+	if (samples.empty()) return;
+	std::sort(samples.begin(), samples.end());
+	size_t n		   = samples.size();
+	result.rtt_p50_us = samples[(n - 1) * 50 / 100];
+	result.rtt_p90_us = samples[(n - 1) * 90 / 100];
+	result.rtt_p99_us = samples[(n - 1) * 99 / 100];
+	result.rtt_max_us = samples[n - 1];
+}
+
+WiFiBench::Config WiFiBench::default_config(const char* peer, Test test) {
+	Config config	   = {};
+	config.peer	   = peer;
+	config.port	   = 5201;
+	config.test	   = test;
+	config.duration_ms = 5000;
+	config.packet_size = test == Test::TcpSend || test == Test::TcpReceive ? 1460 * 4 : 1400;
+	config.rtt_count   = 100;
+	return config;
+}
+
+const char* WiFiBench::test_name(Test test) {
+	switch (test) {
+		case Test::TcpSend:
+			return "tcp_send";
+		case Test::TcpReceive:
+			return "tcp_receive";
+		case Test::UdpSend:
+			return "udp_send";
+		case Test::UdpReceive:
+			return "udp_receive";
+		case Test::UdpRtt:
+			return "udp_rtt";
+	}
+	return "unknown";
+}
+
+void WiFiBench::tag(Result& result) {
+#ifdef ESP_PLATFORM
+	wifi_ap_record_t ap;
+	if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) result.rssi = ap.rssi;
+	result.radio_profile = WiFi::get_radio_profile_name();
+#else
+	result.radio_profile = "host";
+#endif
+}
+
+WiFiBench::Result WiFiBench::run(const Config& config) {
+	Result result = {};
+	result.test   = config.test;
+	tag(result);
+
+	if (config.packet_size < sizeof(Header)) {
+		result.err = EINVAL;
+		return result;
+	}
+
+	switch (config.test) {
+		case Test::TcpSend:
+			tcp_send(config, result);
+			break;
+		case Test::TcpReceive:
+			tcp_receive(config, result);
+			break;
+		case Test::UdpSend:
+			udp_send(config, result);
+			break;
+		case Test::UdpReceive:
+			udp_receive(config, result);
+			break;
+		case Test::UdpRtt:
+			udp_rtt(config, result);
+			break;
+	}
+
+	if (result.elapsed_ms) result.mbps = result.bytes * 8.0f / (result.elapsed_ms * 1000.0f);
+	return result;
+}
+
+void WiFiBench::tcp_send(const Config& config, Result& result) {
+	sockaddr_in peer;
+	int sock = open_socket(config, SOCK_STREAM, peer);
+	if (sock < 0) {
+		result.err = errno;
+		return;
+	}
+
+	std::vector<uint8_t> buf(config.packet_size);
+	put_header(buf.data(), CMD_DATA, 0, config.duration_ms, config.packet_size, 0);
+	uint32_t retransmits = tcp_retransmits(sock);
+
+	int64_t start = now_us(), end = start + config.duration_ms * 1000LL;
+	while (now_us() < end) {
+		if (!send_all(sock, buf.data(), buf.size())) {
+			result.err = errno;
+			break;
+		}
+	}
+	result.retransmits = tcp_retransmits(sock) - retransmits;
+
+	// The peer answers with what actually arrived once it sees the end of stream
+	shutdown(sock, SHUT_WR);
+	set_timeout(sock, 5000);
+	uint8_t report[sizeof(Header)];
+	uint32_t w[6];
+	if (recv_all(sock, report, sizeof(report)) && get_header(report, sizeof(report), w) && w[1] == CMD_REPORT)
+		result.bytes = static_cast<uint64_t>(w[4]) << 32 | w[3];
+	else if (!result.err)
+		result.err = ETIMEDOUT;
+	result.elapsed_ms = static_cast<uint32_t>((now_us() - start) / 1000);
+	close_socket(sock);
+}
+
+void WiFiBench::tcp_receive(const Config& config, Result& result) {
+	sockaddr_in peer;
+	int sock = open_socket(config, SOCK_STREAM, peer);
+	if (sock < 0) {
+		result.err = errno;
+		return;
+	}
+
+	std::vector<uint8_t> buf(config.packet_size);
+	put_header(buf.data(), CMD_STREAM, 0, config.duration_ms, config.packet_size, 0);
+	if (!send_all(sock, buf.data(), sizeof(Header))) {
+		result.err = errno;
+		close_socket(sock);
+		return;
+	}
+
+	set_timeout(sock, config.duration_ms + 5000);
+	int64_t start = now_us();
+	for (;;) {
+		ssize_t n = recv(sock, buf.data(), buf.size(), 0);
+		if (n < 0) result.err = errno;
+		if (n <= 0) break;
+		result.bytes += n;
+	}
+	result.elapsed_ms = static_cast<uint32_t>((now_us() - start) / 1000);
+	close_socket(sock);
+}
+
+void WiFiBench::udp_send(const Config& config, Result& result) {
+	sockaddr_in peer;
+	int sock = open_socket(config, SOCK_DGRAM, peer);
+	if (sock < 0) {
+		result.err = errno;
+		return;
+	}
+
+	std::vector<uint8_t> buf(config.packet_size);
+	int64_t start = now_us(), end = start + config.duration_ms * 1000LL;
+	int64_t gap	  = config.rate_kbps ? config.packet_size * 8000LL / config.rate_kbps : 0;
+	int64_t next  = start;
+	for (int64_t now = start; now < end; now = now_us()) {
+		put_header(buf.data(), CMD_DATA, result.packets, static_cast<uint32_t>(now), 0, 0);
+		// Full buffers are reported as ENOMEM on lwIP, retry instead of counting a loss
+		if (send(sock, buf.data(), buf.size(), 0) < 0) continue;
+		result.packets++;
+		if (gap) {
+			next += gap;
+			sleep_us(next - now_us());
+		}
+	}
+	result.elapsed_ms = static_cast<uint32_t>((now_us() - start) / 1000);
+
+	uint8_t report[sizeof(Header) + sizeof(uint32_t)];
+	uint32_t w[6];
+	set_timeout(sock, 500);
+	result.err = ETIMEDOUT;
+	for (int i = 0; i < 5; i++) {
+		put_header(buf.data(), CMD_FIN, result.packets, 0, 0, 0);
+		send(sock, buf.data(), sizeof(Header), 0);
+		ssize_t n = recv(sock, report, sizeof(report), 0);
+		if (n > 0 && get_header(report, n, w) && w[1] == CMD_REPORT) {
+			result.lost	    = w[3];
+			result.jitter_ms = w[4] / 1000.0f;
+			result.bytes     = w[5];
+			if (n >= static_cast<ssize_t>(sizeof(report))) {
+				uint32_t high;
+				memcpy(&high, report + sizeof(Header), sizeof(high));
+				result.bytes |= static_cast<uint64_t>(ntohl(high)) << 32;
+			}
+			result.err	    = 0;
+			break;
+		}
+	}
+	close_socket(sock);
+}
+
+void WiFiBench::udp_receive(const Config& config, Result& result) {
+	sockaddr_in peer;
+	int sock = open_socket(config, SOCK_DGRAM, peer);
+	if (sock < 0) {
+		result.err = errno;
+		return;
+	}
+
+	std::vector<uint8_t> buf(config.packet_size);
+	put_header(buf.data(), CMD_STREAM, 0, config.duration_ms, config.packet_size, config.rate_kbps);
+	send(sock, buf.data(), sizeof(Header), 0);
+
+	UdpStats stats = {};
+	uint32_t sent  = 0;
+	uint32_t w[6];
+	set_timeout(sock, 1000);
+	int64_t start = now_us(), first = 0, last = 0;
+	while (now_us() - start < (config.duration_ms + 2000) * 1000LL) {
+		ssize_t n = recv(sock, buf.data(), buf.size(), 0);
+		if (n < 0) break;
+		if (!get_header(buf.data(), n, w)) continue;
+		int64_t now = now_us();
+		if (w[1] == CMD_DATA) {
+			if (!first) first = now;
+			last = now;
+			stats.add(w[3], static_cast<uint32_t>(now), n);
+		} else if (w[1] == CMD_FIN) {
+			sent = w[2];
+			break;
+		}
+	}
+
+	result.packets	  = sent;
+	result.lost	  = sent > stats.received ? sent - stats.received : 0;
+	result.bytes	  = stats.bytes;
+	result.jitter_ms  = static_cast<float>(stats.jitter_us / 1000);
+	result.elapsed_ms = static_cast<uint32_t>((last - first) / 1000);
+	if (!sent) result.err = ETIMEDOUT;
+	close_socket(sock);
+}
+
+void WiFiBench::udp_rtt(const Config& config, Result& result) {
+	sockaddr_in peer;
+	int sock = open_socket(config, SOCK_DGRAM, peer);
+	if (sock < 0) {
+		result.err = errno;
+		return;
+	}
+
+	std::vector<uint32_t> rtt;
+	rtt.reserve(config.rtt_count);
+	uint8_t buf[sizeof(Header)];
+	uint32_t w[6];
+	set_timeout(sock, 1000);
+
+	int64_t start = now_us();
+	for (uint32_t seq = 0; seq < config.rtt_count; seq++) {
+		int64_t sent = now_us();
+		put_header(buf, CMD_PING, seq, static_cast<uint32_t>(sent), 0, 0);
+		send(sock, buf, sizeof(buf), 0);
+		result.packets++;
+		for (;;) {
+			ssize_t n = recv(sock, buf, sizeof(buf), 0);
+			if (n < 0) {
+				result.lost++;
+				break;
+			}
+			// Late echoes of earlier probes are skipped
+			if (get_header(buf, n, w) && w[1] == CMD_PING && w[2] == seq) {
+				rtt.push_back(static_cast<uint32_t>(now_us() - sent));
+				break;
+			}
+		}
+	}
+	result.elapsed_ms = static_cast<uint32_t>((now_us() - start) / 1000);
+	percentiles(rtt, result);
+	close_socket(sock);
+}
+
+void WiFiBench::serve_tcp(int client) {
+	uint8_t head[sizeof(Header)];
+	uint32_t w[6];
+	set_timeout(client, 5000);
+	if (!recv_all(client, head, sizeof(head)) || !get_header(head, sizeof(head), w)) return;
+
+	if (w[1] == CMD_DATA) {
+		// The header already belongs to the measured stream
+		std::vector<uint8_t> buf(std::max<uint32_t>(w[4], sizeof(Header)));
+		uint64_t bytes = sizeof(head);
+		for (;;) {
+			ssize_t n = recv(client, buf.data(), buf.size(), 0);
+			if (n <= 0) break;
+			bytes += n;
+		}
+		put_header(head, CMD_REPORT, 0, static_cast<uint32_t>(bytes), static_cast<uint32_t>(bytes >> 32), 0);
+		send_all(client, head, sizeof(head));
+	} else if (w[1] == CMD_STREAM) {
+		std::vector<uint8_t> buf(std::max<uint32_t>(w[4], sizeof(Header)));
+		int64_t end = now_us() + w[3] * 1000LL;
+		while (now_us() < end)
+			if (!send_all(client, buf.data(), buf.size())) break;
+	}
+}
+
+void WiFiBench::serve_udp(int sock) {
+	static UdpStats stats;
+	// The report of a finished run stays until the next run's data arrives
+	static bool finished = false;
+	std::vector<uint8_t> buf(65536);
+	sockaddr_in from;
+	socklen_t from_len = sizeof(from);
+	uint32_t w[6];
+
+	ssize_t n = recvfrom(sock, buf.data(), buf.size(), 0, reinterpret_cast<sockaddr*>(&from), &from_len);
+	if (n <= 0 || !get_header(buf.data(), n, w)) return;
+	sockaddr* to = reinterpret_cast<sockaddr*>(&from);
+
+	switch (w[1]) {
+		case CMD_DATA:
+			if (finished) stats = UdpStats();
+			finished = false;
+			stats.add(w[3], static_cast<uint32_t>(now_us()), n);
+			break;
+		case CMD_FIN: {
+			// Repeated FINs of the same run, after a lost report, are answered with the same report
+			finished	  = true;
+			uint32_t lost = w[2] > stats.received ? w[2] - stats.received : 0;
+			uint32_t high = htonl(static_cast<uint32_t>(stats.bytes >> 32));
+			put_header(buf.data(), CMD_REPORT, stats.received, lost, static_cast<uint32_t>(stats.jitter_us),
+					 static_cast<uint32_t>(stats.bytes));
+			memcpy(buf.data() + sizeof(Header), &high, sizeof(high));
+			sendto(sock, buf.data(), sizeof(Header) + sizeof(high), 0, to, from_len);
+			break;
+		}
+		case CMD_PING:
+			sendto(sock, buf.data(), n, 0, to, from_len);
+			break;
+		case CMD_STREAM: {
+			uint32_t size = std::max<uint32_t>(std::min<uint32_t>(w[4], 1472), sizeof(Header));
+			int64_t start = now_us(), end = start + w[3] * 1000LL, next = start;
+			int64_t gap = w[5] ? size * 8000LL / w[5] : 0;
+			uint32_t seq = 0;
+			for (int64_t now = start; now < end; now = now_us()) {
+				put_header(buf.data(), CMD_DATA, seq, static_cast<uint32_t>(now), 0, 0);
+				if (sendto(sock, buf.data(), size, 0, to, from_len) < 0) continue;
+				seq++;
+				if (gap) {
+					next += gap;
+					sleep_us(next - now_us());
+				}
+			}
+			for (int i = 0; i < 3; i++) {
+				put_header(buf.data(), CMD_FIN, seq, 0, 0, 0);
+				sendto(sock, buf.data(), sizeof(Header), 0, to, from_len);
+			}
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+int WiFiBench::serve(uint16_t port, volatile bool* stop) {
+	Server server;
+	int err = open_server(port, server);
+	return err ? err : serve(server, stop);
+}
+
+int WiFiBench::open_server(uint16_t port, Server& server) {
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family	    = AF_INET;
+	addr.sin_port	    = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	int tcp = socket(AF_INET, SOCK_STREAM, 0);
+	int udp = socket(AF_INET, SOCK_DGRAM, 0);
+	int one = 1;
+	setsockopt(tcp, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (tcp < 0 || udp < 0 ||
+	    bind(tcp, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) ||
+	    bind(udp, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) ||
+	    listen(tcp, 1)) {
+		int err = errno;
+		if (tcp >= 0) close_socket(tcp);
+		if (udp >= 0) close_socket(udp);
+		return err;
+	}
+	server.tcp = tcp;
+	server.udp = udp;
+	return 0;
+}
+
+int WiFiBench::serve(const Server& server, volatile bool* stop) {
+	int tcp = server.tcp, udp = server.udp;
+	while (!stop || !*stop) {
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(tcp, &fds);
+		FD_SET(udp, &fds);
+		timeval tv = {0, 200000};
+		if (select(std::max(tcp, udp) + 1, &fds, nullptr, nullptr, &tv) <= 0) continue;
+
+		if (FD_ISSET(udp, &fds)) serve_udp(udp);
+		if (FD_ISSET(tcp, &fds)) {
+			int client = accept(tcp, nullptr, nullptr);
+			if (client >= 0) {
+				serve_tcp(client);
+				close_socket(client);
+			}
+		}
+	}
+
+	close_socket(tcp);
+	close_socket(udp);
+	return 0;
+}
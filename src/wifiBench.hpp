@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * iperf style measurement of the active link against a peer running WiFiBench::serve(),
+ * either another device or tools/bench on a Linux host.
+ * Only uses BSD sockets, so the same code runs on lwIP and on Linux.
+ */
+class WiFiBench {
+    public:
+	enum class Test {
+		TcpSend,	   // This side sends, the peer reports what it received
+		TcpReceive,  // The peer sends
+		UdpSend,
+		UdpReceive,
+		UdpRtt,	   // Ping-pong, one packet in flight
+	};
+
+	struct Config {
+		const char* peer;		  // IPv4 address
+		uint16_t port;		  // TCP and UDP port of the peer
+		Test test;
+		uint32_t duration_ms;	  // Throughput tests
+		uint32_t packet_size;	  // UDP datagram / TCP write size
+		uint32_t rate_kbps;	  // UDP send rate, 0 for as fast as possible
+		uint32_t rtt_count;	  // UdpRtt probes
+	};
+
+	struct Result {
+		Test test;
+		int err;				  // 0 on success
+		uint64_t bytes;		  // Delivered to the receiver
+		uint32_t elapsed_ms;
+		float mbps;
+		float jitter_ms;		  // RFC 3550 interarrival jitter, UDP only
+		uint32_t packets;		  // UDP datagrams or RTT probes sent
+		uint32_t lost;
+		uint32_t retransmits;	  // TCP segments retransmitted by this side
+		uint32_t rtt_p50_us;
+		uint32_t rtt_p90_us;
+		uint32_t rtt_p99_us;
+		uint32_t rtt_max_us;
+		int8_t rssi;			  // Tags describing the link at the time of the test
+		const char* radio_profile;
+	};
+
+	// Listening sockets of serve()
+	struct Server {
+		int tcp;
+		int udp;
+	};
+
+	static Config default_config(const char* peer, Test test);
+	static Result run(const Config& config);
+	// Serves every test for remote clients until *stop becomes true
+	static int serve(uint16_t port, volatile bool* stop);
+	// The two halves of serve(), for a caller that starts clients once the peer accepts them:
+	// open_server() binds and listens, serve() then takes over the sockets and closes them
+	static int open_server(uint16_t port, Server& server);
+	static int serve(const Server& server, volatile bool* stop);
+
+	static const char* test_name(Test test);
+
+    private:
+	WiFiBench();
+
+	struct Header;
+	struct UdpStats;
+
+	static void tag(Result& result);
+	static void tcp_send(const Config& config, Result& result);
+	static void tcp_receive(const Config& config, Result& result);
+	static void udp_send(const Config& config, Result& result);
+	static void udp_receive(const Config& config, Result& result);
+	static void udp_rtt(const Config& config, Result& result);
+	static void serve_tcp(int client);
+	static void serve_udp(int sock);
+};
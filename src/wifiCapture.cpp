@@ -0,0 +1,139 @@
+#include "wifiCapture.hpp"
+
+#include <string.h>
+
+#include <esp_timer.h>
+
+WiFiCapture::Config WiFiCapture::config;
+std::atomic<bool> WiFiCapture::armed(false);
+SpscRing<WiFiCapture::Frame, WiFiCapture::frames> WiFiCapture::ring;
+
+std::atomic<uint32_t> WiFiCapture::captured(0);
+std::atomic<uint32_t> WiFiCapture::filtered(0);
+std::atomic<uint32_t> WiFiCapture::throttled(0);
+std::atomic<uint32_t> WiFiCapture::truncated(0);
+std::atomic<uint32_t> WiFiCapture::streamed(0);
+uint32_t WiFiCapture::window_start_ms = 0;
+uint32_t WiFiCapture::window_count	 = 0;
+
+// wifi_pkt_rx_ctrl_t::rate of non-HT frames to 500 kbit/s units
+static const uint8_t legacy_rates[16] = {2, 4, 11, 22, 0, 4, 11, 22, 96, 48, 24, 12, 108, 72, 36, 18};
+
+WiFiCapture::Config WiFiCapture::default_config() {
+	Config c;
+	c.filter  = PcapFormat::connect;
+	c.max_fps = 200;
+	return c;
+}
+
+esp_err_t WiFiCapture::enable() {
+	wifi_promiscuous_filter_t filter = {};
+	uint32_t mgmt				  = PcapFormat::beacon | PcapFormat::probe | PcapFormat::auth | PcapFormat::assoc | PcapFormat::deauth |
+					 PcapFormat::action | PcapFormat::dpp;
+	if (config.filter & mgmt) filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_MGMT;
+	if (config.filter & (PcapFormat::eapol | PcapFormat::data)) filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_DATA;
+	if (config.filter & PcapFormat::control) filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_CTRL;
+
+	esp_err_t err = esp_wifi_set_promiscuous_filter(&filter);
+	if (!err) err = esp_wifi_set_promiscuous_rx_cb(on_frame);
+	if (!err) err = esp_wifi_set_promiscuous(true);
+	return err;
+}
+
+esp_err_t WiFiCapture::start(const Config &config) {
+	if (!config.filter) return ESP_ERR_INVALID_ARG;
+	WiFiCapture::config = config;
+	window_start_ms	    = 0;
+	window_count	    = 0;
+	armed			    = true;
+	esp_err_t err	    = enable();
+	// Before WiFi::initialize(), attach() enables it
+	return err == ESP_ERR_WIFI_NOT_INIT ? ESP_OK : err;
+}
+
+void WiFiCapture::stop() {
+	if (!armed.exchange(false)) return;
+	esp_wifi_set_promiscuous(false);
+}
+
+void WiFiCapture::attach() {
+	if (armed) enable();
+}
+
+// On the driver's task: no blocking, bounded work
+void WiFiCapture::on_frame(void *buf, wifi_promiscuous_pkt_type_t type) {
+	const wifi_promiscuous_pkt_t *pkt = static_cast<const wifi_promiscuous_pkt_t *>(buf);
+	const wifi_pkt_rx_ctrl_t &rx	    = pkt->rx_ctrl;
+	size_t len				    = rx.sig_len >= 4 ? rx.sig_len - 4 : 0;  // Without the FCS
+
+	uint32_t kind = PcapFormat::classify(pkt->payload, len);
+	if (!(kind & config.filter)) {
+		filtered.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	int64_t now = esp_timer_get_time();
+	if (config.max_fps) {
+		uint32_t now_ms = static_cast<uint32_t>(now / 1000);
+		if (now_ms - window_start_ms >= 1000) {
+			window_start_ms = now_ms;
+			window_count	= 0;
+		}
+		if (++window_count > config.max_fps) {
+			throttled.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	Frame *f = ring.claim();
+	if (!f) return;	// Counted by the ring
+	f->radio.time_us  = static_cast<uint64_t>(now);
+	f->radio.rssi	  = static_cast<int8_t>(rx.rssi);
+	f->radio.channel  = static_cast<uint8_t>(rx.channel);
+	f->radio.ht	  = rx.sig_mode == 1;
+	f->radio.rate	  = f->radio.ht ? 0 : legacy_rates[rx.rate & 0x0f];
+	f->radio.mcs	  = static_cast<uint8_t>(rx.mcs);
+	f->radio.ht40	  = rx.cwb;
+	f->radio.short_gi = rx.sgi;
+	f->original	  = static_cast<uint16_t>(len);
+	f->captured	  = static_cast<uint16_t>(len < snaplen ? len : snaplen);
+	memcpy(f->data, pkt->payload, f->captured);
+	ring.commit();
+
+	captured.fetch_add(1, std::memory_order_relaxed);
+	if (len > snaplen) truncated.fetch_add(1, std::memory_order_relaxed);
+}
+
+int WiFiCapture::write_header(writer_t writer, void *arg) {
+	uint8_t header[PcapFormat::file_header_size];
+	PcapFormat::file_header(header, snaplen);
+	return writer(header, sizeof(header), arg);
+}
+
+int WiFiCapture::drain(writer_t writer, void *arg, size_t max, size_t *written) {
+	size_t count = 0;
+	int err	     = 0;
+	for (const Frame *f; count < max && (f = ring.peek()) != nullptr;) {
+		uint8_t header[PcapFormat::record_header_size];
+		PcapFormat::record_header(header, f->radio, f->captured, f->original);
+		err = writer(header, sizeof(header), arg);
+		if (!err) err = writer(f->data, f->captured, arg);
+		if (err) break;
+		ring.release();
+		count++;
+	}
+	streamed.fetch_add(count, std::memory_order_relaxed);
+	if (written) *written = count;
+	return err;
+}
+
+WiFiCapture::Stats WiFiCapture::get_stats() {
+	Stats s;
+	s.captured  = captured.load(std::memory_order_relaxed);
+	s.filtered  = filtered.load(std::memory_order_relaxed);
+	s.dropped	  = ring.dropped();
+	s.throttled = throttled.load(std::memory_order_relaxed);
+	s.truncated = truncated.load(std::memory_order_relaxed);
+	s.streamed  = streamed.load(std::memory_order_relaxed);
+	return s;
+}
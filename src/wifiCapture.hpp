@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+#include <esp_wifi.h>
+
+#include "pcapFormat.hpp"
+#include "spscRing.hpp"
+
+#ifdef CONFIG_WIFI_MANAGER_CAPTURE_FRAMES
+#define CAPTURE_FRAMES CONFIG_WIFI_MANAGER_CAPTURE_FRAMES
+#define CAPTURE_SNAPLEN CONFIG_WIFI_MANAGER_CAPTURE_SNAPLEN
+#else
+#define CAPTURE_FRAMES 16
+#define CAPTURE_SNAPLEN 512
+#endif
+
+/*
+ * Diagnostic capture of the frames around a connection: promiscuous mode
+ * on the station's channel, frames matching the PcapFormat class filter
+ * copied into a ring of CAPTURE_FRAMES slots, and drained as a pcap stream
+ * with radiotap headers, for Wireshark.
+ * The driver's receive callback only classifies the frame and copies at
+ * most CAPTURE_SNAPLEN bytes into a free slot; it never blocks, a full ring
+ * or a frame over max_fps is counted and skipped.
+ * start() may come before WiFi::initialize(), the capture then begins as
+ * soon as the driver is up, in time for the scan and the association.
+ */
+class WiFiCapture {
+    public:
+	static const size_t frames  = CAPTURE_FRAMES;
+	static const size_t snaplen = CAPTURE_SNAPLEN;
+
+	struct Config {
+		uint32_t filter;	 // PcapFormat class bits
+		uint32_t max_fps;	 // Frames per second, 0 for no limit
+	};
+
+	struct Stats {
+		uint32_t captured;
+		uint32_t filtered;	   // Not in the filter
+		uint32_t dropped;		   // Ring full
+		uint32_t throttled;	   // Over max_fps
+		uint32_t truncated;	   // Longer than the snap length
+		uint32_t streamed;
+	};
+
+	// Returns 0 to go on
+	typedef int (*writer_t)(const void* data, size_t len, void* arg);
+
+	static Config default_config();
+	static esp_err_t start(const Config& config);
+	static void stop();
+	// Called by WiFi::initialize() once the driver is up
+	static void attach();
+
+	// The pcap file header, once at the start of a stream
+	static int write_header(writer_t writer, void* arg);
+	// Writes and frees up to max captured frames, oldest first; returns the writer's error.
+	// One consumer at a time.
+	static int drain(writer_t writer, void* arg, size_t max = SIZE_MAX, size_t* written = nullptr);
+
+	static Stats get_stats();
+
+    private:
+	WiFiCapture();
+
+	struct Frame {
+		PcapFormat::Radio radio;
+		uint16_t original;
+		uint16_t captured;
+		uint8_t data[snaplen];
+	};
+
+	static_assert(frames >= 2 && (frames & (frames - 1)) == 0, "CONFIG_WIFI_MANAGER_CAPTURE_FRAMES must be a power of two");
+
+	static Config config;
+	static std::atomic<bool> armed;
+	static SpscRing<Frame, frames> ring;
+
+	static std::atomic<uint32_t> captured;
+	static std::atomic<uint32_t> filtered;
+	static std::atomic<uint32_t> throttled;
+	static std::atomic<uint32_t> truncated;
+	static std::atomic<uint32_t> streamed;
+	// Rate limit, only the receive callback touches these
+	static uint32_t window_start_ms;
+	static uint32_t window_count;
+
+	static esp_err_t enable();
+	static void on_frame(void* buf, wifi_promiscuous_pkt_type_t type);
+};
@@ -0,0 +1,160 @@
+#include "wifiEvents.hpp"
+#include "wifiLog.hpp"
+
+#include <esp_timer.h>
+
+#ifdef CONFIG_WIFI_MANAGER_EVENT_TASK_PRIORITY
+#define EVENT_TASK_CORE CONFIG_WIFI_MANAGER_EVENT_TASK_CORE
+#define EVENT_TASK_PRIORITY CONFIG_WIFI_MANAGER_EVENT_TASK_PRIORITY
+#define EVENT_TASK_STACK CONFIG_WIFI_MANAGER_EVENT_TASK_STACK
+#else
+#define EVENT_TASK_CORE -1
+#define EVENT_TASK_PRIORITY 5
+#define EVENT_TASK_STACK 3072
+#endif
+
+SpscRing<WiFiEvent, 32> WiFiEvents::loop_ring;
+SpscRing<WiFiEvent, 8> WiFiEvents::dpp_ring;
+SpscRing<WiFiEvent, 4> WiFiEvents::monitor_ring;
+WiFiEvents::Subscriber WiFiEvents::subscribers[max_subscribers];
+TaskHandle_t WiFiEvents::worker = nullptr;
+std::atomic<int> WiFiEvents::calling(-1);
+
+WiFiEvents::Config WiFiEvents::default_config() {
+	Config config;
+	config.core	    = EVENT_TASK_CORE < 0 ? tskNO_AFFINITY : EVENT_TASK_CORE;
+	config.priority   = EVENT_TASK_PRIORITY;
+	config.stack_size = EVENT_TASK_STACK;
+	return config;
+}
+
+esp_err_t WiFiEvents::start(const Config &config) {
+	if (worker) return ESP_ERR_INVALID_STATE;
+	if (xTaskCreatePinnedToCore(run, "wifi_events", config.stack_size, nullptr, config.priority, &worker, config.core) != pdPASS) {
+		worker = nullptr;
+		return ESP_ERR_NO_MEM;
+	}
+	return ESP_OK;
+}
+
+int WiFiEvents::subscribe(subscriber_t subscriber, void *arg, uint32_t mask) {
+	for (int i = 0; i < max_subscribers; i++) {
+		bool used = false;
+		if (!subscribers[i].used.compare_exchange_strong(used, true, std::memory_order_acquire)) continue;
+		subscribers[i].arg  = arg;
+		subscribers[i].mask = mask;
+		// Publishing fn last makes arg and mask visible to the worker first
+		subscribers[i].fn.store(subscriber, std::memory_order_release);
+		return i;
+	}
+	return -1;
+}
+
+void WiFiEvents::unsubscribe(int handle) {
+	if (handle < 0 || handle >= max_subscribers) return;
+	subscribers[handle].fn.store(nullptr);
+	// A call the worker already began runs to its end; from a subscriber itself, that is this call
+	if (xTaskGetCurrentTaskHandle() != worker) {
+		while (calling.load() == handle) vTaskDelay(1);
+	}
+	subscribers[handle].used.store(false, std::memory_order_release);
+}
+
+void WiFiEvents::notify() {
+	if (worker) xTaskNotifyGive(worker);
+}
+
+void WiFiEvents::publish(const WiFiEvent &event) {
+	loop_ring.push(event);
+	notify();
+}
+
+void WiFiEvents::publish_dpp(const WiFiEvent &event) {
+	dpp_ring.push(event);
+	notify();
+}
+
+void WiFiEvents::publish_monitor(const WiFiEvent &event) {
+	monitor_ring.push(event);
+	notify();
+}
+
+uint32_t WiFiEvents::dropped() {
+	return loop_ring.dropped() + dpp_ring.dropped() + monitor_ring.dropped();
+}
+
+void WiFiEvents::run(void *arg) {
+	WiFiEvent event;
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		while (pop_oldest(event)) dispatch(event);
+	}
+}
+
+// Merges the rings by timestamp, each of which is in order on its own
+bool WiFiEvents::pop_oldest(WiFiEvent &event) {
+	const WiFiEvent *loop = loop_ring.peek(), *dpp = dpp_ring.peek(), *monitor = monitor_ring.peek();
+	const WiFiEvent *oldest = loop;
+	if (dpp && (!oldest || dpp->timestamp_us < oldest->timestamp_us)) oldest = dpp;
+	if (monitor && (!oldest || monitor->timestamp_us < oldest->timestamp_us)) oldest = monitor;
+	if (!oldest) return false;
+
+	event = *oldest;
+	if (oldest == loop) loop_ring.release();
+	else if (oldest == dpp) dpp_ring.release();
+	else monitor_ring.release();
+	return true;
+}
+
+void WiFiEvents::dispatch(const WiFiEvent &event) {
+	log(event);
+	uint32_t bit = WIFI_EVENT_MASK(event.type);
+	for (int i = 0; i < max_subscribers; i++) {
+		Subscriber &s = subscribers[i];
+		// Announced before fn is read, so that unsubscribe() either sees the call or clears fn first
+		calling.store(i);
+		subscriber_t fn = s.fn.load();
+		if (fn && (s.mask & bit)) fn(event, s.arg);
+	}
+	calling.store(-1);
+}
+
+void WiFiEvents::log(const WiFiEvent &event) {
+	const uint8_t *b  = event.bssid;
+	const uint8_t *ip = reinterpret_cast<const uint8_t *>(&event.ip.addr);
+	switch (event.type) {
+		case WiFiEventType::LinkUp:
+			WIFI_LOG(Associated, b[0], b[1], b[2], b[3], b[4], b[5], event.channel, event.rssi);
+			break;
+		case WiFiEventType::Roam:
+			WIFI_LOG(Roamed, b[0], b[1], b[2], b[3], b[4], b[5], event.channel, event.rssi);
+			break;
+		case WiFiEventType::LinkDown:
+			WIFI_LOG(Disconnected, b[0], b[1], b[2], b[3], b[4], b[5], event.reason);
+			break;
+		case WiFiEventType::IpAcquired:
+			WIFI_LOG(GotIp, ip[0], ip[1], ip[2], ip[3]);
+			break;
+		case WiFiEventType::IpLost:
+			WIFI_LOG(LostIp);
+			break;
+		case WiFiEventType::Ip6Acquired:
+			WIFI_LOG(GotIp6, event.reason);
+			break;
+		case WiFiEventType::DppUriReady:
+			WIFI_LOG(DppUriReady);
+			break;
+		case WiFiEventType::DppConfigReceived:
+			WIFI_LOG(DppConfigReceived);
+			break;
+		case WiFiEventType::DppFailed:
+			WIFI_LOG(DppFailed, event.reason);
+			break;
+		case WiFiEventType::LinkDegraded:
+			WIFI_LOG(LinkDegraded);
+			break;
+		case WiFiEventType::LinkRestored:
+			WIFI_LOG(LinkRestored);
+			break;
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_err.h>
+#include <esp_netif.h>
+
+#include "spscRing.hpp"
+
+enum class WiFiEventType : uint8_t {
+	LinkUp,	    // Associated; bssid, channel, rssi
+	LinkDown,	    // Disassociated; bssid, reason
+	IpAcquired,   // ip
+	IpLost,
+	Roam,	    // Associated to another BSS of the same network; bssid, channel, rssi
+	DppUriReady,
+	DppConfigReceived,
+	DppFailed,    // reason
+	LinkDegraded,  // Gateway unreachable while associated, see HealthMonitor
+	LinkRestored,
+	Ip6Acquired,  // reason: esp_ip6_addr_type_t; the address is in WiFi::get_link()
+};
+
+#define WIFI_EVENT_MASK(type) (1u << static_cast<int>(type))
+#define WIFI_EVENT_MASK_ALL 0xffffffffu
+
+// Compact record, copied through the ring by value
+struct WiFiEvent {
+	int64_t timestamp_us;
+	WiFiEventType type;
+	int8_t rssi;
+	uint16_t reason;  // WiFi reason code, or esp_err_t for DppFailed
+	uint8_t channel;
+	uint8_t bssid[6];
+	esp_ip4_addr_t ip;
+};
+
+/*
+ * Typed event stream of the manager.
+ * WiFi::event_handler only pushes records into a lock-free ring; a dedicated
+ * worker task drains it, logs, and calls the subscribers, so that nothing
+ * slow runs on the system event loop.
+ * Events from the system loop, the DPP callback and the HealthMonitor travel
+ * through separate rings; the worker merges them by timestamp_us, so that
+ * subscribers see them in the order they happened.
+ */
+class WiFiEvents {
+    public:
+	typedef void (*subscriber_t)(const WiFiEvent& event, void* arg);
+
+	struct Config {
+		BaseType_t core;  // tskNO_AFFINITY or a core number
+		UBaseType_t priority;
+		uint32_t stack_size;
+	};
+
+	static Config default_config();
+	// Started by WiFi on initialize with default_config() unless already running
+	static esp_err_t start(const Config& config);
+
+	// Returns a handle for unsubscribe(), or -1 when all slots are taken
+	static int subscribe(subscriber_t subscriber, void* arg, uint32_t mask = WIFI_EVENT_MASK_ALL);
+	// Returns once the subscriber is no longer called, so that arg may be freed
+	static void unsubscribe(int handle);
+
+	// Producer for the system event loop task
+	static void publish(const WiFiEvent& event);
+	// Producer for the DPP supplicant callback, which runs on another task
+	static void publish_dpp(const WiFiEvent& event);
+	// Producer for the HealthMonitor task
+	static void publish_monitor(const WiFiEvent& event);
+
+	static uint32_t dropped();
+
+    private:
+	WiFiEvents();
+
+	static const int max_subscribers = 8;
+
+	struct Subscriber {
+		std::atomic<bool> used;
+		std::atomic<subscriber_t> fn;
+		void* arg;
+		uint32_t mask;
+	};
+
+	static SpscRing<WiFiEvent, 32> loop_ring;
+	static SpscRing<WiFiEvent, 8> dpp_ring;
+	static SpscRing<WiFiEvent, 4> monitor_ring;
+	static Subscriber subscribers[max_subscribers];
+	static TaskHandle_t worker;
+	static std::atomic<int> calling;  // Subscriber the worker is at, -1 between events
+
+	static void notify();
+	static void run(void* arg);
+	static bool pop_oldest(WiFiEvent& event);
+	static void dispatch(const WiFiEvent& event);
+	static void log(const WiFiEvent& event);
+};
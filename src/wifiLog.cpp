@@ -0,0 +1,81 @@
+#include "wifiLog.hpp"
+
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_timer.h>
+#else
+#include <time.h>
+#endif
+
+WiFiLog::Slot WiFiLog::slots[WiFiLog::entries];
+std::atomic<uint32_t> WiFiLog::head(0);
+
+// FNV-1a, one recursion per character so that it stays a C++11 constant expression
+static constexpr uint32_t fnv(const char *s, uint32_t hash) {
+	return *s ? fnv(s + 1, (hash ^ static_cast<uint8_t>(*s)) * 16777619u) : hash;
+}
+
+#define WIFI_LOG_HASH_OPEN(name, level, format) fnv(format,
+#define WIFI_LOG_HASH_CLOSE(name, level, format) )
+static constexpr uint32_t formats_hash = WIFI_LOG_FORMATS(WIFI_LOG_HASH_OPEN) 2166136261u WIFI_LOG_FORMATS(WIFI_LOG_HASH_CLOSE);
+#undef WIFI_LOG_HASH_OPEN
+#undef WIFI_LOG_HASH_CLOSE
+
+static uint32_t now_us() {
+#ifdef ESP_PLATFORM
+	return static_cast<uint32_t>(esp_timer_get_time());
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint32_t>(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+#endif
+}
+
+uint32_t WiFiLog::table_hash() {
+	return formats_hash;
+}
+
+void WiFiLog::commit(LogId id, uint8_t level, const int32_t *args, int argc) {
+	uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+	Slot &slot	   = slots[index & (entries - 1)];
+
+	slot.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.entry.index	 = index;
+	slot.entry.time_us = now_us();
+	slot.entry.id	 = static_cast<uint16_t>(id);
+	slot.entry.level	 = level;
+	slot.entry.argc	 = static_cast<uint8_t>(argc);
+	memcpy(slot.entry.args, args, argc * sizeof(int32_t));
+	slot.seq.store(index + 1, std::memory_order_release);
+}
+
+int WiFiLog::dump(writer_t writer, void *arg) {
+	uint32_t end   = head.load(std::memory_order_acquire);
+	uint32_t begin = end > entries ? end - entries : 0;
+
+	Header header	   = {};
+	header.magic	   = magic;
+	header.version	   = version;
+	header.entry_size = sizeof(Entry);
+	header.table_hash = formats_hash;
+	header.written	   = end;
+	int err		   = writer(&header, sizeof(header), arg);
+
+	for (uint32_t index = begin; !err && index != end; index++) {
+		const Slot &slot = slots[index & (entries - 1)];
+		uint32_t before  = slot.seq.load(std::memory_order_acquire);
+		Entry copy;
+		memcpy(&copy, &slot.entry, sizeof(copy));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		// Overwritten by a newer lap, or still being written
+		if (before != index + 1 || slot.seq.load(std::memory_order_relaxed) != before) continue;
+		err = writer(&copy, sizeof(copy), arg);
+	}
+	return err;
+}
+
+uint32_t WiFiLog::written() {
+	return head.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#include "wifiLogFormats.hpp"
+
+#ifdef CONFIG_WIFI_MANAGER_LOG_LEVEL
+#define WIFI_LOG_LEVEL CONFIG_WIFI_MANAGER_LOG_LEVEL
+#else
+#define WIFI_LOG_LEVEL 3
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_LOG_ENTRIES
+#define WIFI_LOG_ENTRIES CONFIG_WIFI_MANAGER_LOG_ENTRIES
+#else
+#define WIFI_LOG_ENTRIES 64
+#endif
+
+#define WIFI_LOG_ID(name, level, format) name,
+enum class LogId : uint16_t {
+	WIFI_LOG_FORMATS(WIFI_LOG_ID)
+};
+#undef WIFI_LOG_ID
+
+#define WIFI_LOG_LEVEL_OF(name, level, format) WIFI_LOG_LEVEL_##name = level,
+enum : uint8_t {
+	WIFI_LOG_FORMATS(WIFI_LOG_LEVEL_OF)
+};
+#undef WIFI_LOG_LEVEL_OF
+
+// Messages above CONFIG_WIFI_MANAGER_LOG_LEVEL compile to nothing
+#define WIFI_LOG(name, ...)                                                                             \
+	do {                                                                                               \
+		if (WIFI_LOG_LEVEL_##name <= WIFI_LOG_LEVEL) WiFiLog::write(LogId::name, WIFI_LOG_LEVEL_##name, ##__VA_ARGS__); \
+	} while (0)
+
+/*
+ * Flight recorder of the component: WIFI_LOG() stores the message id and
+ * its raw integer arguments into a RAM ring, lock-free from any task or
+ * core, and never formats. The oldest entries are overwritten.
+ * dump() streams the ring out; tools/log_decode formats it on a host.
+ * Arguments must be integers of at most 32 bits, so strings, and with them
+ * SSIDs and passwords, cannot end up in the log.
+ */
+class WiFiLog {
+    public:
+	static const uint32_t magic	   = 0x474c4d57;  // "WMLG"
+	static const uint16_t version  = 1;
+	static const int max_args	   = 8;
+	static const size_t entries	   = WIFI_LOG_ENTRIES;
+
+	struct Entry {
+		uint32_t index;  // Position in the stream; gaps were overwritten before the dump
+		uint32_t time_us;  // Low 32 bits of the monotonic clock
+		uint16_t id;	   // LogId
+		uint8_t level;
+		uint8_t argc;
+		int32_t args[max_args];
+	};
+
+	// Precedes the entries of a dump
+	struct Header {
+		uint32_t magic;
+		uint16_t version;
+		uint16_t entry_size;
+		uint32_t table_hash;  // Of the format table, the decoder refuses another one
+		uint32_t written;	  // Entries recorded since boot
+	};
+
+	// Returns 0 to go on
+	typedef int (*writer_t)(const void* data, size_t len, void* arg);
+
+	template <typename... A>
+	static void write(LogId id, uint8_t level, A... args) {
+		static_assert(sizeof...(A) <= max_args, "too many WIFI_LOG arguments");
+		int32_t values[] = {0, arg(args)...};
+		commit(id, level, values + 1, sizeof...(A));
+	}
+
+	// Header, then the entries still in the ring, oldest first
+	static int dump(writer_t writer, void* arg);
+	static uint32_t written();
+
+	static uint32_t table_hash();
+
+    private:
+	WiFiLog();
+
+	static_assert(entries >= 2 && (entries & (entries - 1)) == 0, "CONFIG_WIFI_MANAGER_LOG_ENTRIES must be a power of two");
+
+	struct Slot {
+		std::atomic<uint32_t> seq;  // index + 1 once complete, 0 while written
+		Entry entry;
+	};
+
+	static Slot slots[entries];
+	static std::atomic<uint32_t> head;
+
+	template <typename T>
+	static int32_t arg(T value) {
+		static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+				    "WIFI_LOG takes integers only, strings are never logged");
+		static_assert(sizeof(T) <= sizeof(int32_t), "WIFI_LOG arguments are at most 32 bits");
+		return static_cast<int32_t>(value);
+	}
+
+	static void commit(LogId id, uint8_t level, const int32_t* args, int argc);
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+ * Every message WIFI_LOG() can record: X(name, level, format).
+ * Shared by the device, which only stores the name's index and the raw
+ * arguments, and by tools/log_decode, which formats them.
+ * Formats take up to WiFiLog::max_args int sized conversions (%d %u %x).
+ * Entries are only ever appended, the index is the on-wire id.
+ * Levels: 1 error, 2 warning, 3 info, 4 debug.
+ */
+#define WIFI_LOG_FORMATS(X)                                                                                 \
+	X(StaStarting, 3, "STA starting")                                                                      \
+	X(DppListening, 3, "started listening for DPP authentication")                                       \
+	X(InitDone, 3, "wifi_init_sta finished")                                                             \
+	X(Connected, 3, "connected to SSID hash %08x on channel %d")                                         \
+	X(ConnectFailed, 3, "failed to connect to SSID hash %08x after %d retries")                         \
+	X(DppAuthFailed, 3, "DPP authentication failed after %d retries")                                    \
+	X(UnexpectedBits, 1, "unexpected event bits %08x")                                                   \
+	X(ScanStartFailed, 2, "targeted scan on channel %d failed to start")                                \
+	X(ScanWidened, 3, "SSID not on %d known channels, widening to full sweep")                           \
+	X(RoamScanStartFailed, 2, "roam scan on channel %d failed to start")                                \
+	X(RoamTarget, 3, "roaming to BSSID %02x:%02x:%02x:%02x:%02x:%02x, channel %d, rssi %d")             \
+	X(Associated, 3, "associated BSSID %02x:%02x:%02x:%02x:%02x:%02x, channel %d, rssi %d")             \
+	X(Roamed, 3, "roamed to BSSID %02x:%02x:%02x:%02x:%02x:%02x, channel %d, rssi %d")                  \
+	X(Disconnected, 3, "disconnected BSSID %02x:%02x:%02x:%02x:%02x:%02x, reason %d")                   \
+	X(GotIp, 3, "got ip %d.%d.%d.%d")                                                                    \
+	X(LostIp, 3, "lost ip")                                                                              \
+	X(GotIp6, 3, "got ipv6, type %d")                                                                    \
+	X(DppUriReady, 3, "DPP URI ready")                                                                   \
+	X(DppConfigReceived, 3, "DPP authentication successful")                                             \
+	X(DppFailed, 3, "DPP authentication failed, reason %d")                                              \
+	X(LinkDegraded, 2, "link degraded, gateway unreachable")                                             \
+	X(LinkRestored, 3, "link restored")                                                                  \
+	X(HealthSocketError, 2, "health probe socket error %d")                                              \
+	X(BringUpReady, 3, "bring-up ready in %d ms")                                                        \
+	X(BringUpStageFailed, 2, "bring-up stage %d error %d")                                              \
+	X(PortalStarted, 3, "provisioning portal started")                                                   \
+	X(PortalProvisioned, 3, "portal submitted SSID hash %08x")                                           \
+	X(MemOverBudget, 2, "memory phase %d peaked at %d bytes, budget %d")                                 \
+	X(ReconnectDeferred, 3, "reconnect in %d ms, admission window %d ms")
@@ -2,18 +2,31 @@
 
 #include <lwip/inet.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
 
+#include <esp_idf_version.h>
 #include <esp_log.h>
+#include <esp_system.h>
+#include <esp_timer.h>
 
-#define TAG "WiFi Manager"
+#include <nvs_flash.h>
+
+#include "configStore.hpp"
+#include "memProfile.hpp"
+#include "portal.hpp"
+#include "wifiCapture.hpp"
+#include "wifiLog.hpp"
+#include "wifiTrace.hpp"
 
-#undef CONFIG_ESP_WIFI_AUTH_OPEN
-#undef CONFIG_ESP_WIFI_AUTH_WEP
-#define CONFIG_ESP_WIFI_AUTH_WPA_PSK
-#undef CONFIG_ESP_WIFI_AUTH_WPA2_PSK
-#undef CONFIG_ESP_WIFI_AUTH_WPA_WPA2_PSK
+#ifdef CONFIG_WPA_11KV_SUPPORT
+#include <esp_rrm.h>
+#include <esp_wnm.h>
+#endif
+
+#define TAG "WiFi Manager"
 
+// Lowest mode accepted for AuthMode::Psk, from the project's CONFIG_ESP_WIFI_AUTH_* choice
 #if defined(CONFIG_ESP_WIFI_AUTH_OPEN)
 #define ESP_WIFI_SCAN_AUTH_MODE_THRESHOLD WIFI_AUTH_OPEN
 #elif defined(CONFIG_ESP_WIFI_AUTH_WEP)
@@ -30,63 +43,942 @@
 #define ESP_WIFI_SCAN_AUTH_MODE_THRESHOLD WIFI_AUTH_WPA2_WPA3_PSK
 #elif defined(CONFIG_ESP_WIFI_AUTH_WAPI_PSK)
 #define ESP_WIFI_SCAN_AUTH_MODE_THRESHOLD WIFI_AUTH_WAPI_PSK
+#else
+#define ESP_WIFI_SCAN_AUTH_MODE_THRESHOLD WIFI_AUTH_WPA_PSK
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_SCAN_PLANNER
+#define SCAN_TARGETED_CHANNELS CONFIG_WIFI_MANAGER_SCAN_TARGETED_CHANNELS
+#define SCAN_DWELL_MIN_MS CONFIG_WIFI_MANAGER_SCAN_DWELL_MIN_MS
+#define SCAN_DWELL_MAX_MS CONFIG_WIFI_MANAGER_SCAN_DWELL_MAX_MS
+#else
+#define SCAN_TARGETED_CHANNELS 0
+#define SCAN_DWELL_MIN_MS 20
+#define SCAN_DWELL_MAX_MS 50
+#endif
+
+#if defined(CONFIG_WIFI_MANAGER_POWER_MAX_THROUGHPUT)
+#define DEFAULT_POWER_PROFILE PowerProfile::MaxThroughput
+#elif defined(CONFIG_WIFI_MANAGER_POWER_MIN_POWER)
+#define DEFAULT_POWER_PROFILE PowerProfile::MinPower
+#else
+#define DEFAULT_POWER_PROFILE PowerProfile::Balanced
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_AP_DTIM_PERIOD
+#define AP_DTIM_PERIOD CONFIG_WIFI_MANAGER_AP_DTIM_PERIOD
+#else
+#define AP_DTIM_PERIOD 1
+#endif
+
+#if defined(CONFIG_WIFI_MANAGER_RADIO_BULK_UPLOAD)
+#define DEFAULT_RADIO_PROFILE RadioProfile::BulkUpload
+#elif defined(CONFIG_WIFI_MANAGER_RADIO_LOW_MEMORY)
+#define DEFAULT_RADIO_PROFILE RadioProfile::LowMemory
+#elif defined(CONFIG_WIFI_MANAGER_RADIO_LOW_LATENCY)
+#define DEFAULT_RADIO_PROFILE RadioProfile::LowLatency
+#else
+#define DEFAULT_RADIO_PROFILE RadioProfile::Default
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_ROAMING
+#define ROAMING 1
+#define ROAM_RSSI_THRESHOLD CONFIG_WIFI_MANAGER_ROAM_RSSI_THRESHOLD
+#define ROAM_HYSTERESIS_DB CONFIG_WIFI_MANAGER_ROAM_HYSTERESIS_DB
+#define ROAM_COOLDOWN_MS CONFIG_WIFI_MANAGER_ROAM_COOLDOWN_MS
+#else
+#define ROAMING 0
+#define ROAM_RSSI_THRESHOLD -70
+#define ROAM_HYSTERESIS_DB 8
+#define ROAM_COOLDOWN_MS 10000
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_ADMISSION
+#define ADMISSION 1
+#define ADMISSION_WINDOW_MS CONFIG_WIFI_MANAGER_ADMISSION_WINDOW_MS
+#define ADMISSION_MAX_WINDOW_MS CONFIG_WIFI_MANAGER_ADMISSION_MAX_WINDOW_MS
+#define ADMISSION_GIVE_UP_MS CONFIG_WIFI_MANAGER_ADMISSION_GIVE_UP_MS
+#else
+#define ADMISSION 0
+#define ADMISSION_WINDOW_MS 8000
+#define ADMISSION_MAX_WINDOW_MS 120000
+#define ADMISSION_GIVE_UP_MS 300000
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_IPV6
+#define IPV6 1
+#else
+#define IPV6 0
+#endif
+
+#if defined(CONFIG_WIFI_MANAGER_IP_READY_ANY)
+#define DEFAULT_IP_POLICY IpPolicy::Any
+#elif defined(CONFIG_WIFI_MANAGER_IP_READY_BOTH)
+#define DEFAULT_IP_POLICY IpPolicy::Both
+#else
+#define DEFAULT_IP_POLICY IpPolicy::Ipv4
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_PORTAL
+#define PORTAL 1
+#define PORTAL_CHANNEL CONFIG_WIFI_MANAGER_PORTAL_CHANNEL
+#define PORTAL_LINGER_MS CONFIG_WIFI_MANAGER_PORTAL_LINGER_MS
+#else
+#define PORTAL 0
+#define PORTAL_CHANNEL 1
+#define PORTAL_LINGER_MS 5000
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_CONFIG_STORE
+#define CONFIG_STORE 1
+#else
+#define CONFIG_STORE 0
 #endif
+#define CONFIG_STORE_NAMESPACE "wifi_mgr"
+
+// Events posted to the default loop so that the engine only runs on the event task
+ESP_EVENT_DEFINE_BASE(WIFI_MANAGER_ROAM_EVENT);
+enum {
+	ROAM_EVENT_NEIGHBOR_REPORT,
+	ROAM_EVENT_TIMEOUT,
+	ROAM_EVENT_FORCE,
+};
+
+// The reconnect slot came up; connecting from the event task keeps the retry state there
+ESP_EVENT_DEFINE_BASE(WIFI_MANAGER_ADMISSION_EVENT);
+
+// New credentials from provision(), applied on the event task; the handler wipes them
+ESP_EVENT_DEFINE_BASE(WIFI_MANAGER_PROVISION_EVENT);
+
+// A new power profile; the listen interval goes into wifi_config on the event task
+ESP_EVENT_DEFINE_BASE(WIFI_MANAGER_POWER_EVENT);
+
+struct ProvisionRequest {
+	char ssid[33];
+	char password[64];
+};
+
+// Handlers do not get the posted size, so the report carries its own
+struct NeighborReport {
+	uint16_t len;
+	uint8_t elements[256];  // 17 neighbors of 15 bytes
+};
+
+// 100 TU, the beacon interval nearly every AP uses
+#define BEACON_INTERVAL_US 102400
+#define BEACONS_MS(beacons) (((beacons) * BEACON_INTERVAL_US + 999) / 1000)
+
+// The driver's own connect scan visits 13 channels with up to 120ms active dwell each
+#define SCAN_FULL_SWEEP_US (13 * 120 * 1000)
 
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT BIT1
 #define WIFI_AUTH_FAIL_BIT BIT2
+#define LINK_STOPPED_BIT BIT3
+#define LINK_CONNECTING_BIT BIT4
+#define LINK_ASSOCIATED_BIT BIT5
+#define LINK_STATE_BITS (LINK_STOPPED_BIT | LINK_CONNECTING_BIT | LINK_ASSOCIATED_BIT | WIFI_CONNECTED_BIT | WIFI_FAIL_BIT)
 
 bool WiFi::initialized = false;
-bool WiFi::connected = false;
 
-esp_ip4_addr_t WiFi::ip;
+Seqlock<LinkSnapshot> WiFi::link;
+
+static EventBits_t link_state_bit(LinkState state) {
+	switch (state) {
+		case LinkState::Connecting:
+			return LINK_CONNECTING_BIT;
+		case LinkState::Associated:
+			return LINK_ASSOCIATED_BIT;
+		case LinkState::Up:
+			return WIFI_CONNECTED_BIT;
+		case LinkState::Failed:
+			return WIFI_FAIL_BIT;
+		default:
+			return LINK_STOPPED_BIT;
+	}
+}
 
 /* FreeRTOS event group to signal when we are connected*/
 EventGroupHandle_t WiFi::s_wifi_event_group;
 esp_event_handler_instance_t WiFi::instance_any_id;
-esp_event_handler_instance_t WiFi::instance_got_ip;
+esp_event_handler_instance_t WiFi::instance_ip;
+esp_netif_t *WiFi::sta_netif	= nullptr;
+WiFi::IpPolicy WiFi::ip_policy = DEFAULT_IP_POLICY;
 
 int WiFi::s_retry_num = 0;
 WiFi::SetupMode WiFi::mode = SetupMode::Normal;
 wifi_config_t WiFi::wifi_config = {};
 
+ScanPlanner WiFi::planner;
+ScanPlanner::Plan WiFi::scan_plan = {};
+uint8_t WiFi::scan_index		= 0;
+int64_t WiFi::scan_started_us	= 0;
+
+const WiFi::PowerSettings WiFi::power_settings[] = {
+	{WIFI_PS_NONE, 3, 6, 10},  // MaxThroughput
+	// Balanced, every DTIM
+	{WIFI_PS_MIN_MODEM, 3, 6, BEACONS_MS(AP_DTIM_PERIOD)},
+	// MinPower, every listen interval; the DTIM period is at most 10
+	{WIFI_PS_MAX_MODEM, 10, 10, BEACONS_MS(10)},
+};
+WiFi::PowerProfile WiFi::power_profile		= DEFAULT_POWER_PROFILE;
+uint16_t WiFi::associated_listen_interval = 0;
+int64_t WiFi::associated_us			    = 0;
+
+// Only used by the next association, the current one keeps its negotiated value
+void WiFi::load_listen_interval() {
+	wifi_config.sta.listen_interval = power_settings[static_cast<int>(power_profile)].listen_interval;
+}
+
+esp_err_t WiFi::apply_power_profile() {
+	const PowerSettings &p = power_settings[static_cast<int>(power_profile)];
+	esp_err_t err = esp_wifi_set_ps(p.ps);
+	if (err) return err;
+	return esp_wifi_set_inactive_time(WIFI_IF_STA, p.beacon_timeout_s);
+}
+
+esp_err_t WiFi::set_power_profile(PowerProfile profile) {
+	power_profile = profile;
+	if (!initialized) return ESP_OK;
+
+	esp_err_t err = apply_power_profile();
+	// wifi_config belongs to the event task
+	if (!err) err = esp_event_post(WIFI_MANAGER_POWER_EVENT, 0, NULL, 0, pdMS_TO_TICKS(100));
+	if (err) ESP_LOGE(TAG, "power profile %d error %d", static_cast<int>(profile), err);
+	return err;
+}
+
+WiFi::PowerProfile WiFi::get_power_profile() {
+	return power_profile;
+}
+
+uint32_t WiFi::wake_interval_us() {
+	const PowerSettings &p = power_settings[static_cast<int>(power_profile)];
+	uint32_t beacons;
+	switch (p.ps) {
+		case WIFI_PS_MIN_MODEM:
+			beacons = AP_DTIM_PERIOD;
+			break;
+		case WIFI_PS_MAX_MODEM:
+			beacons = is_associated(link.read().state) ? associated_listen_interval : p.listen_interval;
+			if (beacons < AP_DTIM_PERIOD) beacons = AP_DTIM_PERIOD;
+			break;
+		default:
+			return 0;
+	}
+	return beacons * BEACON_INTERVAL_US;
+}
+
+int64_t WiFi::wake_anchor_us() {
+	return associated_us;
+}
+
+uint32_t WiFi::expected_downlink_latency_ms() {
+	uint32_t interval = wake_interval_us();
+	if (interval == 0) return power_settings[static_cast<int>(power_profile)].latency_target_ms;
+
+	// Frames buffered by the AP wait at most one wake period
+	return (interval + 999) / 1000;
+}
+
+#define PROTOCOL_BGN (WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N)
+
+const WiFi::RadioSettings WiFi::radio_presets[] = {
+	{WIFI_BW_HT40, PROTOCOL_BGN, 80},  // Default, not applied
+	{WIFI_BW_HT40, PROTOCOL_BGN, 80},  // BulkUpload: widest channel, full power
+	{WIFI_BW_HT20, PROTOCOL_BGN, 60},  // LowMemory: sensor nodes, 15dBm is enough
+	{WIFI_BW_HT20, PROTOCOL_BGN, 80},  // LowLatency: 20MHz is less exposed to overlapping BSS contention
+};
+WiFi::RadioProfile WiFi::radio_profile   = DEFAULT_RADIO_PROFILE;
+WiFi::RadioSettings WiFi::radio_settings = radio_presets[static_cast<int>(DEFAULT_RADIO_PROFILE)];
+
+esp_err_t WiFi::apply_radio_settings(bool started) {
+	if (radio_profile == RadioProfile::Default) return ESP_OK;
+
+	esp_err_t err = esp_wifi_set_protocol(WIFI_IF_STA, radio_settings.protocol);
+	if (err) return err;
+	err = esp_wifi_set_bandwidth(WIFI_IF_STA, radio_settings.bandwidth);
+	if (err) return err;
+	// TX power can only be set once the driver is started
+	if (started) err = esp_wifi_set_max_tx_power(radio_settings.max_tx_power);
+	return err;
+}
+
+esp_err_t WiFi::set_radio_profile(RadioProfile profile) {
+	if (profile == RadioProfile::Custom) return ESP_ERR_INVALID_ARG;
+	radio_profile  = profile;
+	radio_settings = radio_presets[static_cast<int>(profile)];
+	if (!initialized) return ESP_OK;
+
+	esp_err_t err = apply_radio_settings(true);
+	if (err) ESP_LOGE(TAG, "radio profile %s error %d", get_radio_profile_name(), err);
+	return err;
+}
+
+esp_err_t WiFi::set_radio_settings(const RadioSettings &settings) {
+	radio_profile  = RadioProfile::Custom;
+	radio_settings = settings;
+	if (!initialized) return ESP_OK;
+
+	esp_err_t err = apply_radio_settings(true);
+	if (err) ESP_LOGE(TAG, "radio settings error %d", err);
+	return err;
+}
+
+WiFi::RadioProfile WiFi::get_radio_profile() {
+	return radio_profile;
+}
+
+const char *WiFi::get_radio_profile_name() {
+	switch (radio_profile) {
+		case RadioProfile::BulkUpload:
+			return "bulk_upload";
+		case RadioProfile::LowMemory:
+			return "low_memory";
+		case RadioProfile::LowLatency:
+			return "low_latency";
+		case RadioProfile::Custom:
+			return "custom";
+		default:
+			return "default";
+	}
+}
+
+static WiFi::AuthConfig default_auth_config() {
+	WiFi::AuthConfig config = {};
+	config.mode		    = WiFi::AuthMode::Psk;
+	return config;
+}
+
+WiFi::AuthConfig WiFi::auth_config = default_auth_config();
+WiFi::AuthStats WiFi::auth_stats[3]  = {};
+int64_t WiFi::connect_started_us	  = 0;
+uint8_t WiFi::session_bssids[8][6];
+uint8_t WiFi::session_bssid_count = 0;
+bool WiFi::parked			    = false;
+bool WiFi::driver_released	    = false;
+bool WiFi::eap_enabled		    = false;
+
+esp_err_t WiFi::set_auth_config(const AuthConfig &config) {
+	if (initialized) return ESP_ERR_INVALID_STATE;
+	auth_config = config;
+	return ESP_OK;
+}
+
+WiFi::AuthStats WiFi::get_auth_stats(AuthMode mode) {
+	return auth_stats[static_cast<int>(mode)];
+}
+
+void WiFi::set_ip_policy(IpPolicy policy) {
+	ip_policy = policy;
+}
+
+WiFi::IpPolicy WiFi::get_ip_policy() {
+	return ip_policy;
+}
+
+esp_err_t WiFi::apply_auth_config(const char *password) {
+	wifi_sta_config_t &sta = wifi_config.sta;
+	sta.pmf_cfg.capable	  = true;
+	if (eap_enabled && auth_config.mode != AuthMode::Enterprise) {
+		// Left on, the supplicant would keep answering with EAP on a personal network
+		esp_err_t err = esp_wifi_sta_wpa2_ent_disable();
+		if (err) return err;
+		eap_enabled = false;
+	}
+	switch (auth_config.mode) {
+		case AuthMode::Sae:
+			sta.threshold.authmode = WIFI_AUTH_WPA3_PSK;
+			sta.pmf_cfg.required   = true;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0) && \
+    (defined(CONFIG_ESP_WIFI_ENABLE_WPA3_SAE) || defined(CONFIG_ESP32_WIFI_ENABLE_WPA3_SAE))
+			// Hash-to-element derives the password element once, without the hunting-and-pecking loop
+			sta.sae_pwe_h2e = WPA3_SAE_PWE_BOTH;
+#endif
+			return ESP_OK;
+		case AuthMode::Enterprise:
+			sta.threshold.authmode = WIFI_AUTH_WPA2_ENTERPRISE;
+			return apply_eap_config(password);
+		default:
+			sta.threshold.authmode = ESP_WIFI_SCAN_AUTH_MODE_THRESHOLD;
+			return ESP_OK;
+	}
+}
+
+esp_err_t WiFi::apply_eap_config(const char *password) {
+	const AuthConfig &a = auth_config;
+	esp_err_t err	  = ESP_OK;
+	if (a.identity) err = esp_wifi_sta_wpa2_ent_set_identity((const unsigned char *)a.identity, strlen(a.identity));
+	if (!err && a.ca_cert) err = esp_wifi_sta_wpa2_ent_set_ca_cert(a.ca_cert, a.ca_cert_len);
+	if (err) return err;
+
+	switch (a.eap_method) {
+		case EapMethod::Tls:
+			err = esp_wifi_sta_wpa2_ent_set_cert_key(a.client_cert, a.client_cert_len, a.client_key, a.client_key_len, nullptr, 0);
+			break;
+		default:
+			if (a.password) password = a.password;
+			if (a.username) err = esp_wifi_sta_wpa2_ent_set_username((const unsigned char *)a.username, strlen(a.username));
+			if (!err && password) err = esp_wifi_sta_wpa2_ent_set_password((const unsigned char *)password, strlen(password));
+			break;
+	}
+	if (err) return err;
+	err = esp_wifi_sta_wpa2_ent_enable();
+	if (!err) eap_enabled = true;
+	return err;
+}
+
+esp_err_t WiFi::start_connect() {
+	connect_started_us = esp_timer_get_time();
+	return esp_wifi_connect();
+}
+
+// The supplicant keeps one PMKSA per BSS for SAE and EAP, so a rejoin may skip the full handshake
+void WiFi::record_handshake(const uint8_t bssid[6]) {
+	bool rejoined = false;
+	for (int i = 0; i < session_bssid_count; i++) rejoined |= memcmp(session_bssids[i], bssid, 6) == 0;
+	if (!rejoined) {
+		// Most recent first, the oldest falls out
+		if (session_bssid_count < 8) session_bssid_count++;
+		memmove(session_bssids[1], session_bssids[0], (session_bssid_count - 1) * 6);
+		memcpy(session_bssids[0], bssid, 6);
+	}
+
+	// Transitions the supplicant makes on its own (BTM) have no start time
+	if (!connect_started_us) return;
+	uint32_t elapsed	   = static_cast<uint32_t>(esp_timer_get_time() - connect_started_us);
+	connect_started_us = 0;
+
+	AuthStats &a	    = auth_stats[static_cast<int>(auth_config.mode)];
+	HandshakeStats &h = rejoined && auth_config.mode != AuthMode::Psk ? a.rejoined : a.initial;
+	h.count++;
+	h.last_us = elapsed;
+	h.total_us += elapsed;
+	if (elapsed > h.max_us) h.max_us = elapsed;
+}
+
+esp_err_t WiFi::connect_to_ap() {
+	scan_plan = planner.plan(wifi_config.sta.ssid, sizeof(wifi_config.sta.ssid), SCAN_TARGETED_CHANNELS);
+	if (scan_plan.count == 0) {
+		// Nothing learned yet, let the driver sweep every channel
+		planner.record_full_sweep();
+		wifi_config.sta.channel = 0;
+		esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+		return start_connect();
+	}
+
+	scan_index	     = 0;
+	scan_started_us = esp_timer_get_time();
+	scan_next_channel();
+	return ESP_OK;
+}
+
+// The configured SSID is not terminated when it takes all 32 bytes; one scan runs at a time
+uint8_t *WiFi::scan_ssid() {
+	static uint8_t ssid[sizeof(wifi_config.sta.ssid) + 1];
+	memcpy(ssid, wifi_config.sta.ssid, sizeof(wifi_config.sta.ssid));
+	return ssid;
+}
+
+void WiFi::scan_next_channel() {
+	wifi_scan_config_t scan_config	= {};
+	scan_config.ssid				= scan_ssid();
+	scan_config.channel				= scan_plan.channels[scan_index];
+	scan_config.scan_type			= WIFI_SCAN_TYPE_ACTIVE;
+	scan_config.scan_time.active.min = SCAN_DWELL_MIN_MS;
+	scan_config.scan_time.active.max = SCAN_DWELL_MAX_MS;
+
+	if (esp_wifi_scan_start(&scan_config, false) != ESP_OK) {
+		WIFI_LOG(ScanStartFailed, scan_config.channel);
+		finish_targeted_scan(0);
+	}
+}
+
+void WiFi::scan_done() {
+	static wifi_ap_record_t records[4];
+
+	uint8_t hit_channel = 0;
+	uint16_t number	= sizeof(records) / sizeof(records[0]);
+	if (esp_wifi_scan_get_ap_records(&number, records) == ESP_OK) {
+		int8_t best_rssi = INT8_MIN;
+		for (uint16_t i = 0; i < number; i++) {
+			// The scan is filtered by SSID, so every record is ours
+			planner.observe(records[i].ssid, sizeof(records[i].ssid), records[i].primary, ScanPlanner::weight_scan);
+			if (records[i].rssi > best_rssi) {
+				best_rssi	  = records[i].rssi;
+				hit_channel = records[i].primary;
+			}
+		}
+	}
+
+	scan_index++;
+	if (!hit_channel && scan_index < scan_plan.count) {
+		scan_next_channel();
+		return;
+	}
+	finish_targeted_scan(hit_channel);
+}
+
+void WiFi::finish_targeted_scan(uint8_t hit_channel) {
+	uint32_t elapsed = static_cast<uint32_t>(esp_timer_get_time() - scan_started_us);
+	planner.record_targeted(hit_channel != 0, scan_index, elapsed, SCAN_FULL_SWEEP_US);
+	if (!hit_channel) WIFI_LOG(ScanWidened, scan_plan.count);
+	scan_plan.count = 0;
+
+	// Channel 0 makes the driver sweep all channels again
+	wifi_config.sta.channel = hit_channel;
+	esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+	start_connect();
+}
+
+static RoamEngine::Config roam_config() {
+	RoamEngine::Config config = RoamEngine::default_config();
+	config.rssi_threshold	   = ROAM_RSSI_THRESHOLD;
+	config.hysteresis_db	   = ROAM_HYSTERESIS_DB;
+	config.cooldown_ms		   = ROAM_COOLDOWN_MS;
+	return config;
+}
+
+RoamEngine WiFi::roam(roam_config());
+esp_timer_handle_t WiFi::roam_timer = nullptr;
+esp_event_handler_instance_t WiFi::instance_roam;
+uint8_t WiFi::roam_channels[RoamEngine::max_channels];
+uint8_t WiFi::roam_channel_count = 0;
+uint8_t WiFi::roam_scan_index	   = 0;
+
+// 802.11k/v let the AP name candidates and steer the move, 802.11r shortens the reassociation
+static void set_roaming_capabilities(wifi_sta_config_t &sta) {
+	if (!ROAMING) return;
+#ifdef CONFIG_WPA_11KV_SUPPORT
+	sta.rm_enabled  = 1;
+	sta.btm_enabled = 1;
+#endif
+#ifdef CONFIG_WPA_11R_SUPPORT
+	sta.ft_enabled = 1;
+#endif
+}
+
+void WiFi::roam_step(const RoamEngine::Step &step) {
+	switch (step.action) {
+		case RoamEngine::Action::RequestNeighbors: {
+			ScanPlanner::Plan known = planner.plan(wifi_config.sta.ssid, sizeof(wifi_config.sta.ssid), RoamEngine::max_channels);
+			roam.set_known_channels(known.channels, known.count);
+#ifdef CONFIG_WPA_11KV_SUPPORT
+			if (esp_rrm_is_rrm_supported_connection() && esp_rrm_send_neighbor_rep_request(neighbor_report, nullptr) == 0) break;
+#endif
+			// The AP does not do 802.11k, go straight to the fallback channels
+			roam_step(roam.on_timeout(esp_timer_get_time()));
+			return;
+		}
+		case RoamEngine::Action::Scan:
+			memcpy(roam_channels, step.channels, step.channel_count);
+			roam_channel_count = step.channel_count;
+			roam_scan_index	   = 0;
+			roam_scan_next();
+			break;
+		case RoamEngine::Action::Transition:
+			roam_transition(step.target);
+			break;
+		default:
+			break;
+	}
+	roam_schedule();
+}
+
+// Runs the engine's deadline, or re-arms the RSSI trigger once the engine is idle again
+void WiFi::roam_schedule() {
+	esp_timer_stop(roam_timer);
+	int64_t now = esp_timer_get_time();
+	int64_t at  = roam.busy() ? roam.deadline_us() : roam.quiet_until_us();
+	if (!roam.busy() && at <= now) {
+		// The driver reports WIFI_EVENT_STA_BSS_RSSI_LOW once per arming
+		esp_wifi_set_rssi_threshold(ROAM_RSSI_THRESHOLD);
+		return;
+	}
+	// A scan has no deadline, WIFI_EVENT_SCAN_DONE moves it on
+	if (at == 0) return;
+	esp_timer_start_once(roam_timer, at > now ? at - now : 0);
+}
+
+void WiFi::roam_timeout(void *arg) {
+	esp_event_post(WIFI_MANAGER_ROAM_EVENT, ROAM_EVENT_TIMEOUT, nullptr, 0, 0);
+}
+
+static AdmissionScheduler::Config admission_config() {
+	AdmissionScheduler::Config config = AdmissionScheduler::default_config();
+	config.window_ms			    = ADMISSION_WINDOW_MS;
+	config.max_window_ms		    = ADMISSION_MAX_WINDOW_MS;
+	config.give_up_ms			    = ADMISSION_GIVE_UP_MS;
+	return config;
+}
+
+AdmissionScheduler WiFi::admission(admission_config());
+esp_timer_handle_t WiFi::admission_timer = nullptr;
+esp_event_handler_instance_t WiFi::instance_admission;
+esp_event_handler_instance_t WiFi::instance_provision;
+esp_event_handler_instance_t WiFi::instance_power;
+
+// The driver reports the AP's refusals (status 17, 30) and timeouts as these reasons
+static AdmissionScheduler::Failure admission_failure(uint8_t reason) {
+	switch (reason) {
+		case WIFI_REASON_BEACON_TIMEOUT:
+		case WIFI_REASON_NO_AP_FOUND:
+			return AdmissionScheduler::Failure::Absent;
+		case WIFI_REASON_AUTH_EXPIRE:
+		case WIFI_REASON_ASSOC_EXPIRE:
+		case WIFI_REASON_ASSOC_TOOMANY:
+		case WIFI_REASON_ASSOC_FAIL:
+		case WIFI_REASON_CONNECTION_FAIL:
+			return AdmissionScheduler::Failure::Overloaded;
+		default:
+			// Handshake timeouts included, a wrong password ends in those; so does AUTH_FAIL,
+			// which SAE reports for a wrong password and which carries no status code to tell
+			return AdmissionScheduler::Failure::Other;
+	}
+}
+
+void WiFi::admission_timeout(void *arg) {
+	esp_event_post(WIFI_MANAGER_ADMISSION_EVENT, 0, nullptr, 0, 0);
+}
+
+// A connect started elsewhere replaces the pending slot
+void WiFi::admission_cancel() {
+	if (admission_timer) esp_timer_stop(admission_timer);
+}
+
+// Supplicant task; the report is copied into the event loop's queue
+void WiFi::neighbor_report(void *ctx, const uint8_t *report, size_t report_len) {
+	NeighborReport copy;
+	// Empty when the request timed out
+	copy.len = report ? (report_len < sizeof(copy.elements) ? report_len : sizeof(copy.elements)) : 0;
+	if (copy.len) memcpy(copy.elements, report, copy.len);
+	esp_event_post(WIFI_MANAGER_ROAM_EVENT, ROAM_EVENT_NEIGHBOR_REPORT, &copy, sizeof(copy), 0);
+}
+
+void WiFi::roam_scan_next() {
+	wifi_scan_config_t scan_config	= {};
+	scan_config.ssid				= scan_ssid();
+	scan_config.channel				= roam_channels[roam_scan_index];
+	scan_config.scan_type			= WIFI_SCAN_TYPE_ACTIVE;
+	scan_config.scan_time.active.min = SCAN_DWELL_MIN_MS;
+	scan_config.scan_time.active.max = SCAN_DWELL_MAX_MS;
+
+	// One channel at a time keeps each off-channel absence short while associated
+	if (esp_wifi_scan_start(&scan_config, false) != ESP_OK) {
+		WIFI_LOG(RoamScanStartFailed, scan_config.channel);
+		roam_channel_count = 0;
+		roam_step(roam.on_scan_done(esp_timer_get_time()));
+	}
+}
+
+void WiFi::roam_scan_done() {
+	static wifi_ap_record_t records[RoamEngine::max_candidates];
+
+	uint16_t number = sizeof(records) / sizeof(records[0]);
+	if (esp_wifi_scan_get_ap_records(&number, records) == ESP_OK) {
+		for (uint16_t i = 0; i < number; i++) {
+			planner.observe(records[i].ssid, sizeof(records[i].ssid), records[i].primary, ScanPlanner::weight_scan);
+			RoamEngine::Candidate candidate;
+			memcpy(candidate.bssid, records[i].bssid, sizeof(candidate.bssid));
+			candidate.channel = records[i].primary;
+			candidate.rssi	   = records[i].rssi;
+			roam.on_scan_result(candidate);
+		}
+	}
+
+	if (++roam_scan_index < roam_channel_count) {
+		roam_scan_next();
+		return;
+	}
+	roam_channel_count = 0;
+	roam_step(roam.on_scan_done(esp_timer_get_time()));
+}
+
+void WiFi::roam_transition(const RoamEngine::Candidate &target) {
+	const uint8_t *b = target.bssid;
+	WIFI_LOG(RoamTarget, b[0], b[1], b[2], b[3], b[4], b[5], target.channel, target.rssi);
+#ifdef CONFIG_WPA_11KV_SUPPORT
+	// Ask the AP for a BSS Transition Management request; the supplicant then moves, over FT when enabled
+	if (esp_wnm_is_btm_supported_connection()) {
+		char candidate[48];
+		snprintf(candidate, sizeof(candidate), "neighbor=%02x:%02x:%02x:%02x:%02x:%02x,0,81,%d,7",
+			    b[0], b[1], b[2], b[3], b[4], b[5], target.channel);
+		if (esp_wnm_send_bss_transition_mgmt_query(REASON_RSSI, candidate, 1) == 0) return;
+	}
+#endif
+	// Plain reassociation pinned to the candidate, the disconnect handler reconnects
+	wifi_config.sta.bssid_set = true;
+	memcpy(wifi_config.sta.bssid, target.bssid, sizeof(wifi_config.sta.bssid));
+	wifi_config.sta.channel = target.channel;
+	esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+	esp_wifi_disconnect();
+}
+
+static void store_credentials(const char *ssid, size_t ssid_len, const char *password, uint8_t auth_mode) {
+	if (!CONFIG_STORE) return;
+	ConfigStore::update([=](StoredConfig &c) {
+		memset(c.ssid, 0, sizeof(c.ssid));
+		memset(c.password, 0, sizeof(c.password));
+		strncpy(c.ssid, ssid, ssid_len < sizeof(c.ssid) - 1 ? ssid_len : sizeof(c.ssid) - 1);
+		if (password) strncpy(c.password, password, sizeof(c.password) - 1);
+		c.auth_mode = auth_mode;
+	});
+}
+
+// Called from within link.update(), the event bits follow once the snapshot is published
+void WiFi::set_link_state(LinkSnapshot &snapshot, LinkState state) {
+	if (snapshot.state == state) return;
+	snapshot.state = state;
+	snapshot.generation++;
+	// Addresses are kept while associated: one family may arrive before the policy is met
+	if (!is_associated(state)) {
+		memset(&snapshot.ip_info, 0, sizeof(snapshot.ip_info));
+		memset(&snapshot.ip6_link_local, 0, sizeof(snapshot.ip6_link_local));
+		memset(&snapshot.ip6_global, 0, sizeof(snapshot.ip6_global));
+		memset(snapshot.bssid, 0, sizeof(snapshot.bssid));
+		snapshot.rssi	   = 0;
+		snapshot.channel = 0;
+	}
+}
+
+static bool ip6_assigned(const esp_ip6_addr_t &addr) {
+	return addr.addr[0] | addr.addr[1] | addr.addr[2] | addr.addr[3];
+}
+
+bool WiFi::ip_ready(const LinkSnapshot &snapshot) {
+	bool v4 = snapshot.ip_info.ip.addr != 0;
+	bool v6 = ip6_assigned(snapshot.ip6_global);
+	switch (ip_policy) {
+		case IpPolicy::Any:
+			return v4 || v6;
+		case IpPolicy::Both:
+			return v4 && v6;
+		default:
+			return v4;
+	}
+}
+
+// lwIP keeps IPv6 addresses over a reassociation and does not announce them again
+void WiFi::refresh_ip6() {
+	esp_ip6_addr_t link_local = {}, global = {};
+	if (esp_netif_get_ip6_linklocal(sta_netif, &link_local) != ESP_OK) memset(&link_local, 0, sizeof(link_local));
+	if (esp_netif_get_ip6_global(sta_netif, &global) != ESP_OK) memset(&global, 0, sizeof(global));
+	link.update([&](LinkSnapshot &l) {
+		if (!is_associated(l.state)) return;
+		l.ip6_link_local = link_local;
+		l.ip6_global	   = global;
+		if (ip_ready(l)) set_link_state(l, LinkState::Up);
+	});
+}
+
+static WiFiEvent make_event(WiFiEventType type) {
+	WiFiEvent event	 = {};
+	event.timestamp_us = esp_timer_get_time();
+	event.type	 = type;
+	return event;
+}
+
+static void publish_link_state(EventGroupHandle_t group, LinkState state) {
+	xEventGroupClearBits(group, LINK_STATE_BITS & ~link_state_bit(state));
+	xEventGroupSetBits(group, link_state_bit(state));
+}
+
 void WiFi::event_handler(void *arg, esp_event_base_t event_base,
 					int32_t event_id, void *event_data) {
+	// Event bases are the names of their declarations, e.g. "WIFI_EVENT"
+	WIFI_TRACE_SCOPE(event_base, event_id);
 	const int maximum_retry = 5;
 	if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+		link.update([](LinkSnapshot &l) { set_link_state(l, LinkState::Connecting); });
+		publish_link_state(s_wifi_event_group, LinkState::Connecting);
 		switch(mode) {
 			case WiFi::SetupMode::Normal:
-				ESP_ERROR_CHECK(esp_wifi_connect());
-				ESP_LOGI(TAG, "STA starting");
+				connect_to_ap();
+				WIFI_LOG(StaStarting);
+			break;
+			case WiFi::SetupMode::Portal:
+				// Idle until provision()
+				WIFI_LOG(PortalStarted);
 			break;
 #ifdef CONFIG_WPA_DPP_SUPPORT
 			case WiFi::SetupMode::DPP:
 				ESP_ERROR_CHECK(esp_supp_dpp_start_listen());
-				ESP_LOGI(TAG, "Started listening for DPP Authentication");
+				WIFI_LOG(DppListening);
 			break;
 #endif
 		}
 	} else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
 		wifi_event_sta_disconnected_t *event = (wifi_event_sta_disconnected_t *)event_data;
-		ESP_LOGI(TAG, "SSID: %s, length: %d, BSSID: %2hhx:%2hhx:%2hhx:%2hhx:%2hhx:%2hhx:, reason: %d",
-			event->ssid, event->ssid_len,
-			event->bssid[0], event->bssid[1], event->bssid[2], 
-			event->bssid[3], event->bssid[4], event->bssid[5], event->reason);
-		if (s_retry_num < maximum_retry) {
-			esp_wifi_connect();
-			s_retry_num++;
-			ESP_LOGI(TAG, "retry to connect to the AP");
-		} else {
-			xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+		WiFiEvent record = make_event(WiFiEventType::LinkDown);
+		record.reason	  = event->reason;
+		memcpy(record.bssid, event->bssid, sizeof(record.bssid));
+		WiFiEvents::publish(record);
+		if (CONFIG_STORE) ConfigStore::update([](StoredConfig &c) { c.disconnects++; });
+
+		// Waiting out an absent or overloaded AP does not use up the retries, the give-up time bounds it.
+		// Leaving on our own (new credentials) and roam transitions reconnect at once
+		AdmissionScheduler::Failure failure = admission_failure(event->reason);
+		bool deferred = ADMISSION && !parked && s_retry_num < maximum_retry && event->reason != WIFI_REASON_ASSOC_LEAVE && !roam.busy();
+		uint32_t admission_delay_ms = 0;
+		if (deferred) {
+			admission_delay_ms = admission.on_disconnected(esp_timer_get_time(), failure);
+			if (admission_delay_ms == AdmissionScheduler::give_up) s_retry_num = maximum_retry;
+		}
+
+		LinkState state = parked ? LinkState::Stopped : s_retry_num < maximum_retry ? LinkState::Connecting : LinkState::Failed;
+		link.update([state](LinkSnapshot &l) { set_link_state(l, state); });
+		publish_link_state(s_wifi_event_group, state);
+		if (ROAMING) {
+			roam_channel_count = 0;
+			roam.on_disconnected(esp_timer_get_time());
+		}
+		if (!parked && s_retry_num < maximum_retry) {
+			// Not moving to a roam target (anymore), any AP of the network will do
+			if (wifi_config.sta.bssid_set && !roam.busy()) wifi_config.sta.bssid_set = false;
+			if (deferred) {
+				if (failure == AdmissionScheduler::Failure::Other) s_retry_num++;
+				WIFI_LOG(ReconnectDeferred, admission_delay_ms, admission.window_ms());
+				esp_timer_stop(admission_timer);
+				esp_timer_start_once(admission_timer, static_cast<uint64_t>(admission_delay_ms) * 1000);
+			} else {
+				// The roam target keeps its channel, everything else is planned again
+				if (wifi_config.sta.bssid_set) start_connect();
+				else connect_to_ap();
+				s_retry_num++;
+			}
+		}
+	} else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE) {
+		if (scan_index < scan_plan.count) scan_done();
+		else if (roam_scan_index < roam_channel_count) roam_scan_done();
+	} else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_BSS_RSSI_LOW) {
+		wifi_event_bss_rssi_low_t *event = (wifi_event_bss_rssi_low_t *)event_data;
+		int8_t rssi				   = static_cast<int8_t>(event->rssi);
+		link.update([rssi](LinkSnapshot &l) { l.rssi = rssi; });
+		LinkSnapshot l = link.read();
+		roam_step(roam.on_rssi_low(esp_timer_get_time(), rssi, l.bssid, l.channel));
+	} else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+		wifi_event_sta_connected_t *event = (wifi_event_sta_connected_t *)event_data;
+		planner.observe(event->ssid, event->ssid_len, event->channel, ScanPlanner::weight_assoc);
+		record_handshake(event->bssid);
+		associated_listen_interval = wifi_config.sta.listen_interval;
+		associated_us			  = esp_timer_get_time();
+		if (ADMISSION) admission.on_connected(associated_us);
+
+		wifi_ap_record_t ap;
+		int8_t rssi = esp_wifi_sta_get_ap_info(&ap) == ESP_OK ? ap.rssi : 0;
+		link.update([event, rssi](LinkSnapshot &l) {
+			set_link_state(l, LinkState::Associated);
+			memcpy(l.bssid, event->bssid, sizeof(l.bssid));
+			l.channel = event->channel;
+			l.rssi    = rssi;
+		});
+		publish_link_state(s_wifi_event_group, LinkState::Associated);
+
+		// Another BSS of the same network without giving up in between
+		static uint8_t last_bssid[6];
+		static const uint8_t no_bssid[6] = {};
+		bool roamed = memcmp(last_bssid, no_bssid, 6) && memcmp(last_bssid, event->bssid, 6) && s_retry_num < maximum_retry;
+		memcpy(last_bssid, event->bssid, sizeof(last_bssid));
+
+		WiFiEvent record = make_event(roamed ? WiFiEventType::Roam : WiFiEventType::LinkUp);
+		record.rssi	  = rssi;
+		record.channel	  = event->channel;
+		memcpy(record.bssid, event->bssid, sizeof(record.bssid));
+		WiFiEvents::publish(record);
+
+		if (CONFIG_STORE) {
+			ConfigStore::update([event, roamed](StoredConfig &c) {
+				memcpy(c.bssid, event->bssid, sizeof(c.bssid));
+				c.channel = event->channel;
+				memcpy(c.planner, planner.entries(), sizeof(c.planner));
+				c.connects++;
+				if (roamed) c.roams++;
+			});
+		}
+
+		if (ROAMING) {
+			roam.on_associated(esp_timer_get_time(), event->bssid, event->channel);
+			roam_schedule();
+		}
+
+		if (IPV6) {
+			// Starts SLAAC; IP_EVENT_GOT_IP6 follows for every address once DAD passed
+			esp_netif_create_ip6_linklocal(sta_netif);
+			refresh_ip6();
+			LinkSnapshot l = link.read();
+			if (l.state == LinkState::Up) publish_link_state(s_wifi_event_group, LinkState::Up);
+			if (ip6_assigned(l.ip6_global)) {
+				WiFiEvent record = make_event(WiFiEventType::Ip6Acquired);
+				record.reason	  = esp_netif_ip6_get_addr_type(&l.ip6_global);
+				WiFiEvents::publish(record);
+			}
 		}
-		ESP_LOGI(TAG, "connect to the AP fail");
 	} else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
 		ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-		ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
-		s_retry_num = 0;
-		memcpy(&ip, &event->ip_info.ip, sizeof(esp_ip4_addr_t));
-		connected = true;
-		xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+		s_retry_num		    = 0;
+		link.update([event](LinkSnapshot &l) {
+			if (!is_associated(l.state)) return;
+			l.ip_info = event->ip_info;
+			if (ip_ready(l)) set_link_state(l, LinkState::Up);
+		});
+		if (link.read().state == LinkState::Up) publish_link_state(s_wifi_event_group, LinkState::Up);
+
+		WiFiEvent record = make_event(WiFiEventType::IpAcquired);
+		record.ip		  = event->ip_info.ip;
+		WiFiEvents::publish(record);
+
+		if (CONFIG_STORE) {
+			ConfigStore::update([event](StoredConfig &c) {
+				c.lease_ip	    = event->ip_info.ip.addr;
+				c.lease_netmask = event->ip_info.netmask.addr;
+				c.lease_gw	    = event->ip_info.gw.addr;
+			});
+		}
+	} else if (event_base == IP_EVENT && event_id == IP_EVENT_GOT_IP6) {
+		ip_event_got_ip6_t *event = (ip_event_got_ip6_t *)event_data;
+		if (event->esp_netif != sta_netif) return;
+		esp_ip6_addr_type_t type = esp_netif_ip6_get_addr_type(&event->ip6_info.ip);
+		s_retry_num		     = 0;
+		link.update([event, type](LinkSnapshot &l) {
+			if (!is_associated(l.state)) return;
+			if (type == ESP_IP6_ADDR_IS_LINK_LOCAL) l.ip6_link_local = event->ip6_info.ip;
+			else if (!ip6_assigned(l.ip6_global)) l.ip6_global = event->ip6_info.ip;
+			if (ip_ready(l)) set_link_state(l, LinkState::Up);
+		});
+		if (link.read().state == LinkState::Up) publish_link_state(s_wifi_event_group, LinkState::Up);
+
+		WiFiEvent record = make_event(WiFiEventType::Ip6Acquired);
+		record.reason	  = type;
+		WiFiEvents::publish(record);
+	} else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_LOST_IP) {
+		link.update([](LinkSnapshot &l) {
+			memset(&l.ip_info, 0, sizeof(l.ip_info));
+			if (l.state == LinkState::Up && !ip_ready(l)) set_link_state(l, LinkState::Associated);
+		});
+		if (link.read().state == LinkState::Associated) publish_link_state(s_wifi_event_group, LinkState::Associated);
+		WiFiEvents::publish(make_event(WiFiEventType::IpLost));
+	} else if (event_base == WIFI_MANAGER_ROAM_EVENT && event_id == ROAM_EVENT_NEIGHBOR_REPORT) {
+		NeighborReport *report = (NeighborReport *)event_data;
+		roam_step(roam.on_neighbor_report(report->elements, report->len));
+	} else if (event_base == WIFI_MANAGER_ROAM_EVENT && event_id == ROAM_EVENT_FORCE) {
+		LinkSnapshot l = link.read();
+		if (is_associated(l.state)) roam_step(roam.on_rssi_low(esp_timer_get_time(), l.rssi, l.bssid, l.channel, true));
+	} else if (event_base == WIFI_MANAGER_ROAM_EVENT && event_id == ROAM_EVENT_TIMEOUT) {
+		if (roam.busy()) roam_step(roam.on_timeout(esp_timer_get_time()));
+		else roam_schedule();
+	} else if (event_base == WIFI_MANAGER_ADMISSION_EVENT) {
+		if (!parked && s_retry_num < maximum_retry) connect_to_ap();
+	} else if (event_base == WIFI_MANAGER_POWER_EVENT) {
+		load_listen_interval();
+	} else if (event_base == WIFI_MANAGER_PROVISION_EVENT) {
+		ProvisionRequest *request = (ProvisionRequest *)event_data;
+		esp_err_t err			 = apply_provision(request->ssid, request->password);
+		memset(request, 0, sizeof(*request));
+		if (err) {
+			ESP_LOGE(TAG, "WiFi provision error %d", err);
+			link.update([](LinkSnapshot &l) { set_link_state(l, LinkState::Failed); });
+			publish_link_state(s_wifi_event_group, LinkState::Failed);
+		}
 	}
 };
 
@@ -94,37 +986,44 @@ void WiFi::event_handler(void *arg, esp_event_base_t event_base,
 WiFi::pairing_text_callback_t WiFi::callback = nullptr;
 
 void WiFi::dpp_enrollee_event_cb(esp_supp_dpp_event_t event, void *data) {
+	WIFI_TRACE_SCOPE("dpp_event", event);
 	switch (event) {
 		case ESP_SUPP_DPP_URI_READY:
 			if (data != NULL) {
-				// esp_qrcode_config_t cfg = ESP_QRCODE_CONFIG_DEFAULT();
-
-				ESP_LOGI(TAG, "Scan below QR Code to configure the enrollee:\n");
-				//esp_qrcode_generate(&cfg, (const char *)data);
+				WiFiEvents::publish_dpp(make_event(WiFiEventType::DppUriReady));
 
-				ESP_LOG_BUFFER_HEXDUMP(TAG, data, 32, esp_log_level_t::ESP_LOG_ERROR);
+				// The URI only lives for this call, so it is handed over here rather than through the event stream
 				const char * qr_text = static_cast<const char *>(data);
-				ESP_LOGI(TAG, "%s", qr_text);
+				// The pairing text is the user's output, not diagnostics
 				if (callback) callback(qr_text);
+				else ESP_LOGI(TAG, "Scan below QR Code to configure the enrollee:\n%s", qr_text);
 			}
 			break;
 		case ESP_SUPP_DPP_CFG_RECVD:
 			memcpy(&wifi_config, data, sizeof(wifi_config));
+			load_listen_interval();
+			set_roaming_capabilities(wifi_config.sta);
 			esp_wifi_set_config(static_cast<wifi_interface_t>(ESP_IF_WIFI_STA), &wifi_config);
-			ESP_LOGI(TAG, "DPP Authentication successful, connecting to AP : %s",
-				    wifi_config.sta.ssid);
+			// New credentials, no cached PMKSA applies
+			session_bssid_count = 0;
+			store_credentials((const char *)wifi_config.sta.ssid, sizeof(wifi_config.sta.ssid),
+						   (const char *)wifi_config.sta.password, static_cast<uint8_t>(AuthMode::Psk));
+			WiFiEvents::publish_dpp(make_event(WiFiEventType::DppConfigReceived));
 			s_retry_num = 0;
-			esp_wifi_connect();
+			connect_to_ap();
 			break;
-		case ESP_SUPP_DPP_FAIL:
+		case ESP_SUPP_DPP_FAIL: {
+			WiFiEvent record = make_event(WiFiEventType::DppFailed);
+			record.reason	  = static_cast<uint16_t>(reinterpret_cast<intptr_t>(data));
+			WiFiEvents::publish_dpp(record);
 			if (s_retry_num < 5) {
-				ESP_LOGI(TAG, "DPP Auth failed (Reason: %s), retry...", esp_err_to_name((int)data));
 				ESP_ERROR_CHECK(esp_supp_dpp_start_listen());
 				s_retry_num++;
 			} else {
 				xEventGroupSetBits(s_wifi_event_group, WIFI_AUTH_FAIL_BIT);
 			}
 			break;
+		}
 		default:
 			break;
 	}
@@ -143,19 +1042,67 @@ esp_err_t WiFi::wait_connection(pairing_text_callback_t callback) {
 #endif
 
 
+#ifdef CONFIG_WPA_DPP_SUPPORT
+// A P-256 private key as the hex string esp_supp_dpp_bootstrap_gen() takes: a random scalar in [1, n)
+static void generate_dpp_key(char out[65]) {
+	static const uint8_t order[32] = {0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff,
+							    0xff, 0xff, 0xff, 0xff, 0xff, 0xbc, 0xe6, 0xfa, 0xad, 0xa7, 0x17,
+							    0x9e, 0x84, 0xf3, 0xb9, 0xca, 0xc2, 0xfc, 0x63, 0x25, 0x51};
+	static const uint8_t zero[32] = {};
+	uint8_t d[32];
+	// The hardware RNG is a true RNG while the radio is on
+	do esp_fill_random(d, sizeof(d));
+	while (memcmp(d, order, sizeof(d)) >= 0 || memcmp(d, zero, sizeof(d)) == 0);
+	for (int i = 0; i < 32; i++) sprintf(out + 2 * i, "%02x", d[i]);
+	memset(d, 0, sizeof(d));
+}
+#endif
+
 esp_err_t WiFi::initialize(SetupMode mode, const char *ssid, const char *password) {
+	WIFI_TRACE_SCOPE("initialize", static_cast<int32_t>(mode));
 	initialized = false;
 	WiFi::mode = mode;
+	parked	    = false;
+	driver_released	    = false;
+	session_bssid_count = 0;
 
 	s_wifi_event_group = xEventGroupCreate();
+	WiFiEvents::start(WiFiEvents::default_config());
+	xEventGroupSetBits(s_wifi_event_group, LINK_STOPPED_BIT);
 
-	ESP_ERROR_CHECK(esp_netif_init());
+	if (CONFIG_STORE && !ConfigStore::loaded()) {
+		// Also needed by the driver itself with CONFIG_ESP32_WIFI_NVS_ENABLED; a second call is harmless
+		esp_err_t err = nvs_flash_init();
+		if (err) ESP_LOGW(TAG, "NVS init error %d", err);
+		ConfigStore::load(CONFIG_STORE_NAMESPACE);
+		StoredConfig stored = ConfigStore::get();
+		planner.restore(stored.planner, ScanPlanner::history_size);
+		ConfigStore::update([](StoredConfig &c) { c.boots++; });
+	}
+
+	{
+		MemProfile::Scope phase(MemProfile::Phase::Netif);
+		WIFI_TRACE_SCOPE("netif");
+		ESP_ERROR_CHECK(esp_netif_init());
 
-	ESP_ERROR_CHECK(esp_event_loop_create_default());
-	esp_netif_create_default_wifi_sta();
+		ESP_ERROR_CHECK(esp_event_loop_create_default());
+		sta_netif = esp_netif_create_default_wifi_sta();
+		if (mode == SetupMode::Portal) esp_netif_create_default_wifi_ap();
+	}
 
-	wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-	ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+	{
+		MemProfile::Scope phase(MemProfile::Phase::WifiInit);
+		WIFI_TRACE_SCOPE("wifi_init");
+		wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+		ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+	}
+	// A capture started before initialize() begins here, ahead of the scan
+	WiFiCapture::attach();
+	if (ADMISSION) {
+		uint8_t mac[6];
+		ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, mac));
+		admission.set_mac(mac);
+	}
 
 	ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
 											  ESP_EVENT_ANY_ID,
@@ -163,19 +1110,73 @@ esp_err_t WiFi::initialize(SetupMode mode, const char *ssid, const char *passwor
 											  NULL,
 											  &instance_any_id));
 	ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
-											  IP_EVENT_STA_GOT_IP,
+											  ESP_EVENT_ANY_ID,
+											  &event_handler,
+											  NULL,
+											  &instance_ip));
+	if (ROAMING) {
+		ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_MANAGER_ROAM_EVENT,
+												  ESP_EVENT_ANY_ID,
+												  &event_handler,
+												  NULL,
+												  &instance_roam));
+		esp_timer_create_args_t timer_args = {};
+		timer_args.callback			   = roam_timeout;
+		timer_args.name			   = "wifi_roam";
+		ESP_ERROR_CHECK(esp_timer_create(&timer_args, &roam_timer));
+	}
+	if (ADMISSION) {
+		ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_MANAGER_ADMISSION_EVENT,
+												  ESP_EVENT_ANY_ID,
+												  &event_handler,
+												  NULL,
+												  &instance_admission));
+		esp_timer_create_args_t timer_args = {};
+		timer_args.callback			   = admission_timeout;
+		timer_args.name			   = "wifi_admission";
+		ESP_ERROR_CHECK(esp_timer_create(&timer_args, &admission_timer));
+	}
+
+	ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_MANAGER_PROVISION_EVENT,
+											  ESP_EVENT_ANY_ID,
+											  &event_handler,
+											  NULL,
+											  &instance_provision));
+	ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_MANAGER_POWER_EVENT,
+											  ESP_EVENT_ANY_ID,
 											  &event_handler,
 											  NULL,
-											  &instance_got_ip));
+											  &instance_power));
 
 	initialized = true;
-	
+
+	static wifi_config_t ap_config;
 	switch(mode) {
 		case SetupMode::Normal:
 			memset(&wifi_config, 0, sizeof(wifi_config_t));
 			wifi_config.sta.threshold.authmode = ESP_WIFI_SCAN_AUTH_MODE_THRESHOLD;
 			strncpy((char *)&wifi_config.sta.ssid, ssid, 31);
-			strncpy((char *)&wifi_config.sta.password, password, 63);
+			if (auth_config.mode != AuthMode::Enterprise) strncpy((char *)&wifi_config.sta.password, password, 63);
+			set_roaming_capabilities(wifi_config.sta);
+			ESP_ERROR_CHECK(apply_auth_config(password));
+			store_credentials(ssid, strlen(ssid), auth_config.mode == AuthMode::Enterprise ? nullptr : password,
+						   static_cast<uint8_t>(auth_config.mode));
+			break;
+		case SetupMode::Portal:
+			memset(&wifi_config, 0, sizeof(wifi_config_t));
+			wifi_config.sta.threshold.authmode = ESP_WIFI_SCAN_AUTH_MODE_THRESHOLD;
+			set_roaming_capabilities(wifi_config.sta);
+
+			memset(&ap_config, 0, sizeof(ap_config));
+			strncpy((char *)ap_config.ap.ssid, ssid, sizeof(ap_config.ap.ssid));
+			ap_config.ap.ssid_len	     = static_cast<uint8_t>(strnlen(ssid, sizeof(ap_config.ap.ssid)));
+			ap_config.ap.channel	     = PORTAL_CHANNEL;
+			ap_config.ap.max_connection = 2;
+			ap_config.ap.authmode	     = WIFI_AUTH_OPEN;
+			if (password && strlen(password) >= 8) {
+				strncpy((char *)ap_config.ap.password, password, sizeof(ap_config.ap.password) - 1);
+				ap_config.ap.authmode = WIFI_AUTH_WPA2_PSK;
+			}
 			break;
 #ifdef CONFIG_WPA_DPP_SUPPORT
 
@@ -196,12 +1197,30 @@ esp_err_t WiFi::initialize(SetupMode mode, const char *ssid, const char *passwor
 #else
 #define EXAMPLE_DPP_DEVICE_INFO 0
 #endif
-		case SetupMode::DPP:
-			ESP_ERROR_CHECK(esp_supp_dpp_init(dpp_enrollee_event_cb));
+		case SetupMode::DPP: {
+			// A stored key keeps the QR code the same across restarts; the first boot stores a new one
+			static StoredConfig stored;
+			const char *key = EXAMPLE_DPP_BOOTSTRAPPING_KEY;
+			if (!key && CONFIG_STORE) {
+				stored = ConfigStore::get();
+				if (!stored.dpp_key[0]) {
+					generate_dpp_key(stored.dpp_key);
+					ConfigStore::update([](StoredConfig &c) { memcpy(c.dpp_key, stored.dpp_key, sizeof(c.dpp_key)); });
+				}
+				key = stored.dpp_key;
+			}
+			{
+				MemProfile::Scope phase(MemProfile::Phase::DppInit);
+				WIFI_TRACE_SCOPE("dpp_init");
+				ESP_ERROR_CHECK(esp_supp_dpp_init(dpp_enrollee_event_cb));
+			}
 			/* Currently only supported method is QR Code */
+			MemProfile::Scope phase(MemProfile::Phase::DppBootstrap);
+			WIFI_TRACE_SCOPE("dpp_bootstrap");
 			ESP_ERROR_CHECK(esp_supp_dpp_bootstrap_gen(EXAMPLE_DPP_LISTEN_CHANNEL_LIST, DPP_BOOTSTRAP_QR_CODE,
-									   EXAMPLE_DPP_BOOTSTRAPPING_KEY, EXAMPLE_DPP_DEVICE_INFO));
+									   key, EXAMPLE_DPP_DEVICE_INFO));
 			break;
+		}
 #endif
 		default:
 			ESP_LOGE(TAG, "Not implements mode: %d", static_cast<int>(mode));
@@ -209,38 +1228,57 @@ esp_err_t WiFi::initialize(SetupMode mode, const char *ssid, const char *passwor
 	}
 
 
-	ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-	if (mode == SetupMode::Normal) ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-	ESP_ERROR_CHECK(esp_wifi_start());
+	{
+		MemProfile::Scope phase(MemProfile::Phase::WifiStart);
+		WIFI_TRACE_SCOPE("wifi_start");
+		ESP_ERROR_CHECK(esp_wifi_set_mode(mode == SetupMode::Portal ? WIFI_MODE_APSTA : WIFI_MODE_STA));
+		// Modem sleep would make the SoftAP miss its clients
+		if (mode == SetupMode::Portal) ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_NONE));
+		else {
+			load_listen_interval();
+			ESP_ERROR_CHECK(apply_power_profile());
+		}
+		ESP_ERROR_CHECK(apply_radio_settings(false));
+		if (mode == SetupMode::Normal || mode == SetupMode::Portal) ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+		if (mode == SetupMode::Portal) ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &ap_config));
+		ESP_ERROR_CHECK(esp_wifi_start());
+		if (radio_profile != RadioProfile::Default) ESP_ERROR_CHECK(esp_wifi_set_max_tx_power(radio_settings.max_tx_power));
+		if (mode == SetupMode::Portal) ESP_ERROR_CHECK(Portal::start());
+	}
 
-	ESP_LOGI(TAG, "wifi_init_sta finished.");
+	WIFI_LOG(InitDone);
 
 	/* Waiting until either the connection is established (WIFI_CONNECTED_BIT) or connection failed for the maximum
 	 * number of re-tries (WIFI_FAIL_BIT). The bits are set by event_handler() (see above) */
-	EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
-								    WIFI_CONNECTED_BIT | WIFI_FAIL_BIT | WIFI_AUTH_FAIL_BIT,
-								    pdFALSE,
-								    pdFALSE,
-								    portMAX_DELAY);
+	// A failed portal submission is retried from the page, only success ends the wait
+	EventBits_t bits;
+	{
+		MemProfile::Scope phase(MemProfile::Phase::Connect);
+		WIFI_TRACE_SCOPE("connect");
+		bits = xEventGroupWaitBits(s_wifi_event_group,
+							  mode == SetupMode::Portal ? WIFI_CONNECTED_BIT : WIFI_CONNECTED_BIT | WIFI_FAIL_BIT | WIFI_AUTH_FAIL_BIT,
+							  pdFALSE,
+							  pdFALSE,
+							  portMAX_DELAY);
+	}
 
 	/* xEventGroupWaitBits() returns the bits before the call returned, hence we can test which event actually
 	 * happened. */
+	uint32_t ssid_hash = ScanPlanner::hash(wifi_config.sta.ssid, strnlen((const char *)wifi_config.sta.ssid, sizeof(wifi_config.sta.ssid)));
 	if (bits & WIFI_CONNECTED_BIT) {
-		ESP_LOGI(TAG, "connected to ap SSID:%s password:%s",
-			    wifi_config.sta.ssid, wifi_config.sta.password);
+		WIFI_LOG(Connected, ssid_hash, link.read().channel);
 		return 0;
 	}
 	if (bits & WIFI_FAIL_BIT) {
-		ESP_LOGI(TAG, "Failed to connect to SSID:%s, password:%s",
-			    wifi_config.sta.ssid, wifi_config.sta.password);
+		WIFI_LOG(ConnectFailed, ssid_hash, s_retry_num);
 		return 1;
 	}
 	if (bits & WIFI_AUTH_FAIL_BIT) {
-		ESP_LOGI(TAG, "DPP Authentication failed after %d retries", s_retry_num);
+		WIFI_LOG(DppAuthFailed, s_retry_num);
 		return 2;
 	}
 
-	ESP_LOGE(TAG, "UNEXPECTED EVENT");
+	WIFI_LOG(UnexpectedBits, bits);
 	return 3;
 };
 
@@ -253,14 +1291,103 @@ esp_err_t WiFi::Connect(const char *ssid, const char *password) {
 	return initialize(SetupMode::Normal, ssid, password);
 }
 
-bool WiFi::Disconnect(bool release) {
+esp_err_t WiFi::ConnectStored() {
+	if (initialized) {
+		ESP_LOGE(TAG, "WiFi is Initialized");
+		return 12;
+	}
+	if (!CONFIG_STORE) return ESP_ERR_NOT_SUPPORTED;
+
+	if (!ConfigStore::loaded()) {
+		nvs_flash_init();
+		ConfigStore::load(CONFIG_STORE_NAMESPACE);
+	}
+	static StoredConfig stored;
+	stored = ConfigStore::get();
+	if (!stored.ssid[0]) return ESP_ERR_NOT_FOUND;
+
+	// Enterprise certificates are not stored, set_auth_config() must have provided them
+	AuthMode mode = static_cast<AuthMode>(stored.auth_mode);
+	if (mode != AuthMode::Enterprise) auth_config.mode = mode;
+	return initialize(SetupMode::Normal, stored.ssid, stored.password);
+}
+
+esp_err_t WiFi::wait_portal(const char *ap_ssid, const char *ap_password) {
+	if (initialized) {
+		ESP_LOGE(TAG, "WiFi is Initialized");
+		return 12;
+	}
+	if (!PORTAL) return ESP_ERR_NOT_SUPPORTED;
+
+	esp_err_t err = initialize(SetupMode::Portal, ap_ssid, ap_password);
+	if (err) return err;
+
+	// Time for the page to show the result before the AP goes away
+	vTaskDelay(pdMS_TO_TICKS(PORTAL_LINGER_MS));
+	Portal::stop();
+	WiFi::mode = SetupMode::Normal;
+	return esp_wifi_set_mode(WIFI_MODE_STA);
+}
+
+esp_err_t WiFi::provision(const char *ssid, const char *password) {
+	if (!initialized) return ESP_ERR_INVALID_STATE;
+	size_t ssid_len = strlen(ssid);
+	if (ssid_len == 0 || ssid_len > sizeof(wifi_config.sta.ssid) || strlen(password) >= sizeof(wifi_config.sta.password)) {
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	ProvisionRequest request = {};
+	memcpy(request.ssid, ssid, ssid_len);
+	strncpy(request.password, password, sizeof(request.password) - 1);
+	esp_err_t err = esp_event_post(WIFI_MANAGER_PROVISION_EVENT, 0, &request, sizeof(request), pdMS_TO_TICKS(100));
+	memset(&request, 0, sizeof(request));
+	return err;
+}
+
+esp_err_t WiFi::apply_provision(const char *ssid, const char *password) {
+	size_t ssid_len = strlen(ssid);
+	memset(wifi_config.sta.ssid, 0, sizeof(wifi_config.sta.ssid));
+	memset(wifi_config.sta.password, 0, sizeof(wifi_config.sta.password));
+	memcpy(wifi_config.sta.ssid, ssid, ssid_len);
+	strncpy((char *)wifi_config.sta.password, password, sizeof(wifi_config.sta.password) - 1);
+	wifi_config.sta.bssid_set = false;
+	wifi_config.sta.channel   = 0;
+	esp_err_t err		   = apply_auth_config(password);
+	if (!err) err = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+	if (err) return err;
+
+	// New credentials, no cached PMKSA applies
+	session_bssid_count = 0;
+	store_credentials(ssid, ssid_len, password, static_cast<uint8_t>(auth_config.mode));
+	WIFI_LOG(PortalProvisioned, ScanPlanner::hash(wifi_config.sta.ssid, ssid_len));
+
+	s_retry_num = 0;
+	parked	    = false;
+	admission_cancel();
+	bool associated = is_associated(link.read().state);
+	link.update([](LinkSnapshot &l) { set_link_state(l, LinkState::Connecting); });
+	publish_link_state(s_wifi_event_group, LinkState::Connecting);
+	// Reconnects with the new configuration through the disconnect handler; an idle
+	// station, e.g. Failed after a wrong password, sees no disconnect and starts here
+	if (associated) return esp_wifi_disconnect();
+	return connect_to_ap();
+}
+
+bool WiFi::Disconnect(bool) {
+	return Disconnect(DisconnectMode::Release);
+}
+
+bool WiFi::Disconnect(DisconnectMode mode) {
 	esp_err_t err;
 
-	err = esp_wifi_disconnect();
+	parked = true;
+	admission_cancel();
+	err	  = esp_wifi_disconnect();
 	if (err) {
 		ESP_LOGE(TAG, "WiFi disconnect error %d", err);
 		return false;
 	}
+	if (mode == DisconnectMode::KeepDriver) return true;
 
 	err = esp_wifi_stop();
 	if (err) {
@@ -274,15 +1401,76 @@ bool WiFi::Disconnect(bool release) {
 		return false;
 	}
 
+	// The supplicant and its PMKSA cache are gone with the driver
+	session_bssid_count = 0;
+	driver_released	    = true;
 	return true;
 }
 
+esp_err_t WiFi::Reconnect() {
+	if (!initialized || !parked || driver_released) return ESP_ERR_INVALID_STATE;
+
+	s_retry_num	 = 0;
+	admission_cancel();
+	esp_err_t err = connect_to_ap();
+	if (err) {
+		ESP_LOGE(TAG, "WiFi reconnect error %d", err);
+		return err;
+	}
+	parked = false;
+	link.update([](LinkSnapshot &l) { set_link_state(l, LinkState::Connecting); });
+	publish_link_state(s_wifi_event_group, LinkState::Connecting);
+	return ESP_OK;
+}
+
 esp_ip4_addr_t *WiFi::getIp() {
-	if (!connected) return nullptr;
+	static thread_local esp_ip4_addr_t ip;
+	LinkSnapshot l = link.read();
+	if (l.state != LinkState::Up || !l.ip_info.ip.addr) return nullptr;
+	ip = l.ip_info.ip;
 	return &ip;
 }
 
 const char *WiFi::get_address() {
-	if (!connected) return nullptr;
-	return inet_ntoa(ip);
+	static thread_local char address[16];
+	LinkSnapshot l = link.read();
+	if (l.state != LinkState::Up || !l.ip_info.ip.addr) return nullptr;
+	return esp_ip4addr_ntoa(&l.ip_info.ip, address, sizeof(address));
+}
+
+const char *WiFi::get_address6() {
+	static thread_local char address[40];
+	LinkSnapshot l = link.read();
+	if (l.state != LinkState::Up) return nullptr;
+	const esp_ip6_addr_t &ip = ip6_assigned(l.ip6_global) ? l.ip6_global : l.ip6_link_local;
+	if (!ip6_assigned(ip)) return nullptr;
+	snprintf(address, sizeof(address), IPV6STR, IPV62STR(ip));
+	return address;
+}
+
+LinkSnapshot WiFi::get_link() {
+	return link.read();
+}
+
+bool WiFi::wait_for(LinkState state, TickType_t timeout) {
+	if (!s_wifi_event_group) return false;
+	EventBits_t bit = link_state_bit(state);
+	return xEventGroupWaitBits(s_wifi_event_group, bit, pdFALSE, pdTRUE, timeout) & bit;
+}
+
+ScanPlanner::Counters WiFi::get_scan_counters() {
+	return planner.counters();
+}
+
+RoamEngine::Stats WiFi::get_roam_stats() {
+	return roam.stats();
+}
+
+esp_err_t WiFi::roam_now() {
+	if (!ROAMING) return ESP_ERR_NOT_SUPPORTED;
+	return esp_event_post(WIFI_MANAGER_ROAM_EVENT, ROAM_EVENT_FORCE, nullptr, 0, 0);
+}
+
+AdmissionScheduler::Stats WiFi::get_admission_stats() {
+	return admission.stats();
 }
@@ -6,17 +6,102 @@
 
 #include <esp_wifi.h>
 #include <esp_event.h>
+#include <esp_timer.h>
 #include <lwip/err.h>
 #include <lwip/sys.h>
 
 #ifdef CONFIG_WPA_DPP_SUPPORT
 #include <esp_dpp.h>
 #endif
+#include <esp_wpa2.h>
+
+#include "admissionScheduler.hpp"
+#include "linkState.hpp"
+#include "roamEngine.hpp"
+#include "scanPlanner.hpp"
+#include "wifiEvents.hpp"
 
 class WiFi {
+    public:
+	enum class PowerProfile {
+		MaxThroughput,  // Radio always on
+		Balanced,	     // Modem sleep, wake on every DTIM
+		MinPower,	     // Modem sleep, wake on listen interval
+	};
+
+	enum class RadioProfile {
+		Default,	    // Driver defaults, nothing is applied
+		BulkUpload,
+		LowMemory,
+		LowLatency,
+		Custom,	    // Set through set_radio_settings()
+	};
+
+	struct RadioSettings {
+		wifi_bandwidth_t bandwidth;
+		uint8_t protocol;	    // WIFI_PROTOCOL_* bitmap
+		int8_t max_tx_power;  // Unit of 0.25dBm, see esp_wifi_set_max_tx_power()
+	};
+
+	enum class DisconnectMode {
+		Release,	   // Stop and deinitialize the driver
+		KeepDriver,  // Leave the AP only; the driver and its PMKSA cache stay for Reconnect()
+	};
+
+	enum class AuthMode {
+		Psk,		   // WPA/WPA2/WPA3 personal, lowest mode from CONFIG_ESP_WIFI_AUTH_*
+		Sae,		   // WPA3-SAE only, PMF required
+		Enterprise,  // WPA2/WPA3-Enterprise
+	};
+
+	enum class EapMethod {
+		Peap,  // MSCHAPv2 inside TLS, username and password
+		Tls,   // Client certificate
+	};
+
+	// Strings are copied; certificates are referenced and must outlive the connection
+	struct AuthConfig {
+		AuthMode mode;
+		EapMethod eap_method;
+		const char* identity;  // Outer EAP identity
+		const char* username;
+		const char* password;  // nullptr to use the one given to Connect()
+		const uint8_t* ca_cert;  // PEM including the terminating NUL; nullptr skips server validation
+		size_t ca_cert_len;
+		const uint8_t* client_cert;
+		size_t client_cert_len;
+		const uint8_t* client_key;
+		size_t client_key_len;
+	};
+
+	// From esp_wifi_connect() to WIFI_EVENT_STA_CONNECTED, the driver's scan of the channel included
+	struct HandshakeStats {
+		uint32_t count;
+		uint32_t last_us;
+		uint32_t max_us;
+		uint64_t total_us;
+	};
+
+	// The driver does not report whether the supplicant used a cached PMKSA, so the split is by BSS:
+	// a rejoin is an association with a BSS already joined since the driver started, which the
+	// supplicant may serve from its cache. PSK derives the PMK from the passphrase and has no such
+	// cache, its handshakes all count as initial.
+	struct AuthStats {
+		HandshakeStats initial;
+		HandshakeStats rejoined;  // SAE and Enterprise only
+	};
+
+	// Addresses that make the link Up; link-local IPv6 never counts
+	enum class IpPolicy {
+		Ipv4,  // A DHCPv4 lease
+		Any,	   // The first of a DHCPv4 lease and a routable IPv6 address
+		Both,  // Both of them
+	};
+
     private:
 	enum class SetupMode {
 		Normal,
+		Portal,
 #ifdef CONFIG_WPA_DPP_SUPPORT
 		DPP,
 #endif
@@ -24,8 +109,7 @@ class WiFi {
 
 	WiFi();
 	static bool initialized;
-	static esp_ip4_addr_t ip;
-	static bool connected;
+	static Seqlock<LinkSnapshot> link;
 
 	static SetupMode mode;
 	static int s_retry_num;
@@ -34,18 +118,144 @@ class WiFi {
 
 	static EventGroupHandle_t s_wifi_event_group;
 	static esp_event_handler_instance_t instance_any_id;
-	static esp_event_handler_instance_t instance_got_ip;
+	static esp_event_handler_instance_t instance_ip;
+	static esp_netif_t* sta_netif;
+	static IpPolicy ip_policy;
 
 	static void event_handler(void* arg, esp_event_base_t event_base,
 						 int32_t event_id, void* event_data);
 
+	static void set_link_state(LinkSnapshot& snapshot, LinkState state);
+	static bool ip_ready(const LinkSnapshot& snapshot);
+	static void refresh_ip6();
+
+	static ScanPlanner planner;
+	static ScanPlanner::Plan scan_plan;
+	static uint8_t scan_index;
+	static int64_t scan_started_us;
+
+	// Targeted scan of the planned channels, then esp_wifi_connect()
+	static esp_err_t connect_to_ap();
+	static uint8_t* scan_ssid();
+	static void scan_next_channel();
+	static void scan_done();
+	static void finish_targeted_scan(uint8_t hit_channel);
+
+	struct PowerSettings {
+		wifi_ps_type_t ps;
+		uint16_t listen_interval;	 // Beacon intervals, negotiated at association
+		uint16_t beacon_timeout_s;
+		uint16_t latency_target_ms;	 // Worst case downlink latency the profile is meant for
+	};
+	static const PowerSettings power_settings[];
+	static PowerProfile power_profile;
+	static uint16_t associated_listen_interval;
+	static int64_t associated_us;
+
+	static esp_event_handler_instance_t instance_power;
+
+	static void load_listen_interval();
+	static esp_err_t apply_power_profile();
+
+	static const RadioSettings radio_presets[];
+	static RadioProfile radio_profile;
+	static RadioSettings radio_settings;
+
+	static esp_err_t apply_radio_settings(bool started);
+
+	static RoamEngine roam;
+	static esp_timer_handle_t roam_timer;
+	static esp_event_handler_instance_t instance_roam;
+	static uint8_t roam_channels[RoamEngine::max_channels];
+	static uint8_t roam_channel_count;
+	static uint8_t roam_scan_index;
+
+	static void roam_step(const RoamEngine::Step& step);
+	static void roam_schedule();
+	static void roam_scan_next();
+	static void roam_scan_done();
+	static void roam_transition(const RoamEngine::Candidate& target);
+	static void roam_timeout(void* arg);
+	static void neighbor_report(void* ctx, const uint8_t* report, size_t report_len);
+
+	static AdmissionScheduler admission;
+	static esp_timer_handle_t admission_timer;
+	static esp_event_handler_instance_t instance_admission;
+
+	static void admission_timeout(void* arg);
+	static esp_event_handler_instance_t instance_provision;
+	static esp_err_t apply_provision(const char* ssid, const char* password);
+	static void admission_cancel();
+
+	static AuthConfig auth_config;
+	static AuthStats auth_stats[3];
+	static int64_t connect_started_us;
+	static uint8_t session_bssids[8][6];
+	static uint8_t session_bssid_count;
+	static bool parked;
+	static bool driver_released;  // By Disconnect(), until the next initialize()
+	static bool eap_enabled;
+
+	static esp_err_t apply_auth_config(const char* password);
+	static esp_err_t apply_eap_config(const char* password);
+	static esp_err_t start_connect();
+	static void record_handshake(const uint8_t bssid[6]);
+
 	static esp_err_t initialize(SetupMode mode, const char* ssid = nullptr, const char* password = nullptr);
 
     public:
 	static esp_err_t Connect(const char* ssid, const char* password);
+	// Connects with the credentials of the last Connect() or DPP enrollment
+	static esp_err_t ConnectStored();
+	// Stops and releases the driver; release is kept for compatibility, the driver is always released
 	static bool Disconnect(bool release = false);
+	// With KeepDriver, Reconnect() may follow and skips the full handshake
+	static bool Disconnect(DisconnectMode mode);
+	// After Disconnect(DisconnectMode::KeepDriver); ESP_ERR_INVALID_STATE once the driver was released
+	static esp_err_t Reconnect();
+	// SoftAP with the provisioning portal next to the station; returns once a submitted network is up.
+	// An ap_password shorter than 8 characters leaves the AP open.
+	static esp_err_t wait_portal(const char* ap_ssid, const char* ap_password = nullptr);
+	// Switches the running station to another network and connects at once. The switch happens
+	// on the event task; errors after the arguments were checked show as LinkState::Failed
+	static esp_err_t provision(const char* ssid, const char* password);
+	// Copies owned by the calling task, valid until its next call
 	static esp_ip4_addr_t* getIp();
 	static const char* get_address();
+	// Global IPv6 address, else the link-local one; nullptr while the link is not Up
+	static const char* get_address6();
+
+	// Consistent view of the link, safe from any task without locking
+	static LinkSnapshot get_link();
+	// Blocks until the link is in the given state; false on timeout
+	static bool wait_for(LinkState state, TickType_t timeout = portMAX_DELAY);
+	static ScanPlanner::Counters get_scan_counters();
+	static RoamEngine::Stats get_roam_stats();
+	// Starts a roam attempt to the strongest other AP regardless of RSSI and cooldown;
+	// ESP_ERR_NOT_SUPPORTED without CONFIG_WIFI_MANAGER_ROAMING
+	static esp_err_t roam_now();
+	static AdmissionScheduler::Stats get_admission_stats();
+
+	static esp_err_t set_power_profile(PowerProfile profile);
+	static PowerProfile get_power_profile();
+	static uint32_t expected_downlink_latency_ms();
+	// Period of the station's modem sleep wakeups, 0 while the radio stays on
+	static uint32_t wake_interval_us();
+	// Time of association, the reference for the wake period phase
+	static int64_t wake_anchor_us();
+
+	// Bandwidth and protocol are used from the next association, TX power immediately
+	static esp_err_t set_radio_profile(RadioProfile profile);
+	static esp_err_t set_radio_settings(const RadioSettings& settings);
+	static RadioProfile get_radio_profile();
+	static const char* get_radio_profile_name();
+
+	// Used by the next Connect()
+	static esp_err_t set_auth_config(const AuthConfig& config);
+	// Used from the next address event
+	static void set_ip_policy(IpPolicy policy);
+	static IpPolicy get_ip_policy();
+	static AuthStats get_auth_stats(AuthMode mode);
 
 #ifdef CONFIG_WPA_DPP_SUPPORT
     public:
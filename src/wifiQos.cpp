@@ -0,0 +1,241 @@
+#include "wifiQos.hpp"
+#include "log2Histogram.hpp"
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#else
+#include <netinet/in.h>
+#include <time.h>
+#include <mutex>
+#endif
+
+WiFiQos::Flow WiFiQos::flows[WiFiQos::max_flows];
+WiFiQos::Rule WiFiQos::rules[WiFiQos::max_rules];
+int WiFiQos::rule_count = 0;
+// CS1, 0, AF41, CS6: IP precedence 1, 0, 4 and 6
+uint8_t WiFiQos::dscps[WiFiQos::categories] = {8, 0, 34, 48};
+WiFiQos::Counters WiFiQos::counters[WiFiQos::categories];
+
+#ifdef ESP_PLATFORM
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+#define QOS_LOCK() portENTER_CRITICAL(&lock)
+#define QOS_UNLOCK() portEXIT_CRITICAL(&lock)
+#else
+static std::mutex lock;
+#define QOS_LOCK() lock.lock()
+#define QOS_UNLOCK() lock.unlock()
+#endif
+
+static uint32_t now_us() {
+#ifdef ESP_PLATFORM
+	return static_cast<uint32_t>(esp_timer_get_time());
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint32_t>(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+#endif
+}
+
+static uint16_t port_of(const sockaddr_storage &addr) {
+	if (addr.ss_family == AF_INET) return ntohs(reinterpret_cast<const sockaddr_in &>(addr).sin_port);
+	if (addr.ss_family == AF_INET6) return ntohs(reinterpret_cast<const sockaddr_in6 &>(addr).sin6_port);
+	return 0;
+}
+
+int WiFiQos::mark(int sock, AccessCategory ac) {
+	int tos = dscp(ac) << 2;
+#ifdef IPV6_TCLASS
+	sockaddr_storage addr = {};
+	socklen_t len	       = sizeof(addr);
+	if (getsockname(sock, reinterpret_cast<sockaddr *>(&addr), &len) == 0 && addr.ss_family == AF_INET6)
+		return setsockopt(sock, IPPROTO_IPV6, IPV6_TCLASS, &tos, sizeof(tos));
+#endif
+	// lwIP has no IPV6_TCLASS and takes the traffic class of IPv6 sockets from IP_TOS
+	return setsockopt(sock, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+}
+
+int WiFiQos::add_socket(int sock, AccessCategory ac) {
+	if (sock < 0) {
+		errno = EBADF;
+		return -1;
+	}
+	if (mark(sock, ac) != 0) return -1;
+
+	int free_slot = -1;
+	QOS_LOCK();
+	for (int i = 0; i < max_flows; i++) {
+		int s = flows[i].sock.load(std::memory_order_relaxed);
+		if (s == sock + 1) {
+			free_slot = i;
+			break;
+		}
+		if (s == 0 && free_slot < 0) free_slot = i;
+	}
+	if (free_slot >= 0) {
+		flows[free_slot].ac.store(static_cast<uint8_t>(ac), std::memory_order_relaxed);
+		flows[free_slot].sock.store(sock + 1, std::memory_order_release);
+	}
+	QOS_UNLOCK();
+
+	if (free_slot < 0) {
+		errno = ENOSPC;
+		return -1;
+	}
+	return 0;
+}
+
+int WiFiQos::add_ports(uint16_t first, uint16_t last, AccessCategory ac) {
+	if (first > last) {
+		errno = EINVAL;
+		return -1;
+	}
+	int err = 0;
+	QOS_LOCK();
+	if (rule_count < max_rules) rules[rule_count++] = Rule{first, last, ac};
+	else err = ENOSPC;
+	QOS_UNLOCK();
+
+	if (err) {
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
+
+int WiFiQos::apply(int sock) {
+	uint16_t ports[2] = {};
+	sockaddr_storage addr;
+	socklen_t len = sizeof(addr);
+	if (getsockname(sock, reinterpret_cast<sockaddr *>(&addr), &len) == 0) ports[0] = port_of(addr);
+	len = sizeof(addr);
+	if (getpeername(sock, reinterpret_cast<sockaddr *>(&addr), &len) == 0) ports[1] = port_of(addr);
+
+	// The first matching rule wins
+	AccessCategory ac = AccessCategory::BestEffort;
+	QOS_LOCK();
+	bool found = false;
+	for (int i = 0; i < rule_count && !found; i++) {
+		for (uint16_t port : ports) {
+			if (port && port >= rules[i].first && port <= rules[i].last) {
+				ac    = rules[i].ac;
+				found = true;
+				break;
+			}
+		}
+	}
+	QOS_UNLOCK();
+	return add_socket(sock, ac);
+}
+
+void WiFiQos::remove_socket(int sock) {
+	QOS_LOCK();
+	for (Flow &flow : flows) {
+		if (flow.sock.load(std::memory_order_relaxed) == sock + 1) flow.sock.store(0, std::memory_order_release);
+	}
+	QOS_UNLOCK();
+}
+
+void WiFiQos::clear() {
+	QOS_LOCK();
+	for (Flow &flow : flows) flow.sock.store(0, std::memory_order_release);
+	rule_count = 0;
+	QOS_UNLOCK();
+}
+
+WiFiQos::AccessCategory WiFiQos::category(int sock) {
+	for (const Flow &flow : flows) {
+		if (flow.sock.load(std::memory_order_acquire) == sock + 1)
+			return static_cast<AccessCategory>(flow.ac.load(std::memory_order_relaxed));
+	}
+	return AccessCategory::BestEffort;
+}
+
+uint8_t WiFiQos::dscp(AccessCategory ac) {
+	return dscps[static_cast<int>(ac)];
+}
+
+void WiFiQos::set_dscp(AccessCategory ac, uint8_t dscp) {
+	dscps[static_cast<int>(ac)] = dscp & 0x3f;
+}
+
+void WiFiQos::account(AccessCategory ac, ssize_t sent, int err, uint32_t delay_us) {
+	Counters &c = counters[static_cast<int>(ac)];
+	if (sent < 0) {
+		if (err == ENOMEM || err == ENOBUFS || err == EAGAIN || err == EWOULDBLOCK)
+			c.drops.fetch_add(1, std::memory_order_relaxed);
+		else
+			c.errors.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	c.packets.fetch_add(1, std::memory_order_relaxed);
+	c.bytes.fetch_add(static_cast<uint32_t>(sent), std::memory_order_relaxed);
+
+	int b = 0;
+	while (b < delay_buckets - 1 && delay_us >= (1u << b)) b++;
+	c.histogram[b].fetch_add(1, std::memory_order_relaxed);
+	uint32_t max = c.delay_max_us.load(std::memory_order_relaxed);
+	while (delay_us > max && !c.delay_max_us.compare_exchange_weak(max, delay_us, std::memory_order_relaxed)) {
+	}
+}
+
+ssize_t WiFiQos::transmit(int sock, const void *data, size_t len, int flags) {
+	AccessCategory ac = category(sock);
+	uint32_t start	   = now_us();
+	ssize_t sent	   = ::send(sock, data, len, flags);
+	int err		   = errno;
+	account(ac, sent, err, now_us() - start);
+	errno = err;
+	return sent;
+}
+
+ssize_t WiFiQos::transmit_to(int sock, const void *data, size_t len, int flags, const struct sockaddr *to, socklen_t tolen) {
+	AccessCategory ac = category(sock);
+	uint32_t start	   = now_us();
+	ssize_t sent	   = ::sendto(sock, data, len, flags, to, tolen);
+	int err		   = errno;
+	account(ac, sent, err, now_us() - start);
+	errno = err;
+	return sent;
+}
+
+WiFiQos::Stats WiFiQos::get_stats(AccessCategory ac) {
+	const Counters &c = counters[static_cast<int>(ac)];
+	Stats s		  = {};
+	s.packets	  = c.packets.load(std::memory_order_relaxed);
+	s.bytes	  = c.bytes.load(std::memory_order_relaxed);
+	s.drops	  = c.drops.load(std::memory_order_relaxed);
+	s.errors	  = c.errors.load(std::memory_order_relaxed);
+	s.delay_max_us = c.delay_max_us.load(std::memory_order_relaxed);
+
+	uint32_t h[delay_buckets];
+	for (int b = 0; b < delay_buckets; b++) h[b] = c.histogram[b].load(std::memory_order_relaxed);
+	s.delay_p50_us = log2_percentile(h, delay_buckets, 500, s.delay_max_us);
+	s.delay_p90_us = log2_percentile(h, delay_buckets, 900, s.delay_max_us);
+	s.delay_p99_us = log2_percentile(h, delay_buckets, 990, s.delay_max_us);
+	return s;
+}
+
+void WiFiQos::reset_stats() {
+	for (Counters &c : counters) {
+		c.packets.store(0, std::memory_order_relaxed);
+		c.bytes.store(0, std::memory_order_relaxed);
+		c.drops.store(0, std::memory_order_relaxed);
+		c.errors.store(0, std::memory_order_relaxed);
+		c.delay_max_us.store(0, std::memory_order_relaxed);
+		for (std::atomic<uint32_t> &b : c.histogram) b.store(0, std::memory_order_relaxed);
+	}
+}
+
+const char *WiFiQos::name(AccessCategory ac) {
+	switch (ac) {
+		case AccessCategory::Background: return "background";
+		case AccessCategory::BestEffort: return "best_effort";
+		case AccessCategory::Video: return "video";
+		case AccessCategory::Voice: return "voice";
+	}
+	return "?";
+}
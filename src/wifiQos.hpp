@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include <lwip/sockets.h>
+#else
+#include <sys/socket.h>
+#include <sys/types.h>
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_QOS_FLOWS
+#define QOS_FLOWS CONFIG_WIFI_MANAGER_QOS_FLOWS
+#else
+#define QOS_FLOWS 16
+#endif
+
+/*
+ * Per-flow WMM access categories for the station's traffic. A flow is a
+ * socket, registered directly or matched by a port range rule when apply()
+ * is called on it, and gets the IP TOS (IPv6 traffic class) of its category.
+ * The driver and the AP pick the WMM queue from the IP precedence, the top
+ * three DSCP bits: 1-2 background, 0 and 3 best effort, 4-5 video, 6-7
+ * voice. The default DSCPs are chosen so that precedence lands in the
+ * intended category: CS1, 0, AF41 and CS6. EF (46) would be video.
+ *
+ * transmit() and transmit_to() account each packet to its flow's category: the time
+ * spent in the call, which grows while lwIP and the driver queues are
+ * backed up, as a histogram with percentiles, and the packets the stack
+ * refused as drops.
+ */
+class WiFiQos {
+    public:
+	enum class AccessCategory : uint8_t { Background, BestEffort, Video, Voice };
+	static const int categories = 4;
+	static const int max_flows	 = QOS_FLOWS;
+	static const int max_rules	 = 8;
+
+	struct Stats {
+		uint32_t packets;
+		uint32_t bytes;		    // Modulo 2^32
+		uint32_t drops;		    // ENOMEM, ENOBUFS or EAGAIN from the stack
+		uint32_t errors;		    // Other send failures
+		uint32_t delay_p50_us;  // Time in the send call, upper bound of the histogram bucket
+		uint32_t delay_p90_us;
+		uint32_t delay_p99_us;
+		uint32_t delay_max_us;
+	};
+
+	// Marks the socket now; returns 0, or -1 with errno
+	static int add_socket(int sock, AccessCategory ac);
+	// Sockets with a local or peer port in [first, last], once apply() is called on them
+	static int add_ports(uint16_t first, uint16_t last, AccessCategory ac);
+	// Registers and marks the socket by the port rules, after bind() or connect();
+	// best effort without a matching rule
+	static int apply(int sock);
+	// Call before closing a registered socket, the descriptor will be reused
+	static void remove_socket(int sock);
+	static void clear();
+
+	// Best effort for sockets that are not registered
+	static AccessCategory category(int sock);
+	static uint8_t dscp(AccessCategory ac);
+	// Only affects sockets marked afterwards
+	static void set_dscp(AccessCategory ac, uint8_t dscp);
+
+	// send() and sendto() with accounting; not named so because lwIP may define those as macros
+	static ssize_t transmit(int sock, const void* data, size_t len, int flags = 0);
+	static ssize_t transmit_to(int sock, const void* data, size_t len, int flags, const struct sockaddr* to, socklen_t tolen);
+
+	static Stats get_stats(AccessCategory ac);
+	static void reset_stats();
+	static const char* name(AccessCategory ac);
+
+    private:
+	WiFiQos();
+
+	static const int delay_buckets = 17;  // <1us, <2us, ... <32768us, longer
+
+	struct Flow {
+		std::atomic<int> sock;  // Descriptor + 1, 0 while free
+		std::atomic<uint8_t> ac;
+	};
+
+	struct Rule {
+		uint16_t first;
+		uint16_t last;
+		AccessCategory ac;
+	};
+
+	struct Counters {
+		std::atomic<uint32_t> packets;
+		std::atomic<uint32_t> bytes;
+		std::atomic<uint32_t> drops;
+		std::atomic<uint32_t> errors;
+		std::atomic<uint32_t> delay_max_us;
+		std::atomic<uint32_t> histogram[delay_buckets];
+	};
+
+	// Registration is serialized, category() reads the flows lock-free
+	static Flow flows[max_flows];
+	static Rule rules[max_rules];
+	static int rule_count;
+	static uint8_t dscps[categories];
+	static Counters counters[categories];
+
+	static int mark(int sock, AccessCategory ac);
+	static void account(AccessCategory ac, ssize_t sent, int err, uint32_t delay_us);
+};
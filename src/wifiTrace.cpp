@@ -0,0 +1,153 @@
+#include "wifiTrace.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <sched.h>
+#include <time.h>
+#include <functional>
+#include <thread>
+#endif
+
+std::atomic<uint32_t> WiFiTrace::head(0);
+
+#if WIFI_TRACE
+WiFiTrace::Slot WiFiTrace::slots[WiFiTrace::events];
+WiFiTrace::Task WiFiTrace::tasks[WiFiTrace::max_tasks];
+
+static int64_t now_us() {
+#ifdef ESP_PLATFORM
+	return esp_timer_get_time();
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+#endif
+}
+
+static uintptr_t current_task() {
+#ifdef ESP_PLATFORM
+	return reinterpret_cast<uintptr_t>(xTaskGetCurrentTaskHandle());
+#else
+	return std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+#endif
+}
+
+static uint8_t current_core() {
+#ifdef ESP_PLATFORM
+	return static_cast<uint8_t>(xPortGetCoreID());
+#else
+	int cpu = sched_getcpu();
+	return static_cast<uint8_t>(cpu < 0 ? 0 : cpu);
+#endif
+}
+
+uint8_t WiFiTrace::task_index() {
+	uintptr_t self = current_task();
+	for (int i = 0; i < max_tasks; i++) {
+		uintptr_t id = tasks[i].id.load(std::memory_order_acquire);
+		if (id == self) return static_cast<uint8_t>(i);
+		if (id) continue;
+		if (!tasks[i].id.compare_exchange_strong(id, self, std::memory_order_acq_rel)) {
+			if (id == self) return static_cast<uint8_t>(i);
+			continue;
+		}
+#ifdef ESP_PLATFORM
+		strncpy(tasks[i].name, pcTaskGetName(nullptr), sizeof(tasks[i].name) - 1);
+#else
+		snprintf(tasks[i].name, sizeof(tasks[i].name), "thread %d", i);
+#endif
+		tasks[i].named.store(true, std::memory_order_release);
+		return static_cast<uint8_t>(i);
+	}
+	return max_tasks;
+}
+
+void WiFiTrace::record(const char *name, char phase, int32_t arg) {
+	uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+	if (index >= events) return;  // Full, counted by dropped()
+
+	Slot &slot		  = slots[index];
+	slot.event.time_us = now_us();
+	slot.event.name	  = name;
+	slot.event.arg	  = arg;
+	slot.event.phase	  = phase;
+	slot.event.core	  = current_core();
+	slot.event.task	  = task_index();
+	slot.seq.store(index + 1, std::memory_order_release);
+}
+#else
+void WiFiTrace::record(const char *, char, int32_t) {
+}
+#endif
+
+uint32_t WiFiTrace::recorded() {
+	uint32_t n = head.load(std::memory_order_relaxed);
+	return n < events ? n : events;
+}
+
+uint32_t WiFiTrace::dropped() {
+	uint32_t n = head.load(std::memory_order_relaxed);
+	return n > events ? n - events : 0;
+}
+
+void WiFiTrace::reset() {
+#if WIFI_TRACE
+	for (Slot &slot : slots) slot.seq.store(0, std::memory_order_relaxed);
+#endif
+	head.store(0, std::memory_order_release);
+}
+
+// Names are copied up to the first character JSON would need escaped
+static size_t json_name(char *out, size_t size, const char *name) {
+	size_t n = 0;
+	for (; name[n] && n + 1 < size; n++) {
+		if (name[n] == '"' || name[n] == '\\' || static_cast<unsigned char>(name[n]) < 0x20) break;
+		out[n] = name[n];
+	}
+	out[n] = 0;
+	return n;
+}
+
+int WiFiTrace::dump_json(writer_t writer, void *arg) {
+	char line[192];
+	int len = snprintf(line, sizeof(line),
+				    "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%u},\"traceEvents\":[\n"
+				    "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"wifi_manager\"}}",
+				    static_cast<unsigned>(dropped()));
+	int err = writer(line, len, arg);
+
+#if WIFI_TRACE
+	char name[48];
+	for (int i = 0; !err && i < max_tasks; i++) {
+		if (!tasks[i].named.load(std::memory_order_acquire)) continue;
+		json_name(name, sizeof(name), tasks[i].name);
+		len = snprintf(line, sizeof(line), ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", i, name);
+		err = writer(line, len, arg);
+	}
+
+	uint32_t end = recorded();
+	for (uint32_t index = 0; !err && index < end; index++) {
+		const Slot &slot = slots[index];
+		// Still being written
+		if (slot.seq.load(std::memory_order_acquire) != index + 1) continue;
+		const Event &e = slot.event;
+		json_name(name, sizeof(name), e.name);
+		// Instants are scoped to their thread
+		len = snprintf(line, sizeof(line),
+				     ",\n{\"ph\":\"%c\",%s\"name\":\"%s\",\"ts\":%lld,\"pid\":1,\"tid\":%u,\"args\":{\"core\":%u,\"arg\":%d}}",
+				     e.phase, e.phase == 'i' ? "\"s\":\"t\"," : "", name, static_cast<long long>(e.time_us), e.task, e.core,
+				     static_cast<int>(e.arg));
+		if (len >= static_cast<int>(sizeof(line))) len = sizeof(line) - 1;
+		err = writer(line, len, arg);
+	}
+#endif
+
+	if (!err) err = writer("\n]}\n", 4, arg);
+	return err;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef CONFIG_WIFI_MANAGER_TRACE
+#define WIFI_TRACE 1
+#else
+#define WIFI_TRACE 0
+#endif
+
+#ifdef CONFIG_WIFI_MANAGER_TRACE_EVENTS
+#define WIFI_TRACE_EVENTS CONFIG_WIFI_MANAGER_TRACE_EVENTS
+#else
+#define WIFI_TRACE_EVENTS 1024
+#endif
+
+// Without CONFIG_WIFI_MANAGER_TRACE these compile to nothing and the arguments are not evaluated
+#if WIFI_TRACE
+#define WIFI_TRACE_JOIN_(a, b) a##b
+#define WIFI_TRACE_JOIN(a, b) WIFI_TRACE_JOIN_(a, b)
+#define WIFI_TRACE_BEGIN(name, ...) WiFiTrace::record(name, 'B', ##__VA_ARGS__)
+#define WIFI_TRACE_END(name) WiFiTrace::record(name, 'E')
+#define WIFI_TRACE_INSTANT(name, ...) WiFiTrace::record(name, 'i', ##__VA_ARGS__)
+// Begin here, end when the enclosing block is left
+#define WIFI_TRACE_SCOPE(name, ...) WiFiTrace::Scope WIFI_TRACE_JOIN(wifi_trace_, __LINE__)(name, ##__VA_ARGS__)
+#else
+#define WIFI_TRACE_BEGIN(name, ...) do {} while (0)
+#define WIFI_TRACE_END(name) do {} while (0)
+#define WIFI_TRACE_INSTANT(name, ...) do {} while (0)
+#define WIFI_TRACE_SCOPE(name, ...) do {} while (0)
+#endif
+
+/*
+ * Timeline of one boot: begin, end and instant events with the task and
+ * core that recorded them, stored lock-free into a preallocated buffer of
+ * CONFIG_WIFI_MANAGER_TRACE_EVENTS entries. Recording stops when the buffer
+ * is full, so the start of the boot is kept, and the rest is counted as
+ * dropped. Names must be string literals or otherwise outlive the dump.
+ * dump_json() writes Chrome Trace Event JSON, which Perfetto and
+ * chrome://tracing open.
+ */
+class WiFiTrace {
+    public:
+	static const size_t events	  = WIFI_TRACE_EVENTS;
+	static const int max_tasks = 16;  // Further tasks share one "other" track
+
+	struct Event {
+		int64_t time_us;
+		const char* name;
+		int32_t arg;
+		char phase;  // 'B', 'E' or 'i'
+		uint8_t core;
+		uint8_t task;  // Index into the task table
+	};
+
+	class Scope {
+	    public:
+		explicit Scope(const char* name, int32_t arg = 0) : name(name) {
+			record(name, 'B', arg);
+		}
+		~Scope() {
+			record(name, 'E');
+		}
+
+	    private:
+		const char* name;
+	};
+
+	// Returns 0 to go on
+	typedef int (*writer_t)(const void* data, size_t len, void* arg);
+
+	static void record(const char* name, char phase, int32_t arg = 0);
+	// Also fine while tasks record; their events after the start of the dump may be missing
+	static int dump_json(writer_t writer, void* arg);
+	static uint32_t recorded();
+	static uint32_t dropped();
+	// Only while nothing records
+	static void reset();
+
+    private:
+	WiFiTrace();
+
+	struct Slot {
+		std::atomic<uint32_t> seq;  // index + 1 once complete
+		Event event;
+	};
+
+	struct Task {
+		std::atomic<uintptr_t> id;  // 0 while free
+		std::atomic<bool> named;
+		char name[16];
+	};
+
+	static Slot slots[events];
+	static Task tasks[max_tasks];
+	static std::atomic<uint32_t> head;
+
+	static uint8_t task_index();
+};
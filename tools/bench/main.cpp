@@ -0,0 +1,90 @@
+/*
+ * Peer and client of WiFiBench on Linux.
+ *
+ *   wifi_bench serve [port]                  Peer for devices running WiFiBench::run()
+ *   wifi_bench run <peer> <test> [port]      Run one test against a peer
+ *   wifi_bench loopback                      Every test against a peer on 127.0.0.1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "wifiBench.hpp"
+
+static const WiFiBench::Test tests[] = {
+	WiFiBench::Test::TcpSend,
+	WiFiBench::Test::TcpReceive,
+	WiFiBench::Test::UdpSend,
+	WiFiBench::Test::UdpReceive,
+	WiFiBench::Test::UdpRtt,
+};
+
+static void print(const WiFiBench::Result& r) {
+	printf("%-12s err=%d profile=%s rssi=%d %.2f Mbit/s bytes=%llu jitter=%.3fms packets=%u lost=%u retrans=%u rtt p50/p90/p99/max=%u/%u/%u/%u us\n",
+		  WiFiBench::test_name(r.test), r.err, r.radio_profile, r.rssi, r.mbps,
+		  static_cast<unsigned long long>(r.bytes), r.jitter_ms, r.packets, r.lost, r.retransmits,
+		  r.rtt_p50_us, r.rtt_p90_us, r.rtt_p99_us, r.rtt_max_us);
+}
+
+static bool parse_test(const char* name, WiFiBench::Test& test) {
+	for (WiFiBench::Test t : tests) {
+		if (strcmp(name, WiFiBench::test_name(t)) == 0) {
+			test = t;
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char** argv) {
+	if (argc >= 2 && strcmp(argv[1], "serve") == 0) {
+		uint16_t port = argc >= 3 ? static_cast<uint16_t>(atoi(argv[2])) : 5201;
+		int err	    = WiFiBench::serve(port, nullptr);
+		fprintf(stderr, "serve: %s\n", strerror(err));
+		return 1;
+	}
+
+	if (argc >= 4 && strcmp(argv[1], "run") == 0) {
+		WiFiBench::Test test;
+		if (!parse_test(argv[3], test)) {
+			fprintf(stderr, "unknown test %s\n", argv[3]);
+			return 2;
+		}
+		WiFiBench::Config config = WiFiBench::default_config(argv[2], test);
+		if (argc >= 5) config.port = static_cast<uint16_t>(atoi(argv[4]));
+		WiFiBench::Result r = WiFiBench::run(config);
+		print(r);
+		return r.err ? 1 : 0;
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "loopback") == 0) {
+		// Bound before the first client connects
+		WiFiBench::Server server;
+		int serve_err = WiFiBench::open_server(5201, server);
+		if (serve_err) {
+			fprintf(stderr, "serve: %s\n", strerror(serve_err));
+			return 1;
+		}
+		volatile bool stop = false;
+		std::thread peer([&] { serve_err = WiFiBench::serve(server, &stop); });
+
+		int failed = 0;
+		for (WiFiBench::Test test : tests) {
+			WiFiBench::Config config = WiFiBench::default_config("127.0.0.1", test);
+			config.duration_ms	    = 1000;
+			if (test == WiFiBench::Test::UdpSend || test == WiFiBench::Test::UdpReceive) config.rate_kbps = 50000;
+			WiFiBench::Result r = WiFiBench::run(config);
+			print(r);
+			if (r.err || (test == WiFiBench::Test::UdpRtt ? r.lost == r.packets : r.bytes == 0)) failed++;
+		}
+
+		stop = true;
+		peer.join();
+		if (serve_err) fprintf(stderr, "serve: %s\n", strerror(serve_err));
+		return failed || serve_err ? 1 : 0;
+	}
+
+	fprintf(stderr, "usage: %s serve [port] | run <peer> <test> [port] | loopback\n", argv[0]);
+	return 2;
+}
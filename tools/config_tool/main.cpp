@@ -0,0 +1,99 @@
+/*
+ * Host side of ConfigStore.
+ *
+ *   config_tool dump <prefix>        Print the newest valid copy of <prefix>.a / <prefix>.b
+ *   config_tool selftest <prefix>    Write, reload, corrupt the newest slot, check the fallback
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "configStore.hpp"
+
+static void print(const StoredConfig& c) {
+	ConfigStore::Stats s = ConfigStore::get_stats();
+	printf("slot=%d sequence=%u load=%uus\n", s.loaded_slot, s.sequence, s.load_us);
+	printf("ssid=\"%s\" auth=%u password=%s dpp_key=%s\n", c.ssid, c.auth_mode, c.password[0] ? "set" : "empty",
+		  c.dpp_key[0] ? "set" : "empty");
+	printf("bssid=%02x:%02x:%02x:%02x:%02x:%02x channel=%u\n", c.bssid[0], c.bssid[1], c.bssid[2], c.bssid[3],
+		  c.bssid[4], c.bssid[5], c.channel);
+	const uint8_t* ip = reinterpret_cast<const uint8_t*>(&c.lease_ip);
+	printf("lease=%u.%u.%u.%u\n", ip[0], ip[1], ip[2], ip[3]);
+	printf("boots=%u connects=%u roams=%u disconnects=%u\n", c.boots, c.connects, c.roams, c.disconnects);
+	for (int i = 0; i < ScanPlanner::history_size; i++) {
+		if (!c.planner[i].ssid_hash) continue;
+		printf("planner %08x:", c.planner[i].ssid_hash);
+		for (int ch = 0; ch < ScanPlanner::max_channel; ch++) {
+			if (c.planner[i].score[ch]) printf(" ch%d=%u", ch + 1, c.planner[i].score[ch]);
+		}
+		printf("\n");
+	}
+}
+
+static bool check(bool ok, const char* what) {
+	printf("%-40s %s\n", what, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+static int selftest(const char* prefix) {
+	char path[64];
+	for (char slot : {'a', 'b'}) {
+		snprintf(path, sizeof(path), "%s.%c", prefix, slot);
+		remove(path);
+	}
+
+	bool ok = check(ConfigStore::load(prefix) != 0 && ConfigStore::get_stats().loaded_slot == -1, "empty store");
+
+	ConfigStore::update([](StoredConfig& c) {
+		strcpy(c.ssid, "first");
+		c.boots = 1;
+	});
+	ok &= check(ConfigStore::flush() == 0, "first write");
+	ConfigStore::update([](StoredConfig& c) {
+		strcpy(c.ssid, "second");
+		c.boots = 2;
+	});
+	ok &= check(ConfigStore::flush() == 0, "second write");
+	ok &= check(ConfigStore::flush() == 0 && ConfigStore::get_stats().unchanged == 1, "unchanged write skipped");
+
+	ConfigStore::load(prefix);
+	ok &= check(ConfigStore::get_stats().loaded_slot == 1 && ConfigStore::get().boots == 2, "newest slot loaded");
+
+	// Flip one payload byte of the newest copy, as a torn write would leave it
+	snprintf(path, sizeof(path), "%s.b", prefix);
+	FILE* f = fopen(path, "r+b");
+	if (f) {
+		fseek(f, 20, SEEK_SET);
+		int c = fgetc(f);
+		fseek(f, 20, SEEK_SET);
+		fputc(c ^ 0xff, f);
+		fclose(f);
+	}
+	ConfigStore::load(prefix);
+	StoredConfig c = ConfigStore::get();
+	ok &= check(ConfigStore::get_stats().loaded_slot == 0 && strcmp(c.ssid, "first") == 0, "corrupt slot falls back");
+
+	// The next write replaces the corrupt slot, not the surviving one
+	ConfigStore::update([](StoredConfig& c) { c.boots = 3; });
+	ConfigStore::flush();
+	ConfigStore::load(prefix);
+	ok &= check(ConfigStore::get_stats().loaded_slot == 1 && ConfigStore::get().boots == 3, "write after fallback");
+
+	printf("%s\n", ok ? "PASS" : "FAIL");
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+	if (argc == 3 && strcmp(argv[1], "dump") == 0) {
+		int err = ConfigStore::load(argv[2]);
+		if (ConfigStore::get_stats().loaded_slot < 0) {
+			fprintf(stderr, "no valid copy (%d)\n", err);
+			return 1;
+		}
+		print(ConfigStore::get());
+		return 0;
+	}
+	if (argc == 3 && strcmp(argv[1], "selftest") == 0) return selftest(argv[2]);
+
+	fprintf(stderr, "usage: %s dump|selftest <prefix>\n", argv[0]);
+	return 2;
+}
@@ -0,0 +1,311 @@
+// Brings a fleet of stations back onto one AP after the AP rebooted, once with
+// the driver retrying at once and once with AdmissionScheduler, and reports how
+// long after the AP came back the fleet was online.
+//
+//   fleet_sim [--stations N] [--down-ms MS] [--capacity N] [--handshake-ms MS]
+//             [--ap silent|refuse|comeback] [--seed N] [--check]
+//
+// The AP handles `capacity` handshakes at a time. Arrivals beyond that are
+// dropped (silent, the station times out), refused with status 17 (refuse), or
+// refused with status 30 and a comeback time (comeback). Admitted handshakes
+// slow down in proportion to the arrivals of the last second once those exceed
+// what the AP can serve, and fail when they take longer than the timeout.
+// A station that gives up reboots and connects 30s later without waiting for a
+// slot. The immediate fleet ignores comeback times, as before the scheduler.
+// --check fails unless the slotted fleet is all online without reboots, and
+// sooner than the immediate one.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "admissionScheduler.hpp"
+
+static const int64_t BEACON_TIMEOUT_MS = 6000;
+static const int64_t BEACON_MS		= 102;
+static const int64_t FULL_SWEEP_MS	= 13 * 120;  // Connect scan without a known channel
+static const int64_t PROBE_MS		= 60;		 // Probe on the known channel
+static const int64_t REFUSAL_MS		= 20;
+static const int MAXIMUM_RETRY		= 5;  // As WiFi::event_handler
+
+enum class Policy { Immediate, Slotted };
+enum class ApMode { Silent, Refuse, Comeback };
+
+struct Params {
+	int stations		  = 400;
+	int64_t down_ms	  = 20000;
+	int capacity		  = 8;
+	int64_t handshake_ms = 250;
+	int64_t timeout_ms	  = 2000;
+	int64_t reboot_ms	  = 30000;
+	int64_t limit_ms	  = 900000;
+	ApMode ap		  = ApMode::Silent;
+	uint32_t seed		  = 1;
+};
+
+struct Result {
+	int64_t online_ms[3];  // 50%, 90% and 100% online after the AP came back, -1 when not reached
+	int online;
+	uint32_t attempts;
+	uint32_t overloads;
+	uint32_t reboots;
+	size_t peak_per_s;  // Most arrivals at the AP within a second
+};
+
+struct Station {
+	explicit Station(const AdmissionScheduler::Config& config) : admission(config) {}
+
+	uint8_t mac[6];
+	AdmissionScheduler admission;
+	int retries			= 0;
+	bool online			= true;
+	bool channel_known	= true;
+	bool admitted		= false;  // Holds one of the AP's handshake places
+	int64_t online_at	= 0;
+};
+
+enum class Kind { Lost, Start, Arrive, Done };
+
+struct Event {
+	int64_t t;
+	uint64_t seq;
+	int station;
+	Kind kind;
+	AdmissionScheduler::Failure failure;
+	bool success;
+	uint32_t comeback_ms;
+
+	bool operator>(const Event& o) const {
+		return t != o.t ? t > o.t : seq > o.seq;
+	}
+};
+
+class Fleet {
+    public:
+	Fleet(const Params& p, Policy policy) : p(p), policy(policy), rng(p.seed), seq(0), in_flight(0), result() {
+		AdmissionScheduler::Config config = AdmissionScheduler::default_config();
+		for (int i = 0; i < p.stations; i++) {
+			Station s(config);
+			// One vendor, consecutive serials
+			const uint8_t mac[6] = {0x24, 0x0a, 0xc4, static_cast<uint8_t>(i >> 16), static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(i)};
+			memcpy(s.mac, mac, 6);
+			s.admission.set_mac(mac);
+			s.admission.on_connected(0);
+			stations.push_back(s);
+		}
+	}
+
+	Result run() {
+		std::uniform_int_distribution<int64_t> beacon(0, BEACON_MS);
+		for (int i = 0; i < p.stations; i++) push(BEACON_TIMEOUT_MS + beacon(rng), i, Kind::Lost);
+
+		while (!queue.empty() && queue.top().t <= p.limit_ms) {
+			Event e = queue.top();
+			queue.pop();
+			Station& s = stations[e.station];
+			switch (e.kind) {
+				case Kind::Lost:
+					s.online = false;
+					disconnected(e.t, e.station, AdmissionScheduler::Failure::Absent, 0);
+					break;
+				case Kind::Start:
+					start(e.t, e.station);
+					break;
+				case Kind::Arrive:
+					arrive(e.t, e.station);
+					break;
+				case Kind::Done:
+					if (s.admitted) in_flight--;
+					s.admitted = false;
+					if (e.success) {
+						s.online		= true;
+						s.online_at	= e.t;
+						s.retries		= 0;
+						s.channel_known = true;
+						s.admission.on_connected(e.t * 1000);
+					} else {
+						if (e.failure == AdmissionScheduler::Failure::Absent) s.channel_known = false;
+						else result.overloads++;
+						disconnected(e.t, e.station, e.failure, e.comeback_ms);
+					}
+					break;
+			}
+		}
+
+		std::vector<int64_t> times;
+		for (const Station& s : stations)
+			if (s.online) times.push_back(std::max<int64_t>(s.online_at - p.down_ms, 0));
+		std::sort(times.begin(), times.end());
+		result.online	= static_cast<int>(times.size());
+		const int pct[3] = {50, 90, 100};
+		for (int i = 0; i < 3; i++) {
+			size_t need	     = (static_cast<size_t>(p.stations) * pct[i] + 99) / 100;
+			result.online_ms[i] = need && need <= times.size() ? times[need - 1] : -1;
+		}
+		return result;
+	}
+
+    private:
+	const Params& p;
+	Policy policy;
+	std::mt19937 rng;
+	uint64_t seq;
+	std::vector<Station> stations;
+	std::priority_queue<Event, std::vector<Event>, std::greater<Event>> queue;
+	int in_flight;
+	std::deque<int64_t> arrivals;
+	Result result;
+
+	void push(int64_t t, int station, Kind kind, bool success = false,
+			AdmissionScheduler::Failure failure = AdmissionScheduler::Failure::Other, uint32_t comeback_ms = 0) {
+		queue.push(Event{t, seq++, station, kind, failure, success, comeback_ms});
+	}
+
+	int64_t jitter(int64_t ms, int pct) {
+		std::uniform_int_distribution<int64_t> d(-ms * pct / 100, ms * pct / 100);
+		return ms + d(rng);
+	}
+
+	// The disconnect branch of WiFi::event_handler
+	void disconnected(int64_t t, int i, AdmissionScheduler::Failure failure, uint32_t comeback_ms) {
+		Station& s = stations[i];
+		if (s.retries >= MAXIMUM_RETRY) return reboot(t, i);
+		if (policy == Policy::Immediate) {
+			s.retries++;
+			return push(t, i, Kind::Start);
+		}
+		uint32_t delay = s.admission.on_disconnected(t * 1000, failure, comeback_ms);
+		if (delay == AdmissionScheduler::give_up) return reboot(t, i);
+		if (failure == AdmissionScheduler::Failure::Other) s.retries++;
+		push(t + delay, i, Kind::Start);
+	}
+
+	// Boot connects without waiting for a slot
+	void reboot(int64_t t, int i) {
+		Station& s	 = stations[i];
+		s.admission	 = AdmissionScheduler(AdmissionScheduler::default_config());
+		s.admission.set_mac(s.mac);
+		s.retries	 = 0;
+		s.channel_known = true;  // Kept by the configuration store
+		result.reboots++;
+		push(t + p.reboot_ms, i, Kind::Start);
+	}
+
+	void start(int64_t t, int i) {
+		Station& s = stations[i];
+		result.attempts++;
+		int64_t reach = t + (s.channel_known ? jitter(PROBE_MS, 20) : jitter(FULL_SWEEP_MS, 10));
+		if (reach < p.down_ms) {
+			// Nothing answers; a probe on the known channel falls back to the sweep
+			int64_t found = s.channel_known ? reach + jitter(FULL_SWEEP_MS, 10) : reach;
+			return push(found, i, Kind::Done, false, AdmissionScheduler::Failure::Absent);
+		}
+		push(reach, i, Kind::Arrive);
+	}
+
+	void arrive(int64_t t, int i) {
+		Station& s = stations[i];
+		while (!arrivals.empty() && arrivals.front() <= t - 1000) arrivals.pop_front();
+		arrivals.push_back(t);
+		result.peak_per_s = std::max(result.peak_per_s, arrivals.size());
+
+		const AdmissionScheduler::Failure overloaded = AdmissionScheduler::Failure::Overloaded;
+		if (in_flight >= p.capacity) {
+			switch (p.ap) {
+				case ApMode::Silent:
+					return push(t + p.timeout_ms, i, Kind::Done, false, overloaded);
+				case ApMode::Refuse:
+					return push(t + REFUSAL_MS, i, Kind::Done, false, overloaded);
+				case ApMode::Comeback: {
+					// Until the handshakes that arrived in the last second are through
+					uint32_t comeback = static_cast<uint32_t>(arrivals.size() * p.handshake_ms / p.capacity);
+					return push(t + REFUSAL_MS, i, Kind::Done, false, overloaded, comeback);
+				}
+			}
+		}
+
+		in_flight++;
+		s.admitted	    = true;
+		double served   = 1000.0 * p.capacity / p.handshake_ms;
+		double load	    = std::max(1.0, arrivals.size() / served);
+		int64_t duration = static_cast<int64_t>(jitter(p.handshake_ms, 20) * load);
+		if (duration > p.timeout_ms) return push(t + p.timeout_ms, i, Kind::Done, false, overloaded);
+		push(t + duration, i, Kind::Done, true);
+	}
+};
+
+static const char* ap_name(ApMode mode) {
+	switch (mode) {
+		case ApMode::Silent:
+			return "silent";
+		case ApMode::Refuse:
+			return "refuse";
+		default:
+			return "comeback";
+	}
+}
+
+static void print_ms(int64_t ms) {
+	if (ms < 0) printf("       -");
+	else printf(" %6.1fs", ms / 1000.0);
+}
+
+static void print(const char* name, const Result& r) {
+	printf("%-10s", name);
+	for (int i = 0; i < 3; i++) print_ms(r.online_ms[i]);
+	printf(" %7d %9u %10u %8u %7zu\n", r.online, r.attempts, r.overloads, r.reboots, r.peak_per_s);
+}
+
+static int usage(const char* name) {
+	fprintf(stderr,
+		   "usage: %s [--stations N] [--down-ms MS] [--capacity N] [--handshake-ms MS]\n"
+		   "          [--ap silent|refuse|comeback] [--seed N] [--check]\n",
+		   name);
+	return 2;
+}
+
+int main(int argc, char** argv) {
+	Params p;
+	bool check = false;
+	for (int i = 1; i < argc; i++) {
+		const char* arg   = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (strcmp(arg, "--check") == 0) {
+			check = true;
+			continue;
+		}
+		if (!value) return usage(argv[0]);
+		i++;
+		if (strcmp(arg, "--stations") == 0) p.stations = atoi(value);
+		else if (strcmp(arg, "--down-ms") == 0) p.down_ms = atoll(value);
+		else if (strcmp(arg, "--capacity") == 0) p.capacity = atoi(value);
+		else if (strcmp(arg, "--handshake-ms") == 0) p.handshake_ms = atoll(value);
+		else if (strcmp(arg, "--seed") == 0) p.seed = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(arg, "--ap") == 0) {
+			if (strcmp(value, "silent") == 0) p.ap = ApMode::Silent;
+			else if (strcmp(value, "refuse") == 0) p.ap = ApMode::Refuse;
+			else if (strcmp(value, "comeback") == 0) p.ap = ApMode::Comeback;
+			else return usage(argv[0]);
+		} else return usage(argv[0]);
+	}
+	if (p.stations <= 0 || p.capacity <= 0 || p.handshake_ms <= 0 || p.down_ms < 0) return usage(argv[0]);
+
+	printf("%d stations, AP down for %.1fs, %d handshakes of %lldms at a time, overload: %s\n", p.stations,
+		  p.down_ms / 1000.0, p.capacity, static_cast<long long>(p.handshake_ms), ap_name(p.ap));
+	printf("policy         50%%     90%%    100%%  online  attempts  overloads  reboots  peak/s\n");
+	Result immediate = Fleet(p, Policy::Immediate).run();
+	Result slotted   = Fleet(p, Policy::Slotted).run();
+	print("immediate", immediate);
+	print("slotted", slotted);
+
+	if (!check) return 0;
+	bool ok = slotted.online == p.stations && slotted.reboots == 0 &&
+			(immediate.online_ms[2] < 0 || slotted.online_ms[2] < immediate.online_ms[2]);
+	printf("%s\n", ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+/*
+ * Formats WiFiLog::dump() output on Linux.
+ *
+ *   log_decode <file>    Decode a dump captured from the device ("-" for stdin)
+ *   log_decode demo      Record a few messages with the host build of WiFiLog and decode them
+ */
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "wifiLog.hpp"
+
+struct Format {
+	const char* name;
+	int level;
+	const char* text;
+};
+
+#define WIFI_LOG_TABLE(name, level, format) {#name, level, format},
+static const Format formats[] = {WIFI_LOG_FORMATS(WIFI_LOG_TABLE)};
+#undef WIFI_LOG_TABLE
+
+static const char levels[] = "?EWID";
+
+static int decode(FILE* in) {
+	WiFiLog::Header header;
+	if (fread(&header, sizeof(header), 1, in) != 1 || header.magic != WiFiLog::magic) {
+		fprintf(stderr, "not a WiFiLog dump\n");
+		return 1;
+	}
+	if (header.version != WiFiLog::version || header.entry_size != sizeof(WiFiLog::Entry)) {
+		fprintf(stderr, "dump version %u, entry size %u; this decoder reads version %u\n", header.version,
+			   header.entry_size, WiFiLog::version);
+		return 1;
+	}
+	if (header.table_hash != WiFiLog::table_hash()) {
+		fprintf(stderr, "format table %08x differs from this decoder's %08x, rebuild it from the firmware's sources\n",
+			   header.table_hash, WiFiLog::table_hash());
+		return 1;
+	}
+
+	WiFiLog::Entry e;
+	uint32_t expected = 0, shown = 0;
+	bool first	   = true;
+	while (fread(&e, sizeof(e), 1, in) == 1) {
+		if (!first && e.index != expected) printf("... %u entries lost\n", e.index - expected);
+		first	   = false;
+		expected = e.index + 1;
+		shown++;
+
+		int level = e.level < sizeof(levels) - 1 ? e.level : 0;
+		printf("%c (%10.3f) ", levels[level], e.time_us / 1000.0);
+		if (e.id >= sizeof(formats) / sizeof(formats[0])) {
+			printf("unknown message %u\n", e.id);
+			continue;
+		}
+		const int32_t* a = e.args;
+		// Formats only hold int conversions; unused arguments are ignored
+		printf(formats[e.id].text, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+		printf("\n");
+	}
+	printf("%u of %u entries\n", shown, header.written);
+	return 0;
+}
+
+static int append(const void* data, size_t len, void* arg) {
+	std::vector<uint8_t>* out = static_cast<std::vector<uint8_t>*>(arg);
+	const uint8_t* p		 = static_cast<const uint8_t*>(data);
+	out->insert(out->end(), p, p + len);
+	return 0;
+}
+
+static int demo() {
+	const uint8_t bssid[6] = {0x24, 0x0a, 0xc4, 0x01, 0x02, 0x03};
+	WIFI_LOG(StaStarting);
+	WIFI_LOG(ScanWidened, 3);
+	WIFI_LOG(Associated, bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5], 6, -58);
+	WIFI_LOG(GotIp, 192, 168, 1, 23);
+	WIFI_LOG(Connected, 0x1234abcd, 6);
+	WIFI_LOG(BringUpReady, 412);
+
+	std::vector<uint8_t> dump;
+	WiFiLog::dump(append, &dump);
+	FILE* in = fmemopen(dump.data(), dump.size(), "rb");
+	int err  = decode(in);
+	fclose(in);
+	return err;
+}
+
+int main(int argc, char** argv) {
+	if (argc == 2 && strcmp(argv[1], "demo") == 0) return demo();
+	if (argc == 2) {
+		FILE* in = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+		if (!in) {
+			perror(argv[1]);
+			return 1;
+		}
+		return decode(in);
+	}
+	fprintf(stderr, "usage: %s <dump>|-|demo\n", argv[0]);
+	return 2;
+}
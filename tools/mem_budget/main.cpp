@@ -0,0 +1,124 @@
+/*
+ * Memory budget check of the phases that run on the host: every allocation
+ * goes through the MemProfile hook below, the QR texts the device encodes are
+ * encoded, and the exit status is 1 when a phase peaked above its budget.
+ *
+ *   mem_budget [qr_budget_bytes]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cstddef>
+#include <new>
+#include <random>
+#include <string>
+
+#include "memProfile.hpp"
+#include "qrcodegen.hpp"
+
+using qrcodegen::QrCode;
+
+// Each block carries its size in front so that delete can report it
+static const size_t header = alignof(std::max_align_t);
+
+static void* allocate(size_t bytes) {
+	void* block = malloc(header + bytes);
+	if (!block) return nullptr;
+	*static_cast<size_t*>(block) = bytes;
+	MemProfile::on_alloc(bytes);
+	return static_cast<char*>(block) + header;
+}
+
+static void release(void* p) {
+	if (!p) return;
+	void* block = static_cast<char*>(p) - header;
+	MemProfile::on_free(*static_cast<size_t*>(block));
+	free(block);
+}
+
+void* operator new(size_t bytes) {
+	void* p = allocate(bytes);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+void* operator new[](size_t bytes) {
+	return operator new(bytes);
+}
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept {
+	return allocate(bytes);
+}
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept {
+	return allocate(bytes);
+}
+void operator delete(void* p) noexcept {
+	release(p);
+}
+void operator delete[](void* p) noexcept {
+	release(p);
+}
+void operator delete(void* p, size_t) noexcept {
+	release(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+	release(p);
+}
+
+static int print(const void* data, size_t len, void*) {
+	return fwrite(data, 1, len, stdout) == len ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+	if (argc > 1) {
+		char* end;
+		unsigned long budget = strtoul(argv[1], &end, 0);
+		if (*end) {
+			fprintf(stderr, "usage: %s [qr_budget_bytes]\n", argv[0]);
+			return 2;
+		}
+		MemProfile::set_budget(MemProfile::Phase::QrEncode, static_cast<uint32_t>(budget));
+	}
+
+	// What the device encodes: nothing, a DPP URI and the longest text that fits
+	std::string texts[] = {
+	    "",
+	    "DPP:C:81/6;M:24:0a:c4:00:00:01;K:MDkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDIgADJoeKKbJhp+PP9oktUc1Jbsk4K6WOPD7cuUV5XHn1Qtg=;;",
+	    std::string(134, 'x'),
+	};
+	std::mt19937 rng(1);
+
+	MemProfile::enable(true);
+	for (const std::string& text : texts) {
+		if (!QrCode::fits(text.c_str())) {
+			fprintf(stderr, "text of %zu bytes does not fit\n", text.size());
+			return 2;
+		}
+		QrCode qr = QrCode::encodeText(text.c_str());
+		(void)qr;
+	}
+	for (int i = 0; i < 100; i++) {
+		std::string text(rng() % 135, ' ');
+		for (char& c : text) c = static_cast<char>(' ' + rng() % 95);
+		QrCode qr = QrCode::encodeText(text.c_str());
+		(void)qr;
+	}
+	MemProfile::enable(false);
+
+	MemProfile::report(print, nullptr);
+
+	MemProfile::Record qr = MemProfile::get(MemProfile::Phase::QrEncode);
+	if (qr.allocations == 0) {
+		printf("FAIL: the allocator hook saw nothing\n");
+		return 1;
+	}
+	if (!MemProfile::within_budget()) {
+		for (int i = 0; i < MemProfile::phases; i++) {
+			MemProfile::Record r = MemProfile::get(static_cast<MemProfile::Phase>(i));
+			if (r.over_budget)
+				printf("FAIL: %s peaked at %u bytes, budget %u\n", MemProfile::name(static_cast<MemProfile::Phase>(i)), r.peak_bytes, r.budget);
+		}
+		return 1;
+	}
+	printf("within budget\n");
+	return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * Checks PcapFormat on synthetic 802.11 frames: each frame's class, then a
+ * pcap of the frames in PcapFormat::connect written as WiFiCapture does and
+ * parsed back. The file opens in Wireshark. Exits with 1 on a mismatch.
+ *
+ *   pcap_synth [out.pcap] [snaplen]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "pcapFormat.hpp"
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Sample {
+	const char* name;
+	Bytes frame;
+	uint32_t expected;
+};
+
+static const uint8_t ap[]  = {0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01};
+static const uint8_t sta[] = {0x24, 0x0a, 0xc4, 0x00, 0x00, 0x02};
+
+// Frame control, duration, three addresses and sequence control
+static Bytes header(uint8_t fc0, uint8_t fc1) {
+	Bytes f = {fc0, fc1, 0, 0};
+	f.insert(f.end(), sta, sta + 6);
+	f.insert(f.end(), ap, ap + 6);
+	f.insert(f.end(), ap, ap + 6);
+	f.push_back(0x10);
+	f.push_back(0x00);
+	return f;
+}
+
+static Bytes frame(Bytes head, const Bytes& body) {
+	head.insert(head.end(), body.begin(), body.end());
+	return head;
+}
+
+static const Bytes snap_eapol = {0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00, 0x88, 0x8e, 0x02, 0x03, 0x00, 0x5f};
+
+static uint32_t get32(const uint8_t* p) {
+	return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+static int write_file(const char* path, const std::vector<Sample>& samples, uint32_t snaplen, size_t& records) {
+	FILE* out = fopen(path, "wb");
+	if (!out) {
+		perror(path);
+		return -1;
+	}
+	uint8_t buf[PcapFormat::record_header_size];
+	fwrite(buf, 1, PcapFormat::file_header(buf, snaplen), out);
+
+	records = 0;
+	for (const Sample& s : samples) {
+		if (!(PcapFormat::classify(s.frame.data(), s.frame.size()) & PcapFormat::connect)) continue;
+		// Alternate HT and legacy radio headers
+		PcapFormat::Radio radio = {};
+		radio.time_us		    = 1700000000ULL * 1000000 + records * 1500;
+		radio.rssi		    = static_cast<int8_t>(-40 - static_cast<int>(records));
+		radio.channel	    = 6;
+		radio.ht		    = records % 2;
+		radio.rate		    = radio.ht ? 0 : 12;
+		radio.mcs		    = 7;
+		radio.ht40		    = false;
+		radio.short_gi	    = true;
+		size_t captured	    = s.frame.size() < snaplen ? s.frame.size() : snaplen;
+		fwrite(buf, 1, PcapFormat::record_header(buf, radio, captured, s.frame.size()), out);
+		fwrite(s.frame.data(), 1, captured, out);
+		records++;
+	}
+	return fclose(out);
+}
+
+static bool read_back(const char* path, const std::vector<Sample>& samples, uint32_t snaplen, size_t records) {
+	FILE* in = fopen(path, "rb");
+	if (!in) return false;
+	Bytes file;
+	uint8_t chunk[4096];
+	for (size_t n; (n = fread(chunk, 1, sizeof(chunk), in)) > 0;) file.insert(file.end(), chunk, chunk + n);
+	fclose(in);
+
+	if (file.size() < PcapFormat::file_header_size || get32(&file[0]) != PcapFormat::magic || get32(&file[20]) != PcapFormat::linktype_radiotap ||
+	    get32(&file[16]) != snaplen + PcapFormat::radiotap_size) {
+		printf("bad file header\n");
+		return false;
+	}
+
+	size_t pos = PcapFormat::file_header_size, count = 0;
+	for (const Sample& s : samples) {
+		if (!(PcapFormat::classify(s.frame.data(), s.frame.size()) & PcapFormat::connect)) continue;
+		if (pos + 16 + PcapFormat::radiotap_size > file.size()) break;
+		uint32_t incl = get32(&file[pos + 8]), orig = get32(&file[pos + 12]);
+		const uint8_t* rt = &file[pos + 16];
+		size_t rt_len	   = rt[2] | rt[3] << 8;
+		size_t captured   = s.frame.size() < snaplen ? s.frame.size() : snaplen;
+		if (rt[0] != 0 || rt_len != PcapFormat::radiotap_size || orig != s.frame.size() + rt_len || incl != captured + rt_len ||
+		    memcmp(rt + rt_len, s.frame.data(), captured) != 0 || static_cast<int8_t>(rt[22]) != -40 - static_cast<int>(count)) {
+			printf("record %zu (%s) differs\n", count, s.name);
+			return false;
+		}
+		pos += 16 + incl;
+		count++;
+	}
+	if (count != records || pos != file.size()) {
+		printf("%zu of %zu records read, %zu trailing bytes\n", count, records, file.size() - pos);
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	const char* path = argc > 1 ? argv[1] : "pcap_synth.pcap";
+	uint32_t snaplen = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 64;
+	if (snaplen == 0) {
+		fprintf(stderr, "usage: %s [out.pcap] [snaplen]\n", argv[0]);
+		return 2;
+	}
+
+	Bytes qos_eapol = header(0x88, 0x02);
+	qos_eapol.push_back(0x06);
+	qos_eapol.push_back(0x00);
+	// Four addresses, QoS control and HT control (order bit)
+	Bytes wds_eapol = header(0x88, 0x83);
+	wds_eapol.insert(wds_eapol.end(), ap, ap + 6);
+	wds_eapol.insert(wds_eapol.end(), {0x06, 0x00, 0, 0, 0, 0});
+
+	const std::vector<Sample> samples = {
+	    {"beacon", frame(header(0x80, 0), Bytes(60, 0x11)), PcapFormat::beacon},
+	    {"probe request", frame(header(0x40, 0), Bytes(30, 0x22)), PcapFormat::probe},
+	    {"probe response", frame(header(0x50, 0), Bytes(120, 0x23)), PcapFormat::probe},
+	    {"authentication", frame(header(0xb0, 0), {0, 0, 1, 0, 0, 0}), PcapFormat::auth},
+	    {"association request", frame(header(0x00, 0), Bytes(40, 0x33)), PcapFormat::assoc},
+	    {"association response", frame(header(0x10, 0), Bytes(80, 0x34)), PcapFormat::assoc},
+	    {"reassociation request", frame(header(0x20, 0), Bytes(50, 0x35)), PcapFormat::assoc},
+	    {"deauthentication", frame(header(0xc0, 0), {0x0f, 0x00}), PcapFormat::deauth},
+	    {"disassociation", frame(header(0xa0, 0), {0x08, 0x00}), PcapFormat::deauth},
+	    {"block ack action", frame(header(0xd0, 0), {0x03, 0x00, 0x01}), PcapFormat::action},
+	    {"DPP authentication", frame(header(0xd0, 0), {0x04, 0x09, 0x50, 0x6f, 0x9a, 0x1a, 0x01, 0x00, 0x55}), PcapFormat::dpp},
+	    {"GAS initial request", frame(header(0xd0, 0), {0x04, 0x0a, 0x01, 0x6c, 0x08}), PcapFormat::dpp},
+	    {"EAPOL key", frame(header(0x08, 0x02), snap_eapol), PcapFormat::eapol},
+	    {"QoS EAPOL key", frame(qos_eapol, snap_eapol), PcapFormat::eapol},
+	    {"WDS QoS+HTC EAPOL key", frame(wds_eapol, snap_eapol), PcapFormat::eapol},
+	    {"protected data", frame(header(0x08, 0x42), snap_eapol), PcapFormat::data},
+	    {"IPv4 data", frame(header(0x08, 0x01), {0xaa, 0xaa, 0x03, 0, 0, 0, 0x08, 0x00, 0x45}), PcapFormat::data},
+	    {"ACK", {0xd4, 0x00, 0x00, 0x00, 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x02}, PcapFormat::control},
+	    {"truncated header", {0x80, 0x00, 0x00}, 0},
+	};
+
+	bool ok = true;
+	for (const Sample& s : samples) {
+		uint32_t kind = PcapFormat::classify(s.frame.data(), s.frame.size());
+		bool match	  = kind == s.expected;
+		printf("%-24s class 0x%03x%s\n", s.name, kind, match ? "" : "  MISMATCH");
+		ok &= match;
+	}
+
+	size_t records = 0;
+	if (write_file(path, samples, snaplen, records) != 0) return 1;
+	bool read_ok = read_back(path, samples, snaplen, records);
+	printf("\n%zu records, snap length %u, written to %s%s\n", records, snaplen, path, read_ok ? "" : ", read back FAILED");
+	ok &= read_ok;
+	printf("%s\n", ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+/*
+ * Loopback check of WiFiQos marking: datagrams from sockets of each access
+ * category, registered directly or by a port rule, are received on
+ * 127.0.0.1 with IP_RECVTOS and their TOS byte compared with the category's
+ * DSCP. Prints the per-category counters; exits with 1 on a mismatch.
+ *
+ *   qos_check [packets per category]
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "wifiQos.hpp"
+
+typedef WiFiQos::AccessCategory Ac;
+
+static const Ac all[] = {Ac::Background, Ac::BestEffort, Ac::Video, Ac::Voice};
+
+static int udp_socket(uint16_t port) {
+	int sock = socket(AF_INET, SOCK_DGRAM, 0);
+	sockaddr_in addr	   = {};
+	addr.sin_family	   = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port	   = htons(port);
+	if (sock < 0 || bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+		perror("udp socket");
+		exit(2);
+	}
+	return sock;
+}
+
+static uint16_t local_port(int sock) {
+	sockaddr_in addr = {};
+	socklen_t len	   = sizeof(addr);
+	getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &len);
+	return ntohs(addr.sin_port);
+}
+
+// TOS byte of the next datagram, -1 when none arrives
+static int receive_tos(int sock) {
+	char data[64];
+	char control[64];
+	iovec iov	  = {data, sizeof(data)};
+	msghdr msg	  = {};
+	msg.msg_iov	  = &iov;
+	msg.msg_iovlen	  = 1;
+	msg.msg_control	  = control;
+	msg.msg_controllen = sizeof(control);
+	if (recvmsg(sock, &msg, 0) < 0) return -1;
+	for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+		if (c->cmsg_level == IPPROTO_IP && c->cmsg_type == IP_TOS) return *reinterpret_cast<uint8_t*>(CMSG_DATA(c));
+	}
+	return -1;
+}
+
+// Traffic class of the next datagram on an IPv6 socket, -1 when none arrives
+static int receive_tclass(int sock) {
+	char data[64];
+	char control[64];
+	iovec iov	  = {data, sizeof(data)};
+	msghdr msg	  = {};
+	msg.msg_iov	  = &iov;
+	msg.msg_iovlen	  = 1;
+	msg.msg_control	  = control;
+	msg.msg_controllen = sizeof(control);
+	if (recvmsg(sock, &msg, 0) < 0) return -1;
+	for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+		if (c->cmsg_level == IPPROTO_IPV6 && c->cmsg_type == IPV6_TCLASS) return *reinterpret_cast<int*>(CMSG_DATA(c));
+	}
+	return -1;
+}
+
+// IPv6 sockets are marked with the traffic class; skipped without an IPv6 loopback
+static bool check_ipv6() {
+	int receiver = socket(AF_INET6, SOCK_DGRAM, 0);
+	int sender   = socket(AF_INET6, SOCK_DGRAM, 0);
+	sockaddr_in6 addr = {};
+	addr.sin6_family  = AF_INET6;
+	addr.sin6_addr	  = in6addr_loopback;
+	if (receiver < 0 || sender < 0 || bind(receiver, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+		printf("%-26s skipped, no IPv6 loopback\n", "ipv6 voice");
+		if (receiver >= 0) close(receiver);
+		if (sender >= 0) close(sender);
+		return true;
+	}
+	int on = 1;
+	setsockopt(receiver, IPPROTO_IPV6, IPV6_RECVTCLASS, &on, sizeof(on));
+	timeval tv = {1, 0};
+	setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	socklen_t len = sizeof(addr);
+	getsockname(receiver, reinterpret_cast<sockaddr*>(&addr), &len);
+
+	bool ok = WiFiQos::add_socket(sender, Ac::Voice) == 0 &&
+		     WiFiQos::transmit_to(sender, "v6", 2, 0, reinterpret_cast<sockaddr*>(&addr), len) == 2;
+	int tclass = ok ? receive_tclass(receiver) : -1;
+	int want   = WiFiQos::dscp(Ac::Voice) << 2;
+	printf("%-26s tclass 0x%02x, expected 0x%02x%s\n", "ipv6 voice", tclass & 0xff, want, tclass == want ? "" : "  MISMATCH");
+	WiFiQos::remove_socket(sender);
+	close(sender);
+	close(receiver);
+	return tclass == want;
+}
+
+static bool check(const char* what, int sender, int receiver, Ac expected) {
+	sockaddr_in to = {};
+	socklen_t len  = sizeof(to);
+	getsockname(receiver, reinterpret_cast<sockaddr*>(&to), &len);
+	if (WiFiQos::transmit_to(sender, what, strlen(what), 0, reinterpret_cast<sockaddr*>(&to), len) < 0) {
+		perror(what);
+		return false;
+	}
+	int tos  = receive_tos(receiver);
+	int want = WiFiQos::dscp(expected) << 2;
+	printf("%-26s tos 0x%02x, expected 0x%02x (%s)%s\n", what, tos & 0xff, want, WiFiQos::name(expected), tos == want ? "" : "  MISMATCH");
+	return tos == want;
+}
+
+int main(int argc, char** argv) {
+	int packets = argc > 1 ? atoi(argv[1]) : 1000;
+	if (packets <= 0) {
+		fprintf(stderr, "usage: %s [packets per category]\n", argv[0]);
+		return 2;
+	}
+
+	int receiver = udp_socket(0);
+	int on	     = 1;
+	setsockopt(receiver, IPPROTO_IP, IP_RECVTOS, &on, sizeof(on));
+	timeval tv = {1, 0};
+	setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	bool ok = true;
+	int senders[4];
+	for (int i = 0; i < 4; i++) {
+		senders[i] = udp_socket(0);
+		if (WiFiQos::add_socket(senders[i], all[i]) != 0) {
+			perror("add_socket");
+			return 1;
+		}
+		char what[32];
+		snprintf(what, sizeof(what), "socket flow %s", WiFiQos::name(all[i]));
+		ok &= check(what, senders[i], receiver, all[i]);
+	}
+
+	// A port rule picks up the socket once apply() is called
+	int ruled = udp_socket(0);
+	uint16_t port = local_port(ruled);
+	WiFiQos::add_ports(port, port, Ac::Video);
+	WiFiQos::apply(ruled);
+	ok &= check("port rule video", ruled, receiver, Ac::Video);
+
+	int plain = udp_socket(0);
+	ok &= check("unregistered socket", plain, receiver, Ac::BestEffort);
+	ok &= check_ipv6();
+
+	// A removed flow is best effort again in the accounting
+	WiFiQos::remove_socket(ruled);
+	ok &= WiFiQos::category(ruled) == Ac::BestEffort;
+
+	WiFiQos::reset_stats();
+	sockaddr_in to = {};
+	socklen_t len  = sizeof(to);
+	getsockname(receiver, reinterpret_cast<sockaddr*>(&to), &len);
+	char payload[512] = {};
+	for (int n = 0; n < packets; n++) {
+		for (int i = 0; i < 4; i++) {
+			WiFiQos::transmit_to(senders[i], payload, sizeof(payload), 0, reinterpret_cast<sockaddr*>(&to), len);
+			char sink[512];
+			recv(receiver, sink, sizeof(sink), 0);
+		}
+	}
+
+	printf("\n%-12s %8s %10s %6s %8s %8s %8s %8s\n", "category", "packets", "bytes", "drops", "p50 us", "p90 us", "p99 us", "max us");
+	for (Ac ac : all) {
+		WiFiQos::Stats s = WiFiQos::get_stats(ac);
+		printf("%-12s %8u %10u %6u %8u %8u %8u %8u\n", WiFiQos::name(ac), s.packets, s.bytes, s.drops, s.delay_p50_us, s.delay_p90_us,
+			  s.delay_p99_us, s.delay_max_us);
+		ok &= s.packets == static_cast<uint32_t>(packets);
+	}
+
+	for (int sock : senders) close(sock);
+	close(ruled);
+	close(plain);
+	close(receiver);
+	printf("\n%s\n", ok ? "marking ok" : "FAIL");
+	return ok ? 0 : 1;
+}
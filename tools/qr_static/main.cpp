@@ -0,0 +1,129 @@
+/*
+ * Checks StaticQrCode against the runtime encoder.
+ *
+ * At compile time: the constexpr symbols below must hash to what
+ * QrCode::encodeText() produced for the same text (the build fails otherwise).
+ * At run time: both encoders on random texts of every length, module by module,
+ * and QrCode::encodeTexts() (the batch encoder of qrbatch) against encodeText().
+ *
+ *   qr_static [count]      Compare; exits 1 on the first mismatch
+ *   qr_static hash <text>  Prints the runtime encoder's hash, for a new static_assert
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "qrStatic.hpp"
+
+using qrcodegen::QrCode;
+using qrcodegen::StaticQrCode;
+
+static constexpr char setup_text[]	 = "WIFI:S:device-setup;T:nopass;;";
+static constexpr char support_text[] = "https://github.com/ixsiid/WiFiManager";
+static constexpr char longest_text[] =
+    "DPP:C:81/1,81/6,81/11;M:246f28000000;I:WM-0000000001;K:MDkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDIgACAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA;;";
+static_assert(sizeof(longest_text) - 1 == StaticQrCode::capacity, "longest_text should fill the symbol");
+
+static constexpr StaticQrCode empty	 = StaticQrCode::encode("");
+static constexpr StaticQrCode setup	 = StaticQrCode::encode(setup_text);
+static constexpr StaticQrCode support = StaticQrCode::encode(support_text);
+static constexpr StaticQrCode longest = StaticQrCode::encode(longest_text);
+
+// Hashes of QrCode::encodeText() for the texts above, from "qr_static hash"
+static_assert(empty.hash() == 0xc2cd8268u, "empty text differs from the runtime encoder");
+static_assert(setup.hash() == 0x11bc6628u, "setup text differs from the runtime encoder");
+static_assert(support.hash() == 0x5a713074u, "support text differs from the runtime encoder");
+static_assert(longest.hash() == 0x24c6fc50u, "longest text differs from the runtime encoder");
+
+static uint32_t runtime_hash(const QrCode& qr) {
+	uint32_t h = 2166136261u;
+	for (int y = 0; y < QrCode::size; y++) {
+		for (int x = 0; x < QrCode::size; x++) h = (h ^ (qr.getModule(x, y) ? 1u : 0u)) * 16777619u;
+	}
+	return (h ^ static_cast<uint32_t>(qr.getMask())) * 16777619u;
+}
+
+static bool same(const char* text, const StaticQrCode& s) {
+	QrCode qr = QrCode::encodeText(text);
+	if (qr.getMask() != s.getMask()) {
+		fprintf(stderr, "\"%s\": mask %d, static %d\n", text, qr.getMask(), s.getMask());
+		return false;
+	}
+	for (int y = 0; y < QrCode::size; y++) {
+		for (int x = 0; x < QrCode::size; x++) {
+			if (qr.getModule(x, y) != s.getModule(x, y)) {
+				fprintf(stderr, "\"%s\": module (%d, %d) differs\n", text, x, y);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// The batch encoder computes the ECC of all texts in one pass; every symbol must match its single encode
+static bool batch_same(const std::vector<std::string>& texts) {
+	std::vector<const char*> pointers;
+	for (const std::string& t : texts) pointers.push_back(t.c_str());
+	std::vector<QrCode> batch = QrCode::encodeTexts(pointers);
+	if (batch.size() != texts.size()) {
+		fprintf(stderr, "encodeTexts: %zu symbols for %zu texts\n", batch.size(), texts.size());
+		return false;
+	}
+	for (size_t i = 0; i < texts.size(); i++) {
+		QrCode qr = QrCode::encodeText(pointers[i]);
+		bool equal = qr.getMask() == batch[i].getMask();
+		for (int y = 0; equal && y < QrCode::size; y++) {
+			for (int x = 0; equal && x < QrCode::size; x++) equal = qr.getModule(x, y) == batch[i].getModule(x, y);
+		}
+		if (!equal) {
+			fprintf(stderr, "encodeTexts: text %zu of %zu (%zu bytes) differs from encodeText\n", i, texts.size(), texts[i].size());
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	if (argc == 3 && strcmp(argv[1], "hash") == 0) {
+		if (!QrCode::fits(argv[2])) {
+			fprintf(stderr, "too long, %d bytes at most\n", StaticQrCode::capacity);
+			return 1;
+		}
+		printf("0x%08xu\n", runtime_hash(QrCode::encodeText(argv[2])));
+		return 0;
+	}
+	int count = argc > 1 ? atoi(argv[1]) : 2000;
+
+	if (!same("", empty) || !same(setup_text, setup) || !same(support_text, support) || !same(longest_text, longest)) return 1;
+
+	// The constexpr functions run at run time as well, which covers far more texts than static_asserts can
+	std::mt19937 rng(1);
+	std::string text;
+	for (int n = 0; n < count; n++) {
+		int len = n % (StaticQrCode::capacity + 1);
+		text.clear();
+		for (int i = 0; i < len; i++) text += static_cast<char>(1 + rng() % 255);
+		if (!same(text.c_str(), StaticQrCode::encode(text.c_str(), text.size()))) return 1;
+	}
+
+	// Batches of every size up to 64, so that the vector kernel's tail lanes are covered too
+	int batched = 0;
+	std::vector<std::string> batch;
+	for (int size = 1; size <= 64; size++) {
+		batch.clear();
+		for (int i = 0; i < size; i++) {
+			int len = static_cast<int>(rng() % (StaticQrCode::capacity + 1));
+			text.clear();
+			for (int j = 0; j < len; j++) text += static_cast<char>(1 + rng() % 255);
+			batch.push_back(text);
+		}
+		if (!batch_same(batch)) return 1;
+		batched += size;
+	}
+	printf("%d texts, static and runtime encoders agree; %d texts, batch and single encoders agree\n", count + 4, batched);
+	return 0;
+}
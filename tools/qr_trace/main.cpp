@@ -0,0 +1,61 @@
+/*
+ * Host harness of the trace: encodes QR codes on a few threads with the
+ * component's trace points compiled in and writes the timeline as Chrome
+ * Trace Event JSON, to open in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ *   qr_trace [out.json] [threads] [codes per thread]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "qrcodegen.hpp"
+#include "wifiTrace.hpp"
+
+using qrcodegen::QrCode;
+
+static_assert(WIFI_TRACE, "build with CONFIG_WIFI_MANAGER_TRACE");
+
+static int write_file(const void* data, size_t len, void* file) {
+	return fwrite(data, 1, len, static_cast<FILE*>(file)) == len ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+	const char* path = argc > 1 ? argv[1] : "trace.json";
+	int threads	     = argc > 2 ? atoi(argv[2]) : 4;
+	int codes	     = argc > 3 ? atoi(argv[3]) : 8;
+	if (threads <= 0 || codes <= 0) {
+		fprintf(stderr, "usage: %s [out.json] [threads] [codes per thread]\n", argv[0]);
+		return 2;
+	}
+
+	WIFI_TRACE_BEGIN("run", threads);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++) {
+		workers.emplace_back([t, codes]() {
+			for (int i = 0; i < codes; i++) {
+				std::string text = "DPP:C:81/6;M:24:0a:c4:00:" + std::to_string(t) + ":" + std::to_string(i) + ";;";
+				QrCode qr		  = QrCode::encodeText(text.c_str());
+				(void)qr;
+			}
+		});
+	}
+	for (std::thread& worker : workers) worker.join();
+	WIFI_TRACE_END("run");
+
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		perror(path);
+		return 1;
+	}
+	int err = WiFiTrace::dump_json(write_file, file);
+	if (fclose(file) || err) {
+		fprintf(stderr, "writing %s failed\n", path);
+		return 1;
+	}
+	printf("%u events, %u dropped, written to %s\n", WiFiTrace::recorded(), WiFiTrace::dropped(), path);
+	return 0;
+}
@@ -0,0 +1,703 @@
+/*
+ * Batch QR label generator for end-of-line printing, built on the
+ * component's own qrcodegen.cpp so that a label is the device's QR code
+ * module for module.
+ *
+ *   qrbatch [options] <input.csv|input.jsonl|->
+ *     -f pbm|png|svg   One file per record into the directory given with -o (default)
+ *     -f pdf|zip       One stream, a page / a PNG member per record, into the file given with -o ("-" for stdout)
+ *     -o <path>        Output directory or file (default "labels" / "labels.pdf" / "labels.zip")
+ *     -j <threads>     Worker threads (default: hardware threads)
+ *     -s <scale>       Pixels per module for PBM and PNG (default 4)
+ *     -m <mm>          PDF label edge including the quiet zone (default 25)
+ *
+ * CSV: the "uri" column (or the first one) and an optional "id" column; a
+ * header row is recognized by those names. JSONL: {"uri": ..., "id": ...}.
+ * Records without an id are numbered in input order.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "qrcodegen.hpp"
+
+using qrcodegen::QrCode;
+
+static const int quiet_zone = 4;  // Modules of light border the standard asks for
+static const int label_size = QrCode::size + 2 * quiet_zone;
+
+struct Record {
+	std::string id;
+	std::string uri;
+};
+
+struct Label {
+	bool ok;
+	std::vector<uint8_t> modules;  // size * size, 1 = dark
+	std::string bytes;		  // Rendered output for the stream formats
+};
+
+enum class Format { Pbm, Png, Svg, Pdf, Zip };
+
+struct Options {
+	Format format = Format::Pbm;
+	const char* output = nullptr;
+	const char* input  = nullptr;
+	int threads	   = 0;
+	int scale	   = 4;
+	double label_mm = 25;
+};
+
+/* ---- Input ---- */
+
+static bool read_all(const char* path, std::string& out) {
+	FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+	if (!f) return false;
+	char buf[65536];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+	if (f != stdin) fclose(f);
+	return true;
+}
+
+// RFC 4180 fields of one line; quotes may span line breaks
+static bool csv_row(const std::string& text, size_t& pos, std::vector<std::string>& fields) {
+	fields.clear();
+	if (pos >= text.size()) return false;
+	std::string field;
+	bool quoted = false;
+	for (; pos < text.size(); pos++) {
+		char c = text[pos];
+		if (quoted) {
+			if (c == '"' && pos + 1 < text.size() && text[pos + 1] == '"') {
+				field += '"';
+				pos++;
+			} else if (c == '"') {
+				quoted = false;
+			} else {
+				field += c;
+			}
+		} else if (c == '"') {
+			quoted = true;
+		} else if (c == ',') {
+			fields.push_back(field);
+			field.clear();
+		} else if (c == '\n') {
+			pos++;
+			break;
+		} else if (c != '\r') {
+			field += c;
+		}
+	}
+	fields.push_back(field);
+	return true;
+}
+
+// Value of a string member of a flat JSON object, false when absent
+static bool json_string(const std::string& line, const char* key, std::string& out) {
+	std::string pattern = std::string("\"") + key + "\"";
+	size_t p		    = line.find(pattern);
+	if (p == std::string::npos) return false;
+	p = line.find(':', p + pattern.size());
+	if (p == std::string::npos) return false;
+	p = line.find('"', p);
+	if (p == std::string::npos) return false;
+
+	out.clear();
+	for (p++; p < line.size() && line[p] != '"'; p++) {
+		char c = line[p];
+		if (c != '\\' || p + 1 >= line.size()) {
+			out += c;
+			continue;
+		}
+		c = line[++p];
+		switch (c) {
+			case 'n': out += '\n'; break;
+			case 't': out += '\t'; break;
+			case 'r': out += '\r'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'u': {
+				// Labels are ASCII in practice; anything else becomes UTF-8 of the BMP code point
+				unsigned cp = static_cast<unsigned>(strtoul(line.substr(p + 1, 4).c_str(), nullptr, 16));
+				p += 4;
+				if (cp < 0x80) {
+					out += static_cast<char>(cp);
+				} else if (cp < 0x800) {
+					out += static_cast<char>(0xc0 | cp >> 6);
+					out += static_cast<char>(0x80 | (cp & 0x3f));
+				} else {
+					out += static_cast<char>(0xe0 | cp >> 12);
+					out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+					out += static_cast<char>(0x80 | (cp & 0x3f));
+				}
+				break;
+			}
+			default: out += c; break;  // \" \\ \/
+		}
+	}
+	return p < line.size();
+}
+
+static bool parse_input(const std::string& text, std::vector<Record>& records) {
+	size_t first = text.find_first_not_of(" \t\r\n");
+	if (first == std::string::npos) return true;
+
+	if (text[first] == '{') {
+		size_t pos = 0;
+		while (pos < text.size()) {
+			size_t end = text.find('\n', pos);
+			if (end == std::string::npos) end = text.size();
+			std::string line = text.substr(pos, end - pos);
+			pos		    = end + 1;
+			if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+			Record r;
+			if (!json_string(line, "uri", r.uri)) {
+				fprintf(stderr, "line %zu: no \"uri\"\n", records.size() + 1);
+				return false;
+			}
+			json_string(line, "id", r.id);
+			records.push_back(r);
+		}
+		return true;
+	}
+
+	size_t pos = 0;
+	int uri_col = 0, id_col = -1;
+	std::vector<std::string> fields;
+	bool header = true;
+	while (csv_row(text, pos, fields)) {
+		if (header) {
+			header = false;
+			auto uri = std::find(fields.begin(), fields.end(), "uri");
+			auto id  = std::find(fields.begin(), fields.end(), "id");
+			if (uri != fields.end() || id != fields.end()) {
+				uri_col = uri != fields.end() ? static_cast<int>(uri - fields.begin()) : 0;
+				id_col  = id != fields.end() ? static_cast<int>(id - fields.begin()) : -1;
+				continue;
+			}
+		}
+		if (fields.size() == 1 && fields[0].empty()) continue;
+		if (uri_col >= static_cast<int>(fields.size())) {
+			fprintf(stderr, "record %zu: no uri column\n", records.size() + 1);
+			return false;
+		}
+		Record r;
+		r.uri = fields[uri_col];
+		if (id_col >= 0 && id_col < static_cast<int>(fields.size())) r.id = fields[id_col];
+		records.push_back(r);
+	}
+	return true;
+}
+
+/* ---- Work-stealing pool ---- */
+
+// Each worker pops chunks from the back of its own deque and steals from the
+// front of the others' once it runs dry; nothing is added after the start.
+// fn(begin, end) gets a whole chunk, so that it can encode it as one batch.
+class StealingPool {
+    public:
+	static const size_t grain = 32;  // Records per chunk
+
+	template <typename F>
+	static uint64_t run(size_t count, int threads, F fn) {
+		std::vector<Queue> queues(threads);
+		size_t chunks = (count + grain - 1) / grain;
+		// Contiguous shares keep each worker's output files apart on disk
+		for (size_t c = 0; c < chunks; c++) queues[c * threads / chunks].chunks.push_back(c);
+
+		std::atomic<uint64_t> steals(0);
+		std::vector<std::thread> workers;
+		for (int w = 0; w < threads; w++) {
+			workers.emplace_back([&, w]() {
+				size_t chunk;
+				while (pop(queues[w], chunk) || steal(queues, w, chunk, steals)) {
+					fn(chunk * grain, std::min(count, (chunk + 1) * grain));
+				}
+			});
+		}
+		for (std::thread& t : workers) t.join();
+		return steals;
+	}
+
+    private:
+	struct Queue {
+		std::mutex lock;
+		std::deque<size_t> chunks;
+	};
+
+	static bool pop(Queue& q, size_t& chunk) {
+		std::lock_guard<std::mutex> guard(q.lock);
+		if (q.chunks.empty()) return false;
+		chunk = q.chunks.back();
+		q.chunks.pop_back();
+		return true;
+	}
+
+	static bool steal(std::vector<Queue>& queues, int self, size_t& chunk, std::atomic<uint64_t>& steals) {
+		int n = static_cast<int>(queues.size());
+		for (int i = 1; i < n; i++) {
+			Queue& victim = queues[(self + i) % n];
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if (victim.chunks.empty()) continue;
+			chunk = victim.chunks.front();
+			victim.chunks.pop_front();
+			steals++;
+			return true;
+		}
+		return false;
+	}
+};
+
+/* ---- Checksums ---- */
+
+static uint32_t crc32_table[256];
+
+static void crc32_init() {
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t c = i;
+		for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0xedb88320 & -(c & 1));
+		crc32_table[i] = c;
+	}
+}
+
+static uint32_t crc32(const void* data, size_t len, uint32_t crc = 0) {
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	crc		    = ~crc;
+	while (len--) crc = crc32_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static uint32_t adler32(const std::string& data) {
+	uint32_t a = 1, b = 0;
+	for (unsigned char c : data) {
+		a = (a + c) % 65521;
+		b = (b + a) % 65521;
+	}
+	return b << 16 | a;
+}
+
+static void put_be32(std::string& out, uint32_t v) {
+	out += static_cast<char>(v >> 24);
+	out += static_cast<char>(v >> 16);
+	out += static_cast<char>(v >> 8);
+	out += static_cast<char>(v);
+}
+
+static void put_le16(std::string& out, uint32_t v) {
+	out += static_cast<char>(v);
+	out += static_cast<char>(v >> 8);
+}
+
+static void put_le32(std::string& out, uint32_t v) {
+	put_le16(out, v & 0xffff);
+	put_le16(out, v >> 16);
+}
+
+/* ---- Renderers ---- */
+
+static bool dark(const Label& label, int x, int y) {
+	x -= quiet_zone;
+	y -= quiet_zone;
+	if (x < 0 || y < 0 || x >= QrCode::size || y >= QrCode::size) return false;
+	return label.modules[y * QrCode::size + x];
+}
+
+// 1 bit per pixel rows, MSB first, 1 = black; shared by PBM (P4) and PNG
+static std::vector<std::string> bitmap_rows(const Label& label, int scale) {
+	int pixels = label_size * scale;
+	std::vector<std::string> rows;
+	for (int y = 0; y < label_size; y++) {
+		std::string row((pixels + 7) / 8, '\0');
+		for (int px = 0; px < pixels; px++) {
+			if (dark(label, px / scale, y)) row[px / 8] |= static_cast<char>(0x80 >> (px % 8));
+		}
+		for (int i = 0; i < scale; i++) rows.push_back(row);
+	}
+	return rows;
+}
+
+static std::string render_pbm(const Label& label, int scale) {
+	int pixels	    = label_size * scale;
+	std::string out = "P4\n" + std::to_string(pixels) + " " + std::to_string(pixels) + "\n";
+	for (const std::string& row : bitmap_rows(label, scale)) out += row;
+	return out;
+}
+
+static void png_chunk(std::string& out, const char* type, const std::string& data) {
+	put_be32(out, static_cast<uint32_t>(data.size()));
+	std::string body = std::string(type, 4) + data;
+	out += body;
+	put_be32(out, crc32(body.data(), body.size()));
+}
+
+// Grayscale, 1 bit; the zlib stream uses stored blocks, so no compressor is needed
+static std::string render_png(const Label& label, int scale) {
+	uint32_t pixels = label_size * scale;
+	std::string raw;
+	for (const std::string& row : bitmap_rows(label, scale)) {
+		raw += '\0';  // Filter type None
+		for (char c : row) raw += static_cast<char>(~c);  // PNG gray: 0 is black
+	}
+
+	std::string zlib = "\x78\x01";
+	for (size_t pos = 0; pos < raw.size() || pos == 0; pos += 65535) {
+		size_t n = std::min<size_t>(65535, raw.size() - pos);
+		zlib += static_cast<char>(pos + n >= raw.size() ? 1 : 0);
+		put_le16(zlib, static_cast<uint32_t>(n));
+		put_le16(zlib, static_cast<uint32_t>(~n & 0xffff));
+		zlib.append(raw, pos, n);
+	}
+	put_be32(zlib, adler32(raw));
+
+	std::string ihdr;
+	put_be32(ihdr, pixels);
+	put_be32(ihdr, pixels);
+	ihdr += std::string("\x01\x00\x00\x00\x00", 5);  // Depth 1, grayscale, deflate, no filter, no interlace
+
+	std::string out = "\x89PNG\r\n\x1a\n";
+	png_chunk(out, "IHDR", ihdr);
+	png_chunk(out, "IDAT", zlib);
+	png_chunk(out, "IEND", "");
+	return out;
+}
+
+// One path of horizontal runs, in module units; the viewer scales it
+static std::string render_svg(const Label& label) {
+	std::string n	    = std::to_string(label_size);
+	std::string out = "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 " + n + " " + n +
+				   "\" shape-rendering=\"crispEdges\"><rect width=\"100%\" height=\"100%\" fill=\"#fff\"/><path d=\"";
+	for (int y = 0; y < label_size; y++) {
+		for (int x = 0; x < label_size; x++) {
+			if (!dark(label, x, y)) continue;
+			int run = 1;
+			while (dark(label, x + run, y)) run++;
+			out += "M" + std::to_string(x) + "," + std::to_string(y) + "h" + std::to_string(run) + "v1h-" + std::to_string(run) + "z";
+			x += run;
+		}
+	}
+	out += "\"/></svg>\n";
+	return out;
+}
+
+static std::string pdf_number(double v) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.3f", v);
+	return buf;
+}
+
+static std::string pdf_escape(const std::string& s) {
+	std::string out;
+	for (char c : s) {
+		if (c == '(' || c == ')' || c == '\\') out += '\\';
+		out += c;
+	}
+	return out;
+}
+
+// Content stream of one page: runs of modules as filled rectangles, the id below
+static std::string render_pdf_page(const Label& label, const std::string& id, double edge_pt, double caption_pt) {
+	double module = edge_pt / label_size;
+	std::string out = "0 g\n";
+	for (int y = 0; y < label_size; y++) {
+		for (int x = 0; x < label_size; x++) {
+			if (!dark(label, x, y)) continue;
+			int run = 1;
+			while (dark(label, x + run, y)) run++;
+			// PDF's origin is bottom left
+			out += pdf_number(x * module) + " " + pdf_number(caption_pt + (label_size - 1 - y) * module) + " " +
+				  pdf_number(run * module) + " " + pdf_number(module) + " re\n";
+			x += run;
+		}
+	}
+	out += "f\n";
+	out += "BT /F1 6 Tf " + pdf_number(quiet_zone * module) + " 3 Td (" + pdf_escape(id) + ") Tj ET\n";
+	return out;
+}
+
+/* ---- Streams ---- */
+
+static bool write_file(const std::string& path, const std::string& data) {
+	FILE* f = fopen(path.c_str(), "wb");
+	if (!f) return false;
+	bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+	return fclose(f) == 0 && ok;
+}
+
+class Output {
+    public:
+	explicit Output(const char* path) : file(strcmp(path, "-") == 0 ? stdout : fopen(path, "wb")), offset(0) {}
+	~Output() {
+		if (file && file != stdout) fclose(file);
+	}
+	bool ok() const { return file != nullptr && !failed; }
+	void write(const std::string& data) {
+		if (fwrite(data.data(), 1, data.size(), file) != data.size()) failed = true;
+		offset += data.size();
+	}
+	size_t position() const { return offset; }
+
+    private:
+	FILE* file;
+	size_t offset;
+	bool failed = false;
+};
+
+static bool write_pdf(Output& out, const std::vector<Label>& labels, double width_pt, double height_pt) {
+	// Objects: 1 catalog, 2 page tree, 3 font, then a page and its content per label
+	std::vector<size_t> offsets(4, 0);
+	std::vector<size_t> pages;
+	for (size_t i = 0; i < labels.size(); i++) {
+		if (labels[i].ok) pages.push_back(i);
+	}
+
+	out.write("%PDF-1.4\n%\xe2\xe3\xcf\xd3\n");
+	offsets[1] = out.position();
+	out.write("1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+	offsets[2] = out.position();
+	std::string kids;
+	for (size_t p = 0; p < pages.size(); p++) kids += std::to_string(4 + 2 * p) + " 0 R ";
+	out.write("2 0 obj\n<< /Type /Pages /Count " + std::to_string(pages.size()) + " /Kids [" + kids + "] >>\nendobj\n");
+	offsets[3] = out.position();
+	out.write("3 0 obj\n<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica >>\nendobj\n");
+
+	std::string media_box = "[0 0 " + pdf_number(width_pt) + " " + pdf_number(height_pt) + "]";
+	for (size_t p = 0; p < pages.size(); p++) {
+		const std::string& content = labels[pages[p]].bytes;
+		size_t page			   = 4 + 2 * p;
+		offsets.push_back(out.position());
+		out.write(std::to_string(page) + " 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox " + media_box +
+			     " /Resources << /Font << /F1 3 0 R >> >> /Contents " + std::to_string(page + 1) + " 0 R >>\nendobj\n");
+		offsets.push_back(out.position());
+		out.write(std::to_string(page + 1) + " 0 obj\n<< /Length " + std::to_string(content.size()) + " >>\nstream\n" + content +
+			     "endstream\nendobj\n");
+	}
+
+	size_t xref = out.position();
+	std::string table = "xref\n0 " + std::to_string(offsets.size()) + "\n0000000000 65535 f \n";
+	for (size_t i = 1; i < offsets.size(); i++) {
+		char entry[24];
+		snprintf(entry, sizeof(entry), "%010zu 00000 n \n", offsets[i]);
+		table += entry;
+	}
+	out.write(table + "trailer\n<< /Size " + std::to_string(offsets.size()) + " /Root 1 0 R >>\nstartxref\n" + std::to_string(xref) + "\n%%EOF\n");
+	return out.ok();
+}
+
+// Stored members, so the archive streams without a compressor
+static bool write_zip(Output& out, const std::vector<std::string>& names, const std::vector<Label>& labels) {
+	std::string central;
+	uint32_t members = 0;
+	for (size_t i = 0; i < labels.size(); i++) {
+		if (!labels[i].ok) continue;
+		const std::string& data = labels[i].bytes;
+		uint32_t crc		   = crc32(data.data(), data.size());
+		uint32_t offset	   = static_cast<uint32_t>(out.position());
+
+		std::string local;
+		put_le32(local, 0x04034b50);
+		put_le16(local, 10);  // Version needed
+		put_le16(local, 0);	  // Flags
+		put_le16(local, 0);	  // Stored
+		put_le32(local, 0);	  // DOS time and date
+		put_le32(local, crc);
+		put_le32(local, static_cast<uint32_t>(data.size()));
+		put_le32(local, static_cast<uint32_t>(data.size()));
+		put_le16(local, static_cast<uint32_t>(names[i].size()));
+		put_le16(local, 0);
+		out.write(local + names[i]);
+		out.write(data);
+
+		put_le32(central, 0x02014b50);
+		put_le16(central, 20);  // Made by
+		central.append(local, 4, 26);
+		put_le16(central, 0);	 // Comment
+		put_le16(central, 0);	 // Disk
+		put_le16(central, 0);	 // Internal attributes
+		put_le32(central, 0);	 // External attributes
+		put_le32(central, offset);
+		central += names[i];
+		members++;
+	}
+
+	uint32_t directory = static_cast<uint32_t>(out.position());
+	std::string end;
+	put_le32(end, 0x06054b50);
+	put_le16(end, 0);
+	put_le16(end, 0);
+	put_le16(end, members);
+	put_le16(end, members);
+	put_le32(end, static_cast<uint32_t>(central.size()));
+	put_le32(end, directory);
+	put_le16(end, 0);
+	out.write(central + end);
+	return out.ok();
+}
+
+/* ---- Main ---- */
+
+static std::string file_name(const Record& r, size_t index) {
+	char number[16];
+	snprintf(number, sizeof(number), "%06zu", index + 1);
+	std::string name = r.id.empty() ? number : r.id;
+	for (char& c : name) {
+		if (!isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.') c = '_';
+	}
+	return name;
+}
+
+static bool parse_options(int argc, char** argv, Options& o) {
+	for (int i = 1; i < argc; i++) {
+		const char* a = argv[i];
+		if (a[0] != '-' || a[1] == '\0') {
+			o.input = a;
+			continue;
+		}
+		if (i + 1 >= argc) return false;
+		const char* v = argv[++i];
+		switch (a[1]) {
+			case 'f':
+				if (!strcmp(v, "pbm")) o.format = Format::Pbm;
+				else if (!strcmp(v, "png")) o.format = Format::Png;
+				else if (!strcmp(v, "svg")) o.format = Format::Svg;
+				else if (!strcmp(v, "pdf")) o.format = Format::Pdf;
+				else if (!strcmp(v, "zip")) o.format = Format::Zip;
+				else return false;
+				break;
+			case 'o': o.output = v; break;
+			case 'j': o.threads = atoi(v); break;
+			case 's': o.scale = atoi(v); break;
+			case 'm': o.label_mm = atof(v); break;
+			default: return false;
+		}
+	}
+	return o.input && o.scale > 0 && o.label_mm > 0;
+}
+
+int main(int argc, char** argv) {
+	Options o;
+	if (!parse_options(argc, argv, o)) {
+		fprintf(stderr, "usage: %s [-f pbm|png|svg|pdf|zip] [-o path] [-j threads] [-s scale] [-m mm] <input.csv|input.jsonl|->\n", argv[0]);
+		return 2;
+	}
+	if (o.threads <= 0) o.threads = std::max(1u, std::thread::hardware_concurrency());
+	bool stream = o.format == Format::Pdf || o.format == Format::Zip;
+	if (!o.output) o.output = o.format == Format::Pdf ? "labels.pdf" : o.format == Format::Zip ? "labels.zip" : "labels";
+	crc32_init();
+
+	std::string text;
+	std::vector<Record> records;
+	if (!read_all(o.input, text)) {
+		perror(o.input);
+		return 1;
+	}
+	if (!parse_input(text, records)) return 1;
+	if (o.format == Format::Zip && records.size() > 65535) {
+		fprintf(stderr, "%zu records exceed a ZIP without ZIP64, split the input\n", records.size());
+		return 1;
+	}
+	if (!stream && mkdir(o.output, 0755) != 0 && errno != EEXIST) {
+		perror(o.output);
+		return 1;
+	}
+
+	std::vector<std::string> names(records.size());
+	static const char* const extensions[] = {".pbm", ".png", ".svg", "", ".png"};
+	for (size_t i = 0; i < records.size(); i++) names[i] = file_name(records[i], i) + extensions[static_cast<int>(o.format)];
+	if (o.format != Format::Pdf) {
+		// Ids that differ only in replaced characters, e.g. a/b and a_b, would overwrite each other
+		std::unordered_map<std::string, size_t> seen;
+		for (size_t i = 0; i < records.size(); i++) {
+			auto inserted = seen.emplace(names[i], i);
+			if (!inserted.second) {
+				fprintf(stderr, "records %zu and %zu both map to %s, make their ids distinct\n", inserted.first->second + 1, i + 1,
+					   names[i].c_str());
+				return 1;
+			}
+		}
+	}
+
+	double edge_pt	   = o.label_mm * 72 / 25.4;
+	double caption_pt = 10;
+	std::vector<Label> labels(records.size());
+	std::atomic<size_t> failed(0);
+
+	auto started    = std::chrono::steady_clock::now();
+	uint64_t steals = StealingPool::run(records.size(), o.threads, [&](size_t begin, size_t end) {
+		// One encodeTexts() per chunk computes the ECC of all its blocks in one vector kernel pass
+		std::vector<size_t> index;
+		std::vector<const char*> texts;
+		for (size_t i = begin; i < end; i++) {
+			labels[i].ok = QrCode::fits(records[i].uri.c_str());
+			if (!labels[i].ok) {
+				failed++;
+				continue;
+			}
+			index.push_back(i);
+			texts.push_back(records[i].uri.c_str());
+		}
+		std::vector<QrCode> codes = QrCode::encodeTexts(texts);
+
+		for (size_t n = 0; n < codes.size(); n++) {
+			size_t i	 = index[n];
+			Label& label = labels[i];
+			label.modules.resize(QrCode::size * QrCode::size);
+			for (int y = 0; y < QrCode::size; y++) {
+				for (int x = 0; x < QrCode::size; x++) label.modules[y * QrCode::size + x] = codes[n].getModule(x, y);
+			}
+
+			switch (o.format) {
+				case Format::Pbm:
+					label.ok = write_file(std::string(o.output) + "/" + names[i], render_pbm(label, o.scale));
+					break;
+				case Format::Png:
+					label.ok = write_file(std::string(o.output) + "/" + names[i], render_png(label, o.scale));
+					break;
+				case Format::Svg:
+					label.ok = write_file(std::string(o.output) + "/" + names[i], render_svg(label));
+					break;
+				case Format::Pdf:
+					label.bytes = render_pdf_page(label, records[i].id.empty() ? file_name(records[i], i) : records[i].id, edge_pt, caption_pt);
+					break;
+				case Format::Zip:
+					label.bytes = render_png(label, o.scale);
+					break;
+			}
+			if (!label.ok) failed++;
+			label.modules.clear();
+			label.modules.shrink_to_fit();
+		}
+	});
+	auto encoded = std::chrono::steady_clock::now();
+
+	bool ok = true;
+	if (stream) {
+		Output out(o.output);
+		ok = out.ok() && (o.format == Format::Pdf ? write_pdf(out, labels, edge_pt, edge_pt + caption_pt) : write_zip(out, names, labels));
+		if (!ok) fprintf(stderr, "%s: write error\n", o.output);
+	}
+	auto finished = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < records.size(); i++) {
+		if (!labels[i].ok) fprintf(stderr, "record %zu (%s): %s\n", i + 1, names[i].c_str(), QrCode::fits(records[i].uri.c_str()) ? "write error" : "too long for the device's QR version");
+	}
+	double encode_s = std::chrono::duration<double>(encoded - started).count();
+	double total_s  = std::chrono::duration<double>(finished - started).count();
+	fprintf(stderr, "%zu records, %zu failed, %d threads, %llu steals, encode %.3f s, total %.3f s, %.0f records/s\n", records.size(),
+		   failed.load(), o.threads, static_cast<unsigned long long>(steals), encode_s, total_s,
+		   total_s > 0 ? records.size() / total_s : 0.0);
+	return ok && failed == 0 ? 0 : 1;
+}
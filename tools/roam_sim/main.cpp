@@ -0,0 +1,279 @@
+// Drives RoamEngine with a station moving along a corridor of APs and reports
+// roam count and latency for each roaming mode.
+//
+//   roam_sim [laps] [seed]
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+
+#include "roamEngine.hpp"
+
+static const int64_t TICK_US		  = 10 * 1000;
+static const int64_t BEACON_US	  = 102400;
+static const double SPEED_MPS	  = 1.5;
+static const double AP_SPACING_M	  = 30;
+static const int AP_COUNT		  = 5;
+static const uint8_t AP_CHANNELS[] = {1, 6, 11, 1, 6};
+
+// Log-distance path loss, 2.4GHz indoor
+static const double RSSI_1M	    = -40;
+static const double PATH_LOSS_EXP = 3.0;
+static const double SHADOW_SIGMA  = 3.0;
+
+static const int UNUSABLE_RSSI	    = -85;  // Frames no longer get through
+static const int SENSITIVITY_RSSI	    = -90;  // Beacons are lost below this
+static const int64_t BEACON_TIMEOUT_US = 6 * 1000 * 1000;
+
+// Air time of each step
+static const int64_t NEIGHBOR_REPORT_US = 20 * 1000;
+static const int64_t SCAN_CHANNEL_US	   = 60 * 1000;	   // 50ms dwell and the channel switch
+static const int64_t BTM_EXCHANGE_US	   = 15 * 1000;
+static const int64_t FT_HANDOFF_US	   = 30 * 1000;	   // Reassociation with the FT key hierarchy
+static const int64_t FULL_HANDOFF_US	   = 250 * 1000;	   // Disconnect, auth, assoc, 4-way handshake
+static const int64_t FULL_SWEEP_US	   = 13 * 120 * 1000;  // Connect scan after a beacon loss
+
+enum class Mode {
+	Off,	   // No roaming, hold on until beacon loss
+	Scan,   // RSSI trigger and fallback scan, plain reassociation
+	K,	   // + 802.11k neighbor report
+	KVR,	   // + 802.11v BTM and 802.11r fast transition
+};
+
+static const char *mode_name(Mode mode) {
+	switch (mode) {
+		case Mode::Off:
+			return "off";
+		case Mode::Scan:
+			return "scan";
+		case Mode::K:
+			return "11k";
+		default:
+			return "11k/v/r";
+	}
+}
+
+struct Result {
+	RoamEngine::Stats stats;
+	uint32_t beacon_losses;
+	int64_t outage_us;
+	int64_t off_channel_us;
+	int64_t duration_us;
+	double rssi_sum;
+	uint64_t rssi_samples;
+};
+
+class Corridor {
+    public:
+	explicit Corridor(uint32_t seed) : rng(seed), noise(0, 1) {
+		for (int i = 0; i < AP_COUNT; i++) {
+			memset(bssid[i], 0, 6);
+			bssid[i][0] = 0x02;
+			bssid[i][5] = static_cast<uint8_t>(i + 1);
+			shadow[i]	= 0;
+		}
+	}
+
+	// Correlated shadowing, refreshed every beacon
+	void beacon() {
+		for (int i = 0; i < AP_COUNT; i++) shadow[i] = 0.9 * shadow[i] + sqrt(1 - 0.81) * SHADOW_SIGMA * noise(rng);
+	}
+
+	int8_t rssi(int ap, double x) const {
+		double dx = x - ap * AP_SPACING_M, d = sqrt(dx * dx + 9);
+		double r  = RSSI_1M - 10 * PATH_LOSS_EXP * log10(d) + shadow[ap];
+		return static_cast<int8_t>(r < -100 ? -100 : r);
+	}
+
+	int strongest(double x) const {
+		int best = 0;
+		for (int i = 1; i < AP_COUNT; i++)
+			if (rssi(i, x) > rssi(best, x)) best = i;
+		return best;
+	}
+
+	int find(const uint8_t b[6]) const {
+		for (int i = 0; i < AP_COUNT; i++)
+			if (memcmp(bssid[i], b, 6) == 0) return i;
+		return -1;
+	}
+
+	// Neighbor Report elements as the AP would send them: its direct neighbors
+	size_t neighbor_report(int ap, uint8_t *out) const {
+		size_t len = 0;
+		for (int i = ap - 1; i <= ap + 1; i += 2) {
+			if (i < 0 || i >= AP_COUNT) continue;
+			uint8_t *e = out + len;
+			e[0]	   = 52;
+			e[1]	   = 13;
+			memcpy(e + 2, bssid[i], 6);
+			memset(e + 8, 0, 4);
+			e[12] = 81;
+			e[13] = AP_CHANNELS[i];
+			e[14] = 7;
+			len += 15;
+		}
+		return len;
+	}
+
+	uint8_t bssid[AP_COUNT][6];
+
+    private:
+	std::mt19937 rng;
+	std::normal_distribution<double> noise;
+	double shadow[AP_COUNT];
+};
+
+static Result run(Mode mode, int laps, uint32_t seed) {
+	Corridor corridor(seed);
+	RoamEngine engine(RoamEngine::default_config());
+	Result result = {};
+
+	const double length = (AP_COUNT - 1) * AP_SPACING_M;
+	const int64_t end	= static_cast<int64_t>(laps * 2 * length / SPEED_MPS * 1e6);
+
+	int ap = 0;				  // Serving AP, -1 while disconnected
+	bool armed = true;			  // RSSI threshold armed in the driver
+	int64_t next_beacon = 0, below_since = -1;
+
+	// The single outstanding operation of the driver
+	enum class Pending { None, NeighborReport, ScanDone, Handoff, Reconnect } pending = Pending::None;
+	int64_t due = 0;
+	RoamEngine::Step scan_step = {};
+	RoamEngine::Candidate target = {};
+
+	auto handle = [&](const RoamEngine::Step &step, int64_t now) {
+		switch (step.action) {
+			case RoamEngine::Action::RequestNeighbors:
+				if (mode >= Mode::K) {
+					pending = Pending::NeighborReport;
+					due	   = now + NEIGHBOR_REPORT_US;
+				}
+				break;
+			case RoamEngine::Action::Scan:
+				scan_step = step;
+				pending   = Pending::ScanDone;
+				due	     = now + step.channel_count * SCAN_CHANNEL_US;
+				result.off_channel_us += step.channel_count * SCAN_CHANNEL_US;
+				break;
+			case RoamEngine::Action::Transition:
+				target  = step.target;
+				pending = Pending::Handoff;
+				due	   = now + (mode == Mode::KVR ? BTM_EXCHANGE_US + FT_HANDOFF_US : FULL_HANDOFF_US);
+				break;
+			default:
+				break;
+		}
+	};
+
+	for (int64_t now = 0; now < end; now += TICK_US) {
+		double pos = fmod(now / 1e6 * SPEED_MPS, 2 * length);
+		double x   = pos < length ? pos : 2 * length - pos;
+
+		if (now >= next_beacon) {
+			next_beacon += BEACON_US;
+			corridor.beacon();
+			if (ap >= 0 && pending != Pending::Handoff) {
+				int8_t rssi = corridor.rssi(ap, x);
+				result.rssi_sum += rssi;
+				result.rssi_samples++;
+
+				if (rssi < SENSITIVITY_RSSI) {
+					if (below_since < 0) below_since = now;
+				} else {
+					below_since = -1;
+				}
+				if (mode != Mode::Off && armed && rssi < engine.default_config().rssi_threshold) {
+					armed = false;
+					handle(engine.on_rssi_low(now, rssi, corridor.bssid[ap], AP_CHANNELS[ap]), now);
+				}
+			}
+		}
+
+		// Beacon loss, the driver drops the link and sweeps every channel
+		if (ap >= 0 && below_since >= 0 && now - below_since >= BEACON_TIMEOUT_US) {
+			result.beacon_losses++;
+			ap		    = -1;
+			below_since = -1;
+			engine.on_disconnected(now);
+			pending = Pending::Reconnect;
+			due	   = now + FULL_SWEEP_US + FULL_HANDOFF_US;
+		}
+
+		if (ap < 0 || pending == Pending::Handoff || (ap >= 0 && corridor.rssi(ap, x) < UNUSABLE_RSSI))
+			result.outage_us += TICK_US;
+
+		if (pending != Pending::None && now >= due) {
+			Pending done = pending;
+			pending	  = Pending::None;
+			switch (done) {
+				case Pending::NeighborReport: {
+					uint8_t report[64];
+					handle(engine.on_neighbor_report(report, corridor.neighbor_report(ap, report)), now);
+					break;
+				}
+				case Pending::ScanDone:
+					for (int c = 0; c < scan_step.channel_count; c++)
+						for (int i = 0; i < AP_COUNT; i++) {
+							int8_t rssi = corridor.rssi(i, x);
+							if (AP_CHANNELS[i] != scan_step.channels[c] || rssi < SENSITIVITY_RSSI) continue;
+							RoamEngine::Candidate candidate;
+							memcpy(candidate.bssid, corridor.bssid[i], 6);
+							candidate.channel = AP_CHANNELS[i];
+							candidate.rssi	   = rssi;
+							engine.on_scan_result(candidate);
+						}
+					handle(engine.on_scan_done(now), now);
+					break;
+				case Pending::Handoff: {
+					int next = corridor.find(target.bssid);
+					if (corridor.rssi(next, x) >= SENSITIVITY_RSSI) ap = next;
+					engine.on_associated(now, corridor.bssid[ap], AP_CHANNELS[ap]);
+					armed = false;
+					break;
+				}
+				case Pending::Reconnect:
+					ap = corridor.strongest(x);
+					engine.on_associated(now, corridor.bssid[ap], AP_CHANNELS[ap]);
+					armed = false;
+					break;
+				default:
+					break;
+			}
+		}
+
+		// The manager's timer: engine deadlines, then re-arming after the quiet time
+		if (engine.busy()) {
+			int64_t deadline = engine.deadline_us();
+			if (deadline && now >= deadline && pending == Pending::None) handle(engine.on_timeout(now), now);
+		} else if (!armed && ap >= 0 && now >= engine.quiet_until_us()) {
+			armed = true;
+		}
+	}
+
+	result.stats	   = engine.stats();
+	result.duration_us = end;
+	return result;
+}
+
+int main(int argc, char **argv) {
+	int laps	   = argc > 1 ? atoi(argv[1]) : 4;
+	uint32_t seed = argc > 2 ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 0)) : 1;
+
+	printf("%d APs %.0fm apart, %.1fm/s, %d laps, seed %u\n\n", AP_COUNT, AP_SPACING_M, SPEED_MPS, laps, seed);
+	printf("%-8s %6s %6s %6s %6s %10s %10s %10s %7s %9s %9s %8s\n", "mode", "trig", "roams", "failed", "none",
+		  "lat avg ms", "lat max ms", "handoff ms", "losses", "outage s", "offchan s", "avg rssi");
+
+	const Mode modes[] = {Mode::Off, Mode::Scan, Mode::K, Mode::KVR};
+	for (Mode mode : modes) {
+		Result r			    = run(mode, laps, seed);
+		const RoamEngine::Stats &s = r.stats;
+		printf("%-8s %6u %6u %6u %6u %10.1f %10.1f %10.1f %7u %9.2f %9.2f %8.1f\n", mode_name(mode), s.triggers, s.roams,
+			  s.failed, s.no_candidate, s.roams ? s.total_latency_us / 1e3 / s.roams : 0.0, s.max_latency_us / 1e3,
+			  s.last_handoff_us / 1e3, r.beacon_losses, r.outage_us / 1e6, r.off_channel_us / 1e6,
+			  r.rssi_samples ? r.rssi_sum / r.rssi_samples : 0.0);
+	}
+	return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Reed-Solomon kernel benchmark: every RsKernel the CPU supports against the
+ * byte-at-a-time reference QrCode used before, on block shapes of a few QR
+ * versions. Each kernel's output is checked against the reference first.
+ *
+ *   rs_bench [blocks] [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "rsKernel.hpp"
+
+using qrcodegen::RsKernel;
+
+struct Shape {
+	const char* name;
+	int degree;
+	int len;  // Data codewords per block
+};
+
+// ECC codewords per block and the short block's data length
+static const Shape shapes[] = {
+    {"v6-L", 18, 68},	   // The device's version
+    {"v10-M", 26, 43},
+    {"v40-L", 30, 118},
+    {"v40-H", 30, 15},
+};
+
+static uint8_t multiply(uint8_t x, uint8_t y) {
+	int z = 0;
+	for (int i = 7; i >= 0; i--) {
+		z = (z << 1) ^ ((z >> 7) * 0x11D);
+		z ^= ((y >> i) & 1) * x;
+	}
+	return static_cast<uint8_t>(z);
+}
+
+static std::vector<uint8_t> divisor(int degree) {
+	std::vector<uint8_t> result(degree);
+	result[degree - 1] = 1;
+	uint8_t root	   = 1;
+	for (int i = 0; i < degree; i++) {
+		for (int j = 0; j < degree; j++) {
+			result[j] = multiply(result[j], root);
+			if (j + 1 < degree) result[j] ^= result[j + 1];
+		}
+		root = multiply(root, 0x02);
+	}
+	return result;
+}
+
+// QrCode::reedSolomonComputeRemainder() as it was: one block, one multiply per coefficient
+static void reference(const uint8_t* data, int len, const std::vector<uint8_t>& div, uint8_t* ecc) {
+	int degree = static_cast<int>(div.size());
+	std::vector<uint8_t> r(degree);
+	for (int i = 0; i < len; i++) {
+		uint8_t factor = data[i] ^ r[0];
+		r.erase(r.begin());
+		r.push_back(0);
+		for (int j = 0; j < degree; j++) r[j] ^= multiply(div[j], factor);
+	}
+	memcpy(ecc, r.data(), degree);
+}
+
+template <typename F>
+static double seconds(int rounds, F fn) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < rounds; i++) fn();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+	int blocks = argc > 1 ? atoi(argv[1]) : 4096;
+	int rounds = argc > 2 ? atoi(argv[2]) : 20;
+	if (blocks <= 0 || rounds <= 0) {
+		fprintf(stderr, "usage: %s [blocks] [rounds]\n", argv[0]);
+		return 2;
+	}
+
+	const RsKernel::Kind kinds[] = {RsKernel::Kind::Scalar, RsKernel::Kind::Ssse3, RsKernel::Kind::Avx2};
+	printf("best kernel: %s, %d blocks x %d rounds\n\n", RsKernel::name(RsKernel::best()), blocks, rounds);
+	printf("%-6s %-9s %10s %9s %9s\n", "shape", "kernel", "MB/s", "vs ref", "vs scalar");
+
+	std::mt19937 rng(1);
+	for (const Shape& shape : shapes) {
+		std::vector<uint8_t> data(static_cast<size_t>(blocks) * shape.len);
+		for (uint8_t& b : data) b = static_cast<uint8_t>(rng());
+		std::vector<uint8_t> div = divisor(shape.degree);
+
+		std::vector<uint8_t> expected(static_cast<size_t>(blocks) * shape.degree);
+		std::vector<uint8_t> ecc(expected.size());
+		std::vector<const uint8_t*> data_ptrs(blocks);
+		std::vector<uint8_t*> ecc_ptrs(blocks);
+		for (int b = 0; b < blocks; b++) {
+			data_ptrs[b] = &data[static_cast<size_t>(b) * shape.len];
+			ecc_ptrs[b]  = &ecc[static_cast<size_t>(b) * shape.degree];
+		}
+
+		double bytes	   = static_cast<double>(data.size()) * rounds;
+		double ref_s   = seconds(rounds, [&]() {
+			  for (int b = 0; b < blocks; b++) reference(data_ptrs[b], shape.len, div, &expected[static_cast<size_t>(b) * shape.degree]);
+		  });
+		printf("%-6s %-9s %10.1f %8.2fx %9s\n", shape.name, "reference", bytes / ref_s / 1e6, 1.0, "");
+
+		double scalar_s = 0;
+		for (RsKernel::Kind kind : kinds) {
+			if (!RsKernel::use(kind)) continue;
+			memset(ecc.data(), 0, ecc.size());
+			RsKernel::remainder(data_ptrs.data(), shape.len, ecc_ptrs.data(), blocks, div.data(), shape.degree);
+			if (ecc != expected) {
+				printf("%-6s %-9s differs from the reference\n", shape.name, RsKernel::name(kind));
+				return 1;
+			}
+
+			double s = seconds(rounds, [&]() { RsKernel::remainder(data_ptrs.data(), shape.len, ecc_ptrs.data(), blocks, div.data(), shape.degree); });
+			if (kind == RsKernel::Kind::Scalar) scalar_s = s;
+			printf("%-6s %-9s %10.1f %8.2fx %8.2fx\n", shape.name, RsKernel::name(kind), bytes / s / 1e6, ref_s / s, scalar_s / s);
+		}
+		printf("\n");
+	}
+	return 0;
+}